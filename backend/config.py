@@ -4,6 +4,7 @@ import os
 DEFAULT_DATABASE_URL = "sqlite+aiosqlite:///./core.db"
 DEFAULT_GEMINI_MODEL = "gemini-3-flash-preview"
 DEFAULT_MAX_BLOB_CREATION_RETRIES = 2
+DEFAULT_SCHEDULE_TIMEOUT_MS = 5000
 
 
 def get_database_url() -> str:
@@ -25,3 +26,12 @@ def get_max_blob_creation_retries() -> int:
     except ValueError:
         return DEFAULT_MAX_BLOB_CREATION_RETRIES
     return max(0, value)
+
+
+def get_schedule_timeout_ms() -> int:
+    raw = os.getenv("SCHEDULE_TIMEOUT_MS", str(DEFAULT_SCHEDULE_TIMEOUT_MS))
+    try:
+        value = int(raw)
+    except ValueError:
+        return DEFAULT_SCHEDULE_TIMEOUT_MS
+    return max(1, value)
@@ -1,4 +1,4 @@
-from collections import deque
+import asyncio
 from datetime import datetime, timedelta, timezone
 from zoneinfo import ZoneInfo
 
@@ -7,6 +7,7 @@ from sqlalchemy import delete, select
 from sqlalchemy.ext.asyncio import AsyncSession
 
 import engine
+from backend.config import get_schedule_timeout_ms
 from backend.db import get_session
 from backend.models import (
     RecurrenceModel,
@@ -180,40 +181,107 @@ def _to_epoch_seconds(value_utc: datetime, epoch_start_utc: datetime) -> int:
 
 
 def _dependency_violation_message(jobs: list[engine.Job]) -> str | None:
-    job_map = {job.id: job for job in jobs}
-    in_degree = {job.id: 0 for job in jobs}
-    adj_list = {job.id: [] for job in jobs}
-    for job in jobs:
-        for dep_id in job.dependencies:
-            if dep_id in job_map:
-                adj_list[dep_id].append(job.id)
-                in_degree[job.id] += 1
-
-    queue = deque([job_id for job_id, degree in in_degree.items() if degree == 0])
-    topo_order = []
-    while queue:
-        current = queue.popleft()
-        topo_order.append(current)
-        for neighbor in adj_list[current]:
-            in_degree[neighbor] -= 1
-            if in_degree[neighbor] == 0:
-                queue.append(neighbor)
-
-    if len(topo_order) != len(jobs):
+    result = engine.check_dependency_violations(engine.Schedule(jobs))
+    if result.has_duplicate_ids:
+        return f"Duplicate job id {sorted(result.duplicate_ids)[0]}."
+    if result.has_cyclic_dependencies:
         return "Cyclic dependencies detected."
+    if result.violations:
+        return f"Dependency order violation for {result.violations[0].job_id}."
+    return None
+
 
+def _previous_placements(rows, epoch_start_utc: datetime) -> dict[str, list]:
+    placements: dict[str, list] = {}
+    for row in sorted(rows, key=lambda row: (row.id, row.segment_index)):
+        low = _to_epoch_seconds(row.realized_start, epoch_start_utc)
+        high = _to_epoch_seconds(row.realized_end, epoch_start_utc)
+        if low < 0 or high < low:
+            # Segments from before this week cannot be expressed in engine time.
+            placements[row.id] = None
+            continue
+        if row.id in placements and placements[row.id] is None:
+            continue
+        placements.setdefault(row.id, []).append(engine.TimeRange(low, high))
+    return placements
+
+
+def _placement_fits(job: engine.Job, ranges: list) -> bool:
+    max_segments = job.policy.get_max_splits() + 1 if job.policy.is_splittable() else 1
+    if len(ranges) > max_segments:
+        return False
+    if sum(job_range.length() for job_range in ranges) != job.duration:
+        return False
+    return all(job.schedulable_time_range.contains(job_range) for job_range in ranges)
+
+
+def _warm_start(jobs: list[engine.Job], placements: dict[str, list]):
+    # The stored schedule becomes the previous solution. Jobs whose stored
+    # placement still fits are only moved if the change reaches them; jobs
+    # without one are added and stored jobs that are gone are removed.
+    previous = []
+    added = []
+    modified = []
+    current_ids = set()
     for job in jobs:
-        job_ranges = job.scheduled_time_ranges or [job.scheduled_time_range]
-        earliest_start = min(job_range.get_low() for job_range in job_ranges)
-        for dep_id in job.dependencies:
-            dep_job = job_map.get(dep_id)
-            if dep_job is None:
-                continue
-            dep_ranges = dep_job.scheduled_time_ranges or [dep_job.scheduled_time_range]
-            latest_end = max(dep_range.get_high() for dep_range in dep_ranges)
-            if latest_end > earliest_start:
-                return f"Dependency order violation for {job.id}."
-    return None
+        current_ids.add(job.id)
+        ranges = placements.get(job.id)
+        if not ranges:
+            added.append(job)
+            continue
+        stored = engine.Job(
+            job.duration,
+            job.schedulable_time_range,
+            ranges[0],
+            job.id,
+            job.policy,
+            job.dependencies,
+            job.tags,
+        )
+        stored.scheduled_time_ranges = ranges
+        previous.append(stored)
+        if not _placement_fits(job, ranges):
+            modified.append(job)
+
+    removed = set()
+    for job_id, ranges in placements.items():
+        if job_id in current_ids or not ranges:
+            continue
+        low = min(job_range.get_low() for job_range in ranges)
+        high = max(job_range.get_high() for job_range in ranges)
+        stored = engine.Job(
+            high - low,
+            engine.TimeRange(low, high),
+            engine.TimeRange(low, high),
+            job_id,
+            engine.Policy(0, 0),
+            set(),
+            set(),
+        )
+        stored.scheduled_time_ranges = ranges
+        previous.append(stored)
+        removed.add(job_id)
+
+    change = engine.ScheduleChange(added=added, modified=modified, removed=removed)
+    return engine.Schedule(previous), change
+
+
+async def _run_scheduler(
+    jobs: list[engine.Job], granularity_seconds: int, warm_start=None
+) -> engine.Schedule:
+    # The solve runs without the GIL; past the timeout it is cancelled and
+    # returns the best schedule found so far.
+    config = engine.default_engine_config(granularity_seconds)
+    if warm_start is None:
+        handle = engine.SolveHandle(jobs, config)
+    else:
+        previous, change = warm_start
+        handle = engine.SolveHandle(previous, change, config)
+    finished = await asyncio.to_thread(handle.wait, get_schedule_timeout_ms())
+    if not finished:
+        handle.cancel()
+    result = await asyncio.to_thread(handle.result)
+    return result.schedule
 
 
 def _validate_schedule(schedule: engine.Schedule) -> str | None:
@@ -362,7 +430,36 @@ async def run_schedule(
         jobs.append(job)
 
     try:
-        schedule = engine.schedule(jobs, granularity_seconds)
+        feasibility = engine.check_feasibility(jobs, granularity_seconds)
+    except Exception as exc:
+        raise HTTPException(
+            status_code=status.HTTP_422_UNPROCESSABLE_ENTITY,
+            detail=f"Scheduler failed: {exc}",
+        ) from exc
+    if not feasibility.feasible():
+        raise HTTPException(
+            status_code=status.HTTP_409_CONFLICT,
+            detail={
+                "message": "No valid schedule exists. "
+                + "; ".join(conflict.message for conflict in feasibility.conflicts),
+                "conflicts": [
+                    {"kind": conflict.kind.name, "job_ids": list(conflict.job_ids)}
+                    for conflict in feasibility.conflicts
+                ],
+            },
+        )
+
+    stored_rows = (await session.execute(select(ScheduledOccurrenceModel))).scalars().all()
+    warm_start = None
+    if stored_rows:
+        warm_start = _warm_start(jobs, _previous_placements(stored_rows, epoch_start_utc))
+
+    try:
+        schedule = await _run_scheduler(jobs, granularity_seconds, warm_start)
+        if warm_start is not None and _validate_schedule(schedule):
+            # Pinned jobs cannot follow edits the stored placements do not
+            # show, such as new dependencies; solve from scratch instead.
+            schedule = await _run_scheduler(jobs, granularity_seconds)
     except Exception as exc:
         raise HTTPException(
             status_code=status.HTTP_422_UNPROCESSABLE_ENTITY,
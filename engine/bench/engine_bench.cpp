@@ -0,0 +1,473 @@
+#include "constants.hpp"
+#include "engine.hpp"
+#include "incremental_cost.hpp"
+#include "interval_tree.hpp"
+#include "move_library.hpp"
+#include "problem_table.hpp"
+#include "snapshot.hpp"
+#include "solve_handle.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using BenchClock = std::chrono::steady_clock;
+
+constexpr sec_t kGranularity = 300;
+constexpr sec_t kMinute = 60;
+constexpr sec_t kHour = 60 * kMinute;
+constexpr sec_t kDay = 24 * kHour;
+constexpr sec_t kWeek = 7 * kDay;
+
+constexpr uint64_t kMoves = 100000;
+constexpr size_t kCostEvaluationJobs = 200000;
+
+/**
+ * Workload generators. Each builds n jobs shaped like one kind of real
+ * calendar, from a seeded generator so that runs are comparable between
+ * releases. Windows are sized to keep every workload feasible at every
+ * scale.
+ */
+using Generator = std::function<std::vector<Job>(size_t, std::mt19937&)>;
+
+Job flexible_job(const std::string& id, sec_t duration, sec_t low, sec_t high, Policy policy, std::set<ID> dependencies = {}) {
+    return Job(duration, TimeRange(low, high), TimeRange(low, low + duration), id, policy, std::move(dependencies), {});
+}
+
+// Six jobs per workday between 9:00 and 17:00: two fixed meetings and four
+// tasks of one to two hours, half of them overlappable. The hard jobs always
+// fit, but days average seven hours of work, so most need the annealer to
+// trade overlap away.
+std::vector<Job> dense_workday(size_t n, std::mt19937& gen) {
+    const size_t days = std::max<size_t>(1, (n + 5) / 6);
+    std::uniform_int_distribution<sec_t> quarters(4, 8);
+    std::vector<Job> jobs;
+    jobs.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        const sec_t day = static_cast<sec_t>(i % days) * kDay;
+        const size_t ordinal = i / days;
+        const std::string id = "workday-" + std::to_string(i);
+        if (ordinal % 5 == 0) {
+            const sec_t start = day + 9 * kHour + static_cast<sec_t>(ordinal) * kHour;
+            jobs.emplace_back(30 * kMinute, TimeRange(start, start + 30 * kMinute), TimeRange(start, start + 30 * kMinute),
+                              id, Policy(), std::set<ID>{}, std::set<Tag>{});
+            continue;
+        }
+        const Policy policy = ordinal % 2 == 1 ? Policy(0, 0, false, true) : Policy();
+        jobs.push_back(flexible_job(id, quarters(gen) * 15 * kMinute, day + 9 * kHour, day + 17 * kHour, policy));
+    }
+    return jobs;
+}
+
+// Long tasks over the weekdays of a week, most of which may be split into
+// up to four granularity-aligned pieces.
+std::vector<Job> split_heavy(size_t n, std::mt19937& gen) {
+    const size_t weeks = std::max<size_t>(1, n / 15);
+    std::uniform_int_distribution<sec_t> half_hours(4, 16);
+    std::bernoulli_distribution splittable(0.6);
+    std::vector<Job> jobs;
+    jobs.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        const sec_t week = static_cast<sec_t>(i % weeks) * kWeek;
+        const Policy policy = splittable(gen) ? Policy(3, 30 * kMinute, true, false, false, true) : Policy();
+        jobs.push_back(flexible_job("split-" + std::to_string(i), half_hours(gen) * 30 * kMinute, week, week + 5 * kDay, policy));
+    }
+    return jobs;
+}
+
+// Chains of ten jobs, each waiting for the previous one, with one chain
+// starting per day and allowed two days to finish.
+std::vector<Job> dependency_chains(size_t n, std::mt19937& gen) {
+    constexpr size_t kChainLength = 10;
+    std::uniform_int_distribution<sec_t> quarters(1, 4);
+    std::vector<Job> jobs;
+    jobs.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        const sec_t start = static_cast<sec_t>(i / kChainLength) * kDay;
+        std::set<ID> dependencies;
+        if (i % kChainLength != 0) {
+            dependencies.insert("chain-" + std::to_string(i - 1));
+        }
+        jobs.push_back(flexible_job("chain-" + std::to_string(i), quarters(gen) * 15 * kMinute, start, start + 2 * kDay,
+                                    Policy(), std::move(dependencies)));
+    }
+    return jobs;
+}
+
+// Weekly series expanded over eight weeks: each occurrence may move within
+// an hour of its usual slot. Blocks of 50 series share eight weeks.
+std::vector<Job> recurrence(size_t n, std::mt19937& gen) {
+    constexpr size_t kOccurrences = 8;
+    constexpr size_t kSeriesPerBlock = 50;
+    std::uniform_int_distribution<sec_t> half_hours(1, 2);
+    std::vector<Job> jobs;
+    jobs.reserve(n);
+    sec_t duration = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const size_t series = i / kOccurrences;
+        const size_t occurrence = i % kOccurrences;
+        if (occurrence == 0) {
+            duration = half_hours(gen) * 30 * kMinute;
+        }
+        const sec_t block = static_cast<sec_t>(series / kSeriesPerBlock) * kOccurrences * kWeek;
+        const sec_t slot = static_cast<sec_t>(series % 5) * kDay + (8 + static_cast<sec_t>(series % kSeriesPerBlock) / 5) * kHour;
+        const sec_t usual = block + static_cast<sec_t>(occurrence) * kWeek + slot;
+        jobs.push_back(flexible_job("series-" + std::to_string(series) + "-" + std::to_string(occurrence),
+                                    duration, usual - kHour, usual + duration + kHour, Policy()));
+    }
+    return jobs;
+}
+
+struct Workload {
+    const char* name;
+    Generator generate;
+};
+
+const std::vector<Workload>& workloads() {
+    static const std::vector<Workload> all = {
+        {"dense_workday", dense_workday},
+        {"split_heavy", split_heavy},
+        {"dependency_chains", dependency_chains},
+        {"recurrence", recurrence},
+    };
+    return all;
+}
+
+struct Options {
+    std::vector<size_t> scales = {10, 100, 1000, 10000, 50000};
+    std::vector<std::string> workloads;
+    std::vector<std::string> snapshots;
+    uint64_t budget_ms = 200;
+    uint64_t workers = 1;
+    uint32_t seed = 42;
+    std::string json_path;
+};
+
+/**
+ * Measurement
+ *
+ * One workload at one scale. Times are wall-clock; a negative value means
+ * the quantity does not apply, e.g. no legal schedule was found.
+ */
+struct Measurement {
+    std::string workload;
+    size_t jobs = 0;
+    bool feasible = false;
+    double solve_ms = 0.0;
+    uint64_t iterations = 0;
+    double iterations_per_sec = 0.0;
+    double first_feasible_ms = -1.0;
+    double final_cost = 0.0;
+    double ns_per_cost_evaluation = -1.0;
+    double ns_per_move = -1.0;
+    double schedule_jobs_ms = 0.0;
+    double interval_tree_insert_ns = 0.0;
+    double interval_tree_query_ns = 0.0;
+};
+
+double elapsed_ms(BenchClock::time_point since) {
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - since).count();
+}
+
+double elapsed_ns(BenchClock::time_point since) {
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - since).count();
+}
+
+void measure_solve(const std::vector<Job>& jobs, const Options& options, Measurement& result, Schedule& solved) {
+    EngineConfig config = default_engine_config(kGranularity);
+    config.time_budget_ms = options.budget_ms;
+    config.num_workers = options.workers;
+
+    const BenchClock::time_point start = BenchClock::now();
+    double first_feasible_ms = -1.0;
+    SolveMonitor monitor(
+        [&](const SolveProgress& progress) {
+            if (first_feasible_ms < 0.0
+                && progress.components_reported == progress.component_count
+                && progress.best_cost < constants::ILLEGAL_SCHEDULE_COST) {
+                first_feasible_ms = elapsed_ms(start);
+            }
+        },
+        std::chrono::milliseconds(1));
+    SolveResult solve_result = solve(jobs, config, &monitor);
+    result.solve_ms = elapsed_ms(start);
+
+    result.feasible = solve_result.feasibility.feasible();
+    result.iterations = monitor.progress().iterations;
+    result.iterations_per_sec = result.solve_ms > 0.0 ? result.iterations / (result.solve_ms / 1000.0) : 0.0;
+    result.final_cost = ScheduleCostFunction(solve_result.schedule, kGranularity).schedule_cost();
+    if (result.final_cost < constants::ILLEGAL_SCHEDULE_COST) {
+        result.first_feasible_ms = first_feasible_ms >= 0.0 ? first_feasible_ms : result.solve_ms;
+    }
+    solved = std::move(solve_result.schedule);
+}
+
+void measure_cost_evaluation(const Schedule& schedule, Measurement& result) {
+    const size_t repetitions = std::max<size_t>(1, kCostEvaluationJobs / std::max<size_t>(schedule.scheduled_jobs.size(), 1));
+    double sink = 0.0;
+    const BenchClock::time_point start = BenchClock::now();
+    for (size_t r = 0; r < repetitions; ++r) {
+        sink += ScheduleCostFunction(schedule, kGranularity).schedule_cost();
+    }
+    result.ns_per_cost_evaluation = elapsed_ns(start) / static_cast<double>(repetitions);
+    if (sink < 0.0) {
+        std::printf("unexpected negative cost\n");
+    }
+}
+
+// Proposes, applies and then undoes or accepts moves on the solved
+// schedule, as the annealer does.
+void measure_moves(const Schedule& schedule, Measurement& result) {
+    const ProblemTable problem = compile_problem(schedule.scheduled_jobs, kGranularity);
+    std::vector<job_index_t> flexible_indices;
+    for (job_index_t i = 0; i < problem.size(); ++i) {
+        if (!problem.rigid[i]) {
+            flexible_indices.push_back(i);
+        }
+    }
+    if (flexible_indices.empty()) {
+        return;
+    }
+    Placement placement(problem);
+    IncrementalScheduleCost cost_model(problem, placement);
+    MoveLibrary moves(problem, flexible_indices, placement, cost_model, true);
+    Rng gen(7);
+
+    const BenchClock::time_point start = BenchClock::now();
+    for (uint64_t m = 0; m < kMoves; ++m) {
+        moves.apply(gen);
+        if (m % 2 == 0) {
+            moves.undo();
+        } else {
+            moves.accept();
+        }
+    }
+    result.ns_per_move = elapsed_ns(start) / static_cast<double>(kMoves);
+}
+
+void measure_schedule_jobs(const std::vector<Job>& jobs, Measurement& result) {
+    const BenchClock::time_point start = BenchClock::now();
+    schedule_jobs(jobs, kGranularity, 10.0, 1e-4, 1000000);
+    result.schedule_jobs_ms = elapsed_ms(start);
+}
+
+void measure_interval_tree(const Schedule& schedule, Measurement& result) {
+    std::vector<TimeRange> ranges;
+    for (const Job& job : schedule.scheduled_jobs) {
+        ranges.push_back(job.scheduled_time_range);
+    }
+    if (ranges.empty()) {
+        return;
+    }
+    IntervalTree<sec_t, size_t> tree;
+    tree.reserve(ranges.size());
+    BenchClock::time_point start = BenchClock::now();
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        tree.insert(ranges[i], i);
+    }
+    result.interval_tree_insert_ns = elapsed_ns(start) / static_cast<double>(ranges.size());
+
+    size_t hits = 0;
+    start = BenchClock::now();
+    for (const TimeRange& range : ranges) {
+        hits += tree.search_overlap(range) != nullptr ? 1 : 0;
+    }
+    result.interval_tree_query_ns = elapsed_ns(start) / static_cast<double>(ranges.size());
+    if (hits != ranges.size()) {
+        std::printf("interval tree lost %zu ranges\n", ranges.size() - hits);
+    }
+}
+
+Measurement run(const std::string& name, const std::vector<Job>& jobs, const Options& options) {
+    Measurement result;
+    result.workload = name;
+    result.jobs = jobs.size();
+    Schedule solved;
+    measure_solve(jobs, options, result, solved);
+    measure_cost_evaluation(solved, result);
+    measure_moves(solved, result);
+    measure_schedule_jobs(jobs, result);
+    measure_interval_tree(solved, result);
+    return result;
+}
+
+Measurement run(const Workload& workload, size_t jobs_count, const Options& options) {
+    std::mt19937 gen(options.seed);
+    return run(workload.name, workload.generate(jobs_count, gen), options);
+}
+
+// A captured problem runs at its own size, named after its file.
+Measurement run_snapshot(const std::string& path, const Options& options) {
+    const MappedSnapshot snapshot(path);
+    const size_t slash = path.find_last_of('/');
+    return run(slash == std::string::npos ? path : path.substr(slash + 1), snapshot.jobs(), options);
+}
+
+std::string json_number(double value) {
+    if (value < 0.0) {
+        return "null";
+    }
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+    return buffer;
+}
+
+void write_json(const std::vector<Measurement>& results, const Options& options, std::FILE* out) {
+    std::fprintf(out, "{\n  \"schema\": 1,\n");
+    std::fprintf(out, "  \"granularity\": %llu,\n", static_cast<unsigned long long>(kGranularity));
+    std::fprintf(out, "  \"budget_ms\": %llu,\n", static_cast<unsigned long long>(options.budget_ms));
+    std::fprintf(out, "  \"workers\": %llu,\n", static_cast<unsigned long long>(options.workers));
+    std::fprintf(out, "  \"seed\": %u,\n", options.seed);
+    std::fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Measurement& m = results[i];
+        std::fprintf(out, "    {\"workload\": \"%s\", \"jobs\": %zu, \"feasible\": %s, ", m.workload.c_str(), m.jobs,
+                     m.feasible ? "true" : "false");
+        std::fprintf(out, "\"solve_ms\": %s, \"iterations\": %llu, \"iterations_per_sec\": %s, ",
+                     json_number(m.solve_ms).c_str(), static_cast<unsigned long long>(m.iterations),
+                     json_number(m.iterations_per_sec).c_str());
+        std::fprintf(out, "\"first_feasible_ms\": %s, \"final_cost\": %s, ",
+                     json_number(m.first_feasible_ms).c_str(), json_number(m.final_cost).c_str());
+        std::fprintf(out, "\"ns_per_cost_evaluation\": %s, \"ns_per_move\": %s, \"schedule_jobs_ms\": %s, ",
+                     json_number(m.ns_per_cost_evaluation).c_str(), json_number(m.ns_per_move).c_str(),
+                     json_number(m.schedule_jobs_ms).c_str());
+        std::fprintf(out, "\"interval_tree_insert_ns\": %s, \"interval_tree_query_ns\": %s}%s\n",
+                     json_number(m.interval_tree_insert_ns).c_str(), json_number(m.interval_tree_query_ns).c_str(),
+                     i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+}
+
+void print_row(const Measurement& m) {
+    std::printf("%-18s %6zu %9.1f %12.0f %10.2f %14.1f %12.0f %9.1f %10.1f %9.1f  %s\n",
+                m.workload.c_str(), m.jobs, m.solve_ms, m.iterations_per_sec, m.first_feasible_ms,
+                m.ns_per_cost_evaluation / 1000.0, m.ns_per_move, m.schedule_jobs_ms,
+                m.interval_tree_insert_ns, m.interval_tree_query_ns,
+                m.feasible ? "" : "(conflicts)");
+}
+
+std::vector<std::string> split_list(const char* text) {
+    std::vector<std::string> items;
+    std::string item;
+    for (const char* c = text; ; ++c) {
+        if (*c == ',' || *c == '\0') {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+            item.clear();
+            if (*c == '\0') {
+                break;
+            }
+        } else {
+            item += *c;
+        }
+    }
+    return items;
+}
+
+void usage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [--scales 10,100,...] [--workloads name,...] [--budget-ms N]\n"
+                 "          [--workers N] [--seed N] [--json FILE] [--snapshots file,...]\n"
+                 "workloads: dense_workday, split_heavy, dependency_chains, recurrence\n"
+                 "snapshots are captured problems (see write_snapshot); given alone, no workload runs\n",
+                 program);
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* flag = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(flag, "--scales") == 0) {
+            options.scales.clear();
+            for (const std::string& scale : split_list(value)) {
+                options.scales.push_back(static_cast<size_t>(std::strtoull(scale.c_str(), nullptr, 10)));
+            }
+        } else if (std::strcmp(flag, "--workloads") == 0) {
+            options.workloads = split_list(value);
+        } else if (std::strcmp(flag, "--snapshots") == 0) {
+            options.snapshots = split_list(value);
+        } else if (std::strcmp(flag, "--budget-ms") == 0) {
+            options.budget_ms = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(flag, "--workers") == 0) {
+            options.workers = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(flag, "--seed") == 0) {
+            options.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(flag, "--json") == 0) {
+            options.json_path = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<const Workload*> selected;
+    for (const Workload& workload : workloads()) {
+        if ((options.workloads.empty() && options.snapshots.empty())
+            || std::find(options.workloads.begin(), options.workloads.end(), workload.name) != options.workloads.end()) {
+            selected.push_back(&workload);
+        }
+    }
+    if (selected.empty() && options.snapshots.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::printf("%-18s %6s %9s %12s %10s %14s %12s %9s %10s %9s\n",
+                "workload", "jobs", "solve ms", "iters/s", "legal ms", "cost eval us", "ns/move",
+                "sj ms", "tree ins", "tree qry");
+    std::vector<Measurement> results;
+    for (const Workload* workload : selected) {
+        for (size_t scale : options.scales) {
+            results.push_back(run(*workload, scale, options));
+            print_row(results.back());
+            std::fflush(stdout);
+        }
+    }
+    for (const std::string& path : options.snapshots) {
+        try {
+            results.push_back(run_snapshot(path, options));
+        } catch (const std::invalid_argument& error) {
+            std::fprintf(stderr, "%s\n", error.what());
+            return 1;
+        }
+        print_row(results.back());
+        std::fflush(stdout);
+    }
+
+    if (!options.json_path.empty()) {
+        std::FILE* out = options.json_path == "-" ? stdout : std::fopen(options.json_path.c_str(), "w");
+        if (out == nullptr) {
+            std::fprintf(stderr, "cannot write %s\n", options.json_path.c_str());
+            return 1;
+        }
+        write_json(results, options, out);
+        if (out != stdout) {
+            std::fclose(out);
+        }
+    }
+    return 0;
+}
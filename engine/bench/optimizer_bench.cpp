@@ -0,0 +1,103 @@
+#include "optimizer.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t kIterations = 5000000;
+constexpr double kRatio = 0.999999;
+
+/**
+ * Quadratic toy problem: the state is a vector of integers, a move nudges
+ * one of them, and the cost is kept incrementally. Each iteration does very
+ * little work, so the time is dominated by the optimizer's own overhead.
+ */
+struct QuadraticChain {
+    std::vector<int64_t> values;
+    std::vector<int64_t> best;
+    Rng gen;
+    double cost_value = 0.0;
+    size_t moved = 0;
+    int64_t previous = 0;
+    double previous_cost = 0.0;
+
+    explicit QuadraticChain(uint32_t seed) : values(64, 100), best(values), gen(seed) {
+        for (int64_t value : values) {
+            cost_value += static_cast<double>(value * value);
+        }
+    }
+
+    double apply_move() {
+        moved = gen() % values.size();
+        previous = values[moved];
+        previous_cost = cost_value;
+        values[moved] += (gen() & 1) ? 1 : -1;
+        cost_value += static_cast<double>(values[moved] * values[moved] - previous * previous);
+        return cost_value;
+    }
+
+    void undo_move() {
+        values[moved] = previous;
+        cost_value = previous_cost;
+    }
+
+    void accept_move() {}
+
+    double probe_move() {
+        return apply_move();
+    }
+
+    void discard_move() {
+        undo_move();
+    }
+
+    void record_best() {
+        best = values;
+    }
+};
+
+template<typename Run>
+void report(const char* name, Run&& run) {
+    const auto start = std::chrono::steady_clock::now();
+    const double best_cost = run();
+    const auto stop = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    std::printf("%-28s %8.2f ns/iter  best=%.0f\n", name, ns / static_cast<double>(kIterations), best_cost);
+}
+
+} // namespace
+
+int main() {
+    report("std::function (type-erased)", []() {
+        QuadraticChain chain(1);
+        InPlaceSimulatedAnnealingOptimizer optimizer(
+            [&chain]() { return chain.apply_move(); },
+            [&chain]() { chain.undo_move(); },
+            [&chain]() { chain.accept_move(); },
+            [&chain]() { chain.record_best(); },
+            10.0,
+            0.0,
+            static_cast<int>(kIterations),
+            [](double t0, int iter) { return t0 * std::pow(kRatio, iter); },
+            7);
+        return optimizer.optimize(chain.cost_value);
+    });
+
+    report("template + GeometricSchedule", []() {
+        QuadraticChain chain(1);
+        BasicInPlaceSimulatedAnnealingOptimizer<QuadraticChain> optimizer(
+            chain,
+            10.0,
+            0.0,
+            kIterations,
+            GeometricSchedule{kRatio},
+            7);
+        return optimizer.optimize(chain.cost_value);
+    });
+
+    return 0;
+}
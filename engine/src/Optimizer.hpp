@@ -1,32 +1,353 @@
 #ifndef SIMULATED_ANNEALING_OPTIMIZER_HPP
 #define SIMULATED_ANNEALING_OPTIMIZER_HPP
 #include "constants.hpp"
+#include "cost_history.hpp"
+#include "parallel.hpp"
+#include "rng.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
 #include <functional>
 #include <random>
 #include <cmath>
 #include <limits>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-template<typename State>
-class SimulatedAnnealingOptimizer {
+/**
+ * GeometricSchedule
+ *
+ * T(iter) = t0 * ratio^iter. The annealers recognise this schedule at
+ * compile time and advance the temperature with one multiplication per
+ * iteration instead of calling it.
+ */
+struct GeometricSchedule {
+    double ratio = 0.95;
+
+    double operator()(double t0, uint64_t iter) const {
+        return t0 * std::pow(ratio, static_cast<double>(iter));
+    }
+};
+
+/**
+ * Walks the temperatures of a schedule. Schedules other than
+ * GeometricSchedule are called with (t0, iter) every iteration.
+ */
+template<typename TemperatureSchedule>
+class TemperatureCursor {
 public:
-    using CostFunction = std::function<double(const State&)>;
-    using NeighborFunction = std::function<State(const State&)>;
-    using TemperatureSchedule = std::function<double(double, int)>;
+    TemperatureCursor(const TemperatureSchedule& schedule, double t0)
+        : schedule(schedule) {
+        restart(t0);
+    }
 
-    SimulatedAnnealingOptimizer(
+    /** Starts the schedule over from t0. */
+    void restart(double t0) {
+        this->t0 = t0;
+        iter = 0;
+        if constexpr (std::is_same_v<TemperatureSchedule, GeometricSchedule>) {
+            temp = t0;
+        } else {
+            temp = schedule(t0, 0);
+        }
+    }
+
+    double value() const {
+        return temp;
+    }
+
+    void advance() {
+        ++iter;
+        if constexpr (std::is_same_v<TemperatureSchedule, GeometricSchedule>) {
+            temp *= schedule.ratio;
+        } else {
+            temp = schedule(t0, iter);
+        }
+    }
+
+private:
+    const TemperatureSchedule& schedule;
+    double t0 = 0.0;
+    double temp = 0.0;
+    uint64_t iter = 0;
+};
+
+/** Progress of an annealing run, as passed to AnnealingLimits::on_progress. */
+struct AnnealingProgress {
+    uint64_t iteration = 0;
+    double best_cost = 0.0;
+    double temperature = 0.0;
+};
+
+/**
+ * AnnealingLimits
+ *
+ * Budget and convergence rules shared by the annealers. Every field is
+ * off by default, which leaves a run bounded by max_iters and final_temp.
+ *
+ * deadline: wall-clock end of the run. The temperature then follows the
+ *     clock instead of the schedule (see AnnealingControl).
+ * lower_bound: no state can cost less, so the run ends once the best cost
+ *     reaches it.
+ * plateau_iters: iterations without a new best after which the run
+ *     reheats, or ends once max_reheats reheats have been spent.
+ * reheat_temp_fraction: a reheat restarts cooling from this fraction of
+ *     the initial temperature.
+ * calibration_samples: when nonzero, the initial and final temperatures
+ *     are replaced by ones calibrated from this many sampled moves.
+ * cancelled: the run ends once the flag is set.
+ * on_progress: called from the annealing thread with the run's progress.
+ *
+ * cancelled and on_progress are polled every
+ * AnnealingControl::CLOCK_INTERVAL iterations, or at every exchange for
+ * parallel tempering.
+ */
+struct AnnealingLimits {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point deadline = Clock::time_point::max();
+    double lower_bound = -std::numeric_limits<double>::infinity();
+    uint64_t plateau_iters = 0;
+    uint32_t max_reheats = 0;
+    double reheat_temp_fraction = 0.5;
+    uint32_t calibration_samples = 0;
+    const std::atomic<bool>* cancelled = nullptr;
+    std::function<void(const AnnealingProgress&)> on_progress;
+};
+
+enum class AnnealingStop : uint8_t {
+    ITERATIONS,   // max_iters iterations ran
+    FROZEN,       // the temperature fell below final_temp
+    DEADLINE,
+    LOWER_BOUND,
+    PLATEAU,
+    CANCELLED,
+};
+
+/** How an annealing run went. */
+struct AnnealingReport {
+    uint64_t iterations = 0;
+    uint32_t reheats = 0;
+    AnnealingStop stop = AnnealingStop::ITERATIONS;
+    double initial_temp = 0.0;
+    double final_temp = 0.0;
+};
+
+/**
+ * Calibrates {initial_temp, final_temp} from sample_delta(), which proposes
+ * a move and returns its cost delta. The initial temperature accepts the
+ * mean uphill delta with probability 0.8 and the final one accepts the
+ * smallest uphill delta with probability 0.01. Deltas that cross the
+ * illegal penalty are skipped; without any uphill sample the given
+ * temperatures are returned unchanged.
+ */
+template<typename SampleDelta>
+std::pair<double, double> calibrate_temperatures(
+    double initial_temp,
+    double final_temp,
+    uint32_t samples,
+    SampleDelta&& sample_delta
+) {
+    constexpr double INITIAL_ACCEPTANCE = 0.8;
+    constexpr double FINAL_ACCEPTANCE = 0.01;
+
+    double uphill_sum = 0.0;
+    double smallest_uphill = std::numeric_limits<double>::infinity();
+    uint32_t uphill = 0;
+    for (uint32_t s = 0; s < samples; ++s) {
+        const double delta = sample_delta();
+        if (delta > constants::EPSILON && delta < constants::ILLEGAL_SCHEDULE_COST / 2) {
+            uphill_sum += delta;
+            smallest_uphill = std::min(smallest_uphill, delta);
+            ++uphill;
+        }
+    }
+    if (uphill == 0) {
+        return {initial_temp, final_temp};
+    }
+    return {
+        -(uphill_sum / uphill) / std::log(INITIAL_ACCEPTANCE),
+        -smallest_uphill / std::log(FINAL_ACCEPTANCE)
+    };
+}
+
+/**
+ * AnnealingControl
+ *
+ * Temperature and stopping rules of one annealing run. Without a deadline
+ * the temperature follows the schedule and the run ends when it falls
+ * below final_temp. With a deadline it cools geometrically from
+ * initial_temp to final_temp over whichever of the time budget and
+ * max_iters runs out first, so the run is cold when it ends; the clock,
+ * the cancellation flag and the progress callback are polled every
+ * CLOCK_INTERVAL iterations.
+ *
+ * A reheat, on a plateau or when the schedule freezes early, restarts
+ * cooling from reheat_temp_fraction * initial_temp over what is left of
+ * the run.
+ */
+template<typename TemperatureSchedule>
+class AnnealingControl {
+public:
+    using Clock = AnnealingLimits::Clock;
+    static constexpr uint64_t CLOCK_INTERVAL = 64;
+
+    AnnealingControl(
+        const TemperatureSchedule& schedule,
+        double initial_temp,
+        double final_temp,
+        uint64_t max_iters,
+        const AnnealingLimits& limits
+    )
+    : limits(limits),
+      max_iters(max_iters),
+      initial_temp(initial_temp),
+      final_temp(final_temp),
+      cursor(schedule, initial_temp),
+      timed(limits.deadline != Clock::time_point::max()),
+      start(Clock::now()),
+      phase_temp(initial_temp),
+      temp(initial_temp)
+    {}
+
+    double temperature() const {
+        return timed ? temp : cursor.value();
+    }
+
+    uint64_t iteration() const {
+        return iter;
+    }
+
+    /** Whether to run another iteration; best_cost is the best seen so far. */
+    bool running(double best_cost) {
+        if (iter >= max_iters) {
+            return stop(AnnealingStop::ITERATIONS);
+        }
+        if (best_cost <= limits.lower_bound + constants::EPSILON) {
+            return stop(AnnealingStop::LOWER_BOUND);
+        }
+        if (limits.plateau_iters > 0 && stagnant >= limits.plateau_iters && !reheat()) {
+            return stop(AnnealingStop::PLATEAU);
+        }
+        if (timed) {
+            if (iter % CLOCK_INTERVAL == 0 && !read_clock()) {
+                return stop(AnnealingStop::DEADLINE);
+            }
+        } else if (cursor.value() < final_temp && !(reheat() && cursor.value() >= final_temp)) {
+            return stop(AnnealingStop::FROZEN);
+        }
+        if (iter % CLOCK_INTERVAL == 0 && !poll(best_cost)) {
+            return stop(AnnealingStop::CANCELLED);
+        }
+        return true;
+    }
+
+    /** Ends an iteration; improved is whether it found a new best. */
+    void advance(bool improved) {
+        ++iter;
+        stagnant = improved ? 0 : stagnant + 1;
+        if (!timed) {
+            cursor.advance();
+        }
+    }
+
+    AnnealingReport report() const {
+        return AnnealingReport{iter, reheats, stop_reason, initial_temp, final_temp};
+    }
+
+private:
+    const AnnealingLimits& limits;
+    uint64_t max_iters;
+    double initial_temp;
+    double final_temp;
+    TemperatureCursor<TemperatureSchedule> cursor;
+    bool timed;
+    Clock::time_point start;
+    double phase_temp;
+    double phase_progress = 0.0;
+    double progress = 0.0;
+    double temp;
+    uint64_t iter = 0;
+    uint64_t stagnant = 0;
+    uint32_t reheats = 0;
+    AnnealingStop stop_reason = AnnealingStop::ITERATIONS;
+
+    bool stop(AnnealingStop reason) {
+        stop_reason = reason;
+        return false;
+    }
+
+    bool reheat() {
+        if (reheats >= limits.max_reheats) {
+            return false;
+        }
+        ++reheats;
+        stagnant = 0;
+        phase_temp = initial_temp * limits.reheat_temp_fraction;
+        phase_progress = progress;
+        temp = phase_temp;
+        cursor.restart(phase_temp);
+        return true;
+    }
+
+    bool poll(double best_cost) {
+        if (limits.cancelled && limits.cancelled->load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (limits.on_progress) {
+            limits.on_progress(AnnealingProgress{iter, best_cost, temperature()});
+        }
+        return true;
+    }
+
+    bool read_clock() {
+        const Clock::time_point now = Clock::now();
+        if (now >= limits.deadline) {
+            return false;
+        }
+        const double budget = std::chrono::duration<double>(limits.deadline - start).count();
+        const double elapsed = std::chrono::duration<double>(now - start).count();
+        progress = std::max(elapsed / budget, static_cast<double>(iter) / static_cast<double>(max_iters));
+        const double phase = (progress - phase_progress) / (1.0 - phase_progress);
+        temp = phase_temp * std::pow(final_temp / phase_temp, phase);
+        return true;
+    }
+};
+
+/**
+ * BasicSimulatedAnnealingOptimizer
+ *
+ * Annealer over copyable states with the cost, neighbor and schedule types
+ * as template parameters, so the per-iteration calls can be inlined.
+ * CostFunction is called as double(const State&), NeighborFunction as
+ * State(const State&) and TemperatureSchedule as double(double t0, iter).
+ * set_limits adds a deadline, reheats and early stopping.
+ */
+template<typename State, typename CostFunction, typename NeighborFunction,
+         typename TemperatureSchedule = GeometricSchedule>
+class BasicSimulatedAnnealingOptimizer {
+public:
+    BasicSimulatedAnnealingOptimizer(
         CostFunction cost_fn,
         NeighborFunction neighbor_fn,
         double initial_temp,
         double final_temp,
-        int max_iters,
-        TemperatureSchedule temp_schedule = default_schedule
+        uint64_t max_iters,
+        TemperatureSchedule temp_schedule = TemperatureSchedule{},
+        uint64_t seed = constants::RNG_SEED()
     )
-    : cost_fn(cost_fn),
-      neighbor_fn(neighbor_fn),
+    : cost_fn(std::move(cost_fn)),
+      neighbor_fn(std::move(neighbor_fn)),
       initial_temp(initial_temp),
       final_temp(final_temp),
       max_iters(max_iters),
-      temp_schedule(temp_schedule)
+      temp_schedule(std::move(temp_schedule)),
+      seed(seed)
     {}
 
     State optimize(const State& initial_state) {
@@ -36,53 +357,594 @@ public:
         double curr_cost = cost_fn(curr_state);
         double best_cost = curr_cost;
 
-        cost_history.push_back(curr_cost);
-
-        std::mt19937 gen(constants::RNG_SEED());
-        std::uniform_real_distribution<> dis(0.0, 1.0);
+        CostHistoryRecorder recorder(history_policy, seed);
+        recorder.record(0, curr_cost);
 
-        for (int iter = 0; iter < max_iters; ++iter) {
-            double temp = temp_schedule(initial_temp, iter);
+        const auto [t0, tf] = calibrate_temperatures(initial_temp, final_temp, limits.calibration_samples, [&]() {
+            return cost_fn(neighbor_fn(curr_state)) - curr_cost;
+        });
 
-            if (temp < final_temp)
-                break;
+        Rng gen(seed);
+        AnnealingControl<TemperatureSchedule> control(temp_schedule, t0, tf, max_iters, limits);
 
+        while (control.running(best_cost)) {
             State next_state = neighbor_fn(curr_state);
             double next_cost = cost_fn(next_state);
             double delta = next_cost - curr_cost;
+            bool improved = false;
 
-            cost_history.push_back(next_cost);
+            recorder.record(control.iteration() + 1, next_cost);
 
-            if (delta < 0 || dis(gen) < std::exp(-delta / temp)) {
-                curr_state = next_state;
+            if (delta < 0 || unit_interval(gen) < std::exp(-delta / control.temperature())) {
+                curr_state = std::move(next_state);
                 curr_cost = next_cost;
 
-                if ((curr_cost < best_cost) && abs(best_cost - curr_cost) > constants::EPSILON) {
+                if ((curr_cost < best_cost) && std::abs(best_cost - curr_cost) > constants::EPSILON) {
                     best_cost = curr_cost;
                     best_state = curr_state;
+                    improved = true;
                 }
             }
+            control.advance(improved);
         }
 
+        cost_history = recorder.take();
+        report = control.report();
         return best_state;
     }
 
+    void set_limits(const AnnealingLimits& limits) {
+        this->limits = limits;
+    }
+
+    const AnnealingReport& get_report() const {
+        return report;
+    }
+
+    void set_history_policy(const CostHistoryPolicy& policy) {
+        history_policy = policy;
+    }
+
     std::vector<double> get_cost_history() const {
+        return cost_history.values;
+    }
+
+    const CostHistory& get_history() const {
         return cost_history;
     }
 
+    CostHistory take_history() {
+        return std::move(cost_history);
+    }
+
 private:
     CostFunction cost_fn;
     NeighborFunction neighbor_fn;
     double initial_temp;
     double final_temp;
-    int max_iters;
+    uint64_t max_iters;
+    TemperatureSchedule temp_schedule;
+    uint64_t seed;
+    AnnealingLimits limits;
+    AnnealingReport report;
+    CostHistoryPolicy history_policy{CostHistoryMode::FULL};
+    CostHistory cost_history;
+};
+
+/**
+ * SimulatedAnnealingOptimizer
+ *
+ * Type-erased BasicSimulatedAnnealingOptimizer for callers that build their
+ * functions at runtime.
+ */
+template<typename State>
+class SimulatedAnnealingOptimizer
+    : public BasicSimulatedAnnealingOptimizer<
+          State,
+          std::function<double(const State&)>,
+          std::function<State(const State&)>,
+          std::function<double(double, int)>> {
+public:
+    using CostFunction = std::function<double(const State&)>;
+    using NeighborFunction = std::function<State(const State&)>;
+    using TemperatureSchedule = std::function<double(double, int)>;
+
+    SimulatedAnnealingOptimizer(
+        CostFunction cost_fn,
+        NeighborFunction neighbor_fn,
+        double initial_temp,
+        double final_temp,
+        int max_iters,
+        TemperatureSchedule temp_schedule = default_schedule
+    )
+    : BasicSimulatedAnnealingOptimizer<State, CostFunction, NeighborFunction, TemperatureSchedule>(
+          std::move(cost_fn),
+          std::move(neighbor_fn),
+          initial_temp,
+          final_temp,
+          static_cast<uint64_t>(std::max(max_iters, 0)),
+          std::move(temp_schedule))
+    {}
+
+private:
+    static double default_schedule(double t0, int iter) {
+        return t0 * std::pow(0.95, iter); // geometric cooling
+    }
+};
+
+/**
+ * BasicInPlaceSimulatedAnnealingOptimizer
+ *
+ * Annealer for problems that mutate a single current state. Chain must
+ * provide
+ *     double apply_move();    // propose, apply in place, return new cost
+ *     void undo_move();
+ *     void accept_move();
+ *     double probe_move();    // as apply_move, for calibration
+ *     void discard_move();    // revert a probe
+ *     void record_best();     // current state is the best seen so far
+ * and is held by reference, so its methods are called directly. Calibration
+ * samples moves with probe_move and discard_move before the run starts, so
+ * a chain that keeps move statistics can leave the probes out of them.
+ */
+template<typename Chain, typename TemperatureSchedule = GeometricSchedule>
+class BasicInPlaceSimulatedAnnealingOptimizer {
+public:
+    BasicInPlaceSimulatedAnnealingOptimizer(
+        Chain& chain,
+        double initial_temp,
+        double final_temp,
+        uint64_t max_iters,
+        TemperatureSchedule temp_schedule = TemperatureSchedule{},
+        uint64_t seed = constants::RNG_SEED()
+    )
+    : chain(chain),
+      initial_temp(initial_temp),
+      final_temp(final_temp),
+      max_iters(max_iters),
+      temp_schedule(std::move(temp_schedule)),
+      seed(seed)
+    {}
+
+    double optimize(double initial_cost) {
+        double curr_cost = initial_cost;
+        double best_cost = curr_cost;
+
+        CostHistoryRecorder recorder(history_policy, seed);
+        recorder.record(0, curr_cost);
+
+        const auto [t0, tf] = calibrate_temperatures(initial_temp, final_temp, limits.calibration_samples, [&]() {
+            const double delta = chain.probe_move() - curr_cost;
+            chain.discard_move();
+            return delta;
+        });
+
+        Rng gen(seed);
+        AnnealingControl<TemperatureSchedule> control(temp_schedule, t0, tf, max_iters, limits);
+
+        while (control.running(best_cost)) {
+            double next_cost = chain.apply_move();
+            double delta = next_cost - curr_cost;
+            bool improved = false;
+
+            recorder.record(control.iteration() + 1, next_cost);
+
+            if (delta < 0 || unit_interval(gen) < std::exp(-delta / control.temperature())) {
+                chain.accept_move();
+                curr_cost = next_cost;
+
+                if ((curr_cost < best_cost) && std::abs(best_cost - curr_cost) > constants::EPSILON) {
+                    best_cost = curr_cost;
+                    chain.record_best();
+                    improved = true;
+                }
+            } else {
+                chain.undo_move();
+            }
+            control.advance(improved);
+        }
+
+        cost_history = recorder.take();
+        report = control.report();
+        return best_cost;
+    }
+
+    void set_limits(const AnnealingLimits& limits) {
+        this->limits = limits;
+    }
+
+    const AnnealingReport& get_report() const {
+        return report;
+    }
+
+    void set_history_policy(const CostHistoryPolicy& policy) {
+        history_policy = policy;
+    }
+
+    std::vector<double> get_cost_history() const {
+        return cost_history.values;
+    }
+
+    const CostHistory& get_history() const {
+        return cost_history;
+    }
+
+    CostHistory take_history() {
+        return std::move(cost_history);
+    }
+
+private:
+    Chain& chain;
+    double initial_temp;
+    double final_temp;
+    uint64_t max_iters;
     TemperatureSchedule temp_schedule;
-    std::vector<double> cost_history;
+    uint64_t seed;
+    AnnealingLimits limits;
+    AnnealingReport report;
+    CostHistoryPolicy history_policy{CostHistoryMode::FULL};
+    CostHistory cost_history;
+};
 
+/**
+ * Chain made of std::function callbacks, used by
+ * InPlaceSimulatedAnnealingOptimizer.
+ */
+struct FunctionChain {
+    std::function<double()> apply_move_fn;
+    std::function<void()> undo_move_fn;
+    std::function<void()> accept_move_fn;
+    std::function<void()> record_best_fn;
+
+    double apply_move() { return apply_move_fn(); }
+    void undo_move() { undo_move_fn(); }
+    void accept_move() { accept_move_fn(); }
+    double probe_move() { return apply_move_fn(); }
+    void discard_move() { undo_move_fn(); }
+    void record_best() { record_best_fn(); }
+};
+
+/**
+ * InPlaceSimulatedAnnealingOptimizer
+ *
+ * Type-erased BasicInPlaceSimulatedAnnealingOptimizer: apply_move proposes
+ * a neighbor, applies it in place and returns the new cost; rejected moves
+ * are reverted with undo_move and accepted ones confirmed with accept_move.
+ * record_best is called whenever the current state becomes the best seen
+ * so far, so callers can snapshot only what they need.
+ */
+class InPlaceSimulatedAnnealingOptimizer {
+public:
+    using ApplyMoveFunction = std::function<double()>;
+    using UndoMoveFunction = std::function<void()>;
+    using AcceptMoveFunction = std::function<void()>;
+    using RecordBestFunction = std::function<void()>;
+    using TemperatureSchedule = std::function<double(double, int)>;
+
+    InPlaceSimulatedAnnealingOptimizer(
+        ApplyMoveFunction apply_move_fn,
+        UndoMoveFunction undo_move_fn,
+        AcceptMoveFunction accept_move_fn,
+        RecordBestFunction record_best_fn,
+        double initial_temp,
+        double final_temp,
+        int max_iters,
+        TemperatureSchedule temp_schedule = default_schedule,
+        uint64_t seed = constants::RNG_SEED()
+    )
+    : chain{std::move(apply_move_fn), std::move(undo_move_fn), std::move(accept_move_fn), std::move(record_best_fn)},
+      optimizer(chain, initial_temp, final_temp, static_cast<uint64_t>(std::max(max_iters, 0)),
+                std::move(temp_schedule), seed)
+    {}
+
+    InPlaceSimulatedAnnealingOptimizer(const InPlaceSimulatedAnnealingOptimizer&) = delete;
+    InPlaceSimulatedAnnealingOptimizer& operator=(const InPlaceSimulatedAnnealingOptimizer&) = delete;
+
+    double optimize(double initial_cost) {
+        return optimizer.optimize(initial_cost);
+    }
+
+    std::vector<double> get_cost_history() const {
+        return optimizer.get_cost_history();
+    }
+
+private:
+    FunctionChain chain;
+    BasicInPlaceSimulatedAnnealingOptimizer<FunctionChain, TemperatureSchedule> optimizer;
+
+public:
     static double default_schedule(double t0, int iter) {
         return t0 * std::pow(0.95, iter); // geometric cooling
     }
 };
 
+/**
+ * ParallelTemperingOptimizer
+ *
+ * Replica exchange: every replica is a chain held at a fixed temperature of
+ * a geometric ladder from final_temp (coldest) to initial_temp (hottest).
+ * Replicas advance swap_interval iterations at a time on up to num_threads
+ * threads; in between, neighbouring temperatures exchange their chains with
+ * the Metropolis criterion. Exchanges only permute temperatures, so no
+ * state is copied.
+ *
+ * Replica must provide
+ *     double cost() const;
+ *     double apply_move();    // propose, apply in place, return new cost
+ *     void undo_move();
+ *     void accept_move();
+ *     double probe_move();    // as apply_move, for calibration
+ *     void discard_move();    // revert a probe
+ *     void record_best();     // current state is the best this chain has seen
+ * and own its own random source for proposals. Each replica is only touched
+ * by one thread at a time, and results do not depend on num_threads.
+ *
+ * AnnealingLimits are checked at every exchange, where on_progress reports
+ * the coldest temperature. Calibration probes moves of the first replica to set
+ * the ends of the ladder. Replicas are never reheated; the hot end of the
+ * ladder keeps exploring instead.
+ */
+template<typename Replica>
+class ParallelTemperingOptimizer {
+public:
+    ParallelTemperingOptimizer(
+        std::vector<Replica*> replicas,
+        double initial_temp,
+        double final_temp,
+        uint64_t max_iters,
+        uint64_t swap_interval,
+        size_t num_threads,
+        uint64_t seed
+    )
+    : replicas(replicas),
+      initial_temp(initial_temp),
+      final_temp(final_temp),
+      max_iters(max_iters),
+      swap_interval(std::max<uint64_t>(swap_interval, 1)),
+      num_threads(std::max<size_t>(std::min(num_threads, replicas.size()), 1)),
+      seed(seed)
+    {
+        const size_t count = replicas.size();
+        build_ladder(initial_temp, final_temp);
+        replica_at.resize(count);
+        slot_of.resize(count);
+        for (size_t k = 0; k < count; ++k) {
+            replica_at[k] = k;
+            slot_of[k] = k;
+        }
+    }
+
+    /**
+     * Runs every replica for up to max_iters iterations and returns the
+     * index of the replica holding the best state seen by any chain.
+     */
+    size_t optimize() {
+        const size_t count = replicas.size();
+        curr_costs.resize(count);
+        best_costs.resize(count);
+        acceptance_gens.clear();
+        for (size_t r = 0; r < count; ++r) {
+            curr_costs[r] = replicas[r]->cost();
+            best_costs[r] = curr_costs[r];
+            acceptance_gens.emplace_back(stream_seed(seed, {r, ACCEPTANCE_STREAM}));
+        }
+        CostHistoryRecorder recorder(history_policy, seed);
+        recorder.record(0, curr_costs[replica_at[0]]);
+
+        double t0 = initial_temp;
+        double tf = final_temp;
+        if (limits.calibration_samples > 0 && count > 0) {
+            Replica& sampled = *replicas[0];
+            std::tie(t0, tf) = calibrate_temperatures(t0, tf, limits.calibration_samples, [&]() {
+                const double delta = sampled.probe_move() - curr_costs[0];
+                sampled.discard_move();
+                return delta;
+            });
+            build_ladder(t0, tf);
+        }
+        report = AnnealingReport{0, 0, AnnealingStop::ITERATIONS, t0, tf};
+
+        double best_cost = *std::min_element(best_costs.begin(), best_costs.end());
+        uint64_t last_improvement = 0;
+        bool stopped = false;
+        auto check_limits = [&](uint64_t done) {
+            const double epoch_best = *std::min_element(best_costs.begin(), best_costs.end());
+            if (epoch_best < best_cost && std::abs(best_cost - epoch_best) > constants::EPSILON) {
+                best_cost = epoch_best;
+                last_improvement = done;
+            }
+            report.iterations = done;
+            if (limits.on_progress) {
+                limits.on_progress(AnnealingProgress{done, best_cost, temperatures.front()});
+            }
+            if (limits.cancelled && limits.cancelled->load(std::memory_order_relaxed)) {
+                report.stop = AnnealingStop::CANCELLED;
+            } else if (best_cost <= limits.lower_bound + constants::EPSILON) {
+                report.stop = AnnealingStop::LOWER_BOUND;
+            } else if (AnnealingLimits::Clock::now() >= limits.deadline) {
+                report.stop = AnnealingStop::DEADLINE;
+            } else if (limits.plateau_iters > 0 && done - last_improvement >= limits.plateau_iters) {
+                report.stop = AnnealingStop::PLATEAU;
+            } else {
+                return;
+            }
+            stopped = true;
+        };
+
+        Rng exchange_gen(stream_seed(seed, {EXCHANGE_STREAM}));
+        const uint64_t epochs = (max_iters + swap_interval - 1) / swap_interval;
+        std::vector<std::exception_ptr> errors(num_threads);
+        bool failed = false;
+        Barrier barrier(num_threads);
+        check_limits(0);
+
+        auto exchange = [&](uint64_t epoch) {
+            for (size_t k = epoch % 2; k + 1 < count; k += 2) {
+                const size_t cold = replica_at[k];
+                const size_t hot = replica_at[k + 1];
+                const double exponent = (curr_costs[cold] - curr_costs[hot])
+                    * (1.0 / temperatures[k] - 1.0 / temperatures[k + 1]);
+                ++swap_attempts;
+                if (exponent >= 0 || unit_interval(exchange_gen) < std::exp(exponent)) {
+                    std::swap(replica_at[k], replica_at[k + 1]);
+                    slot_of[replica_at[k]] = k;
+                    slot_of[replica_at[k + 1]] = k + 1;
+                    ++swaps_accepted;
+                }
+            }
+            const uint64_t done = std::min((epoch + 1) * swap_interval, max_iters);
+            recorder.record(done, curr_costs[replica_at[0]]);
+            check_limits(done);
+        };
+
+        auto worker = [&](size_t thread_index) {
+            for (uint64_t epoch = 0; epoch < epochs && !stopped; ++epoch) {
+                const uint64_t first = epoch * swap_interval;
+                const uint64_t iters = std::min(swap_interval, max_iters - first);
+                if (!failed) {
+                    try {
+                        for (size_t r = thread_index; r < count; r += num_threads) {
+                            run_chain(r, iters);
+                        }
+                    } catch (...) {
+                        errors[thread_index] = std::current_exception();
+                    }
+                }
+                barrier.arrive_and_wait([&]() {
+                    for (const auto& error : errors) {
+                        failed = failed || static_cast<bool>(error);
+                    }
+                    if (failed) {
+                        stopped = true;
+                    } else {
+                        exchange(epoch);
+                    }
+                });
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+        for (size_t t = 1; t < num_threads; ++t) {
+            threads.emplace_back(worker, t);
+        }
+        worker(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        size_t best_replica = 0;
+        for (size_t r = 1; r < count; ++r) {
+            if (best_costs[r] < best_costs[best_replica]) {
+                best_replica = r;
+            }
+        }
+        cost_history = recorder.take();
+        return best_replica;
+    }
+
+    double get_best_cost(size_t replica) const {
+        return best_costs[replica];
+    }
+
+    void set_limits(const AnnealingLimits& limits) {
+        this->limits = limits;
+    }
+
+    const AnnealingReport& get_report() const {
+        return report;
+    }
+
+    void set_history_policy(const CostHistoryPolicy& policy) {
+        history_policy = policy;
+    }
+
+    std::vector<double> get_cost_history() const {
+        return cost_history.values;
+    }
+
+    const CostHistory& get_history() const {
+        return cost_history;
+    }
+
+    CostHistory take_history() {
+        return std::move(cost_history);
+    }
+
+    uint64_t get_swap_attempts() const {
+        return swap_attempts;
+    }
+
+    uint64_t get_swaps_accepted() const {
+        return swaps_accepted;
+    }
+
+private:
+    // Paths under seed of the random streams the optimizer draws from.
+    static constexpr uint64_t ACCEPTANCE_STREAM = 1;
+    static constexpr uint64_t EXCHANGE_STREAM = 2;
+
+    std::vector<Replica*> replicas;
+    double initial_temp;
+    double final_temp;
+    uint64_t max_iters;
+    uint64_t swap_interval;
+    size_t num_threads;
+    uint64_t seed;
+    std::vector<double> temperatures;
+    std::vector<size_t> replica_at;  // temperature slot -> replica
+    std::vector<size_t> slot_of;     // replica -> temperature slot
+    std::vector<double> curr_costs;
+    std::vector<double> best_costs;
+    std::vector<Rng> acceptance_gens;
+    AnnealingLimits limits;
+    AnnealingReport report;
+    CostHistoryPolicy history_policy{CostHistoryMode::FULL};
+    CostHistory cost_history;  // cost at the coldest slot after each exchange
+    uint64_t swap_attempts = 0;
+    uint64_t swaps_accepted = 0;
+
+    void build_ladder(double hottest, double coldest) {
+        const size_t count = replicas.size();
+        temperatures.resize(count);
+        for (size_t k = 0; k < count; ++k) {
+            double fraction = count > 1 ? static_cast<double>(k) / static_cast<double>(count - 1) : 1.0;
+            temperatures[k] = coldest * std::pow(hottest / coldest, fraction);
+        }
+    }
+
+    void run_chain(size_t r, uint64_t iters) {
+        Replica& replica = *replicas[r];
+        Rng& gen = acceptance_gens[r];
+        const double temp = temperatures[slot_of[r]];
+        double curr_cost = curr_costs[r];
+        double best_cost = best_costs[r];
+
+        for (uint64_t iter = 0; iter < iters; ++iter) {
+            double next_cost = replica.apply_move();
+            double delta = next_cost - curr_cost;
+
+            if (delta < 0 || unit_interval(gen) < std::exp(-delta / temp)) {
+                replica.accept_move();
+                curr_cost = next_cost;
+
+                if ((curr_cost < best_cost) && std::abs(best_cost - curr_cost) > constants::EPSILON) {
+                    best_cost = curr_cost;
+                    replica.record_best();
+                }
+            } else {
+                replica.undo_move();
+            }
+        }
+
+        curr_costs[r] = curr_cost;
+        best_costs[r] = best_cost;
+    }
+};
+
 #endif
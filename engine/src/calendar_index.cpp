@@ -0,0 +1,74 @@
+#include "calendar_index.hpp"
+
+#include "constants.hpp"
+
+#include <algorithm>
+
+CalendarIndex::CalendarIndex(const ProblemTable& problem, const Placement& placement) {
+    const size_t n = problem.size();
+    if (n == 0) {
+        buckets.resize(1);
+        return;
+    }
+
+    sec_t low = problem.window_low[0];
+    sec_t high = problem.window_high[0];
+    for (job_index_t i = 0; i < n; ++i) {
+        low = std::min(low, problem.window_low[i]);
+        high = std::max(high, problem.window_high[i]);
+        for (const TimeRange* range = placement.begin(i); range != placement.end(i); ++range) {
+            low = std::min(low, range->get_low());
+            high = std::max(high, range->get_high());
+        }
+    }
+
+    // Align to midnight so buckets match calendar days.
+    origin = low - low % constants::DAY;
+    const sec_t days = (high - origin) / constants::DAY + 1;
+    const sec_t days_per_bucket = (days + MAX_BUCKETS - 1) / MAX_BUCKETS;
+    bucket_width = constants::DAY * days_per_bucket;
+    buckets.resize((high - origin) / bucket_width + 1);
+
+    for (job_index_t i = 0; i < n; ++i) {
+        insert(i, placement.begin(i), placement.count(i));
+    }
+}
+
+size_t CalendarIndex::bucket_count() const {
+    return buckets.size();
+}
+
+uint32_t CalendarIndex::bucket_of(sec_t time) const {
+    if (time < origin) {
+        return 0;
+    }
+    const sec_t index = (time - origin) / bucket_width;
+    return static_cast<uint32_t>(std::min<sec_t>(index, buckets.size() - 1));
+}
+
+const std::vector<CalendarEntry>& CalendarIndex::bucket(uint32_t index) const {
+    return buckets[index];
+}
+
+void CalendarIndex::insert(job_index_t job, const TimeRange* ranges, uint32_t count) {
+    for (uint32_t k = 0; k < count; ++k) {
+        const uint32_t last = bucket_of(ranges[k].get_high());
+        for (uint32_t b = bucket_of(ranges[k].get_low()); b <= last; ++b) {
+            buckets[b].push_back(CalendarEntry{job, k});
+        }
+    }
+}
+
+void CalendarIndex::remove(job_index_t job, const TimeRange* ranges, uint32_t count) {
+    for (uint32_t k = 0; k < count; ++k) {
+        const uint32_t last = bucket_of(ranges[k].get_high());
+        for (uint32_t b = bucket_of(ranges[k].get_low()); b <= last; ++b) {
+            std::vector<CalendarEntry>& entries = buckets[b];
+            entries.erase(
+                std::remove_if(entries.begin(), entries.end(), [job](const CalendarEntry& entry) {
+                    return entry.job == job;
+                }),
+                entries.end());
+        }
+    }
+}
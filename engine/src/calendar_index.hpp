@@ -0,0 +1,48 @@
+#ifndef ELASTISCHED_CALENDAR_INDEX_HPP
+#define ELASTISCHED_CALENDAR_INDEX_HPP
+
+#include "problem_table.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct CalendarEntry {
+    job_index_t job;
+    uint32_t segment;
+};
+
+/**
+ * CalendarIndex
+ *
+ * Day buckets over the horizon of a problem. Every placed segment is listed
+ * (as job and segment index) in each bucket it touches, and a bucket is
+ * found from a time in O(1). The index is built once per solve and kept in
+ * sync with a Placement through insert and remove as jobs move.
+ *
+ * Buckets are one day wide unless the horizon would need more than
+ * MAX_BUCKETS of them, in which case they widen. Times outside the horizon
+ * fall into the first or last bucket, so positions are never rejected.
+ */
+class CalendarIndex {
+public:
+    static constexpr size_t MAX_BUCKETS = 1 << 16;
+
+    CalendarIndex() = default;
+    CalendarIndex(const ProblemTable& problem, const Placement& placement);
+
+    size_t bucket_count() const;
+    uint32_t bucket_of(sec_t time) const;
+    const std::vector<CalendarEntry>& bucket(uint32_t index) const;
+
+    void insert(job_index_t job, const TimeRange* ranges, uint32_t count);
+    void remove(job_index_t job, const TimeRange* ranges, uint32_t count);
+
+private:
+    sec_t origin = 0;
+    sec_t bucket_width = 1;
+    std::vector<std::vector<CalendarEntry>> buckets;
+};
+
+#endif // ELASTISCHED_CALENDAR_INDEX_HPP
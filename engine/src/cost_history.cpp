@@ -0,0 +1,180 @@
+#include "cost_history.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+size_t CostHistory::size() const {
+    return values.size();
+}
+
+bool CostHistory::empty() const {
+    return values.empty();
+}
+
+CostHistoryRecorder::CostHistoryRecorder(CostHistoryPolicy policy, uint64_t seed)
+    : policy(policy), gen(seed) {
+    this->policy.interval = std::max<uint64_t>(policy.interval, 1);
+    this->policy.capacity = std::max<size_t>(policy.capacity, 2);
+}
+
+void CostHistoryRecorder::record(uint64_t iteration, double cost) {
+    has_last = true;
+    last_iteration = iteration;
+    last_cost = cost;
+
+    switch (policy.mode) {
+    case CostHistoryMode::OFF:
+        return;
+    case CostHistoryMode::FULL:
+        history.iterations.push_back(iteration);
+        history.values.push_back(cost);
+        return;
+    case CostHistoryMode::EVERY_NTH:
+        if (iteration % policy.interval == 0) {
+            history.iterations.push_back(iteration);
+            history.values.push_back(cost);
+        }
+        return;
+    case CostHistoryMode::RESERVOIR: {
+        // Algorithm R: the k-th sample replaces a random slot with
+        // probability capacity / k.
+        ++seen;
+        if (history.size() < policy.capacity) {
+            history.iterations.push_back(iteration);
+            history.values.push_back(cost);
+            return;
+        }
+        std::uniform_int_distribution<uint64_t> slot(0, seen - 1);
+        const uint64_t k = slot(gen);
+        if (k < policy.capacity) {
+            history.iterations[k] = iteration;
+            history.values[k] = cost;
+        }
+        return;
+    }
+    case CostHistoryMode::BUCKETS:
+        if (buckets.empty() || buckets.back().count == bucket_width) {
+            if (buckets.size() == policy.capacity) {
+                // Full: pair up neighbours and double the width.
+                size_t merged = 0;
+                for (size_t b = 0; b < buckets.size(); b += 2, ++merged) {
+                    Bucket combined = buckets[b];
+                    if (b + 1 < buckets.size()) {
+                        const Bucket& right = buckets[b + 1];
+                        combined.count += right.count;
+                        combined.sum += right.sum;
+                        combined.min = std::min(combined.min, right.min);
+                        combined.max = std::max(combined.max, right.max);
+                    }
+                    buckets[merged] = combined;
+                }
+                buckets.resize(merged);
+                bucket_width *= 2;
+            }
+            if (buckets.empty() || buckets.back().count == bucket_width) {
+                buckets.push_back(Bucket{iteration, 0, 0.0, cost, cost});
+            }
+        }
+        Bucket& bucket = buckets.back();
+        ++bucket.count;
+        bucket.sum += cost;
+        bucket.min = std::min(bucket.min, cost);
+        bucket.max = std::max(bucket.max, cost);
+        return;
+    }
+}
+
+CostHistory CostHistoryRecorder::take() {
+    switch (policy.mode) {
+    case CostHistoryMode::OFF:
+    case CostHistoryMode::FULL:
+        break;
+    case CostHistoryMode::EVERY_NTH:
+        if (has_last && (history.empty() || history.iterations.back() != last_iteration)) {
+            history.iterations.push_back(last_iteration);
+            history.values.push_back(last_cost);
+        }
+        break;
+    case CostHistoryMode::RESERVOIR: {
+        std::vector<size_t> order(history.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return history.iterations[a] < history.iterations[b];
+        });
+        CostHistory sorted;
+        sorted.iterations.reserve(order.size() + 1);
+        sorted.values.reserve(order.size() + 1);
+        for (size_t k : order) {
+            sorted.iterations.push_back(history.iterations[k]);
+            sorted.values.push_back(history.values[k]);
+        }
+        if (has_last && (sorted.empty() || sorted.iterations.back() != last_iteration)) {
+            sorted.iterations.push_back(last_iteration);
+            sorted.values.push_back(last_cost);
+        }
+        history = std::move(sorted);
+        break;
+    }
+    case CostHistoryMode::BUCKETS:
+        history.iterations.reserve(buckets.size());
+        history.values.reserve(buckets.size());
+        history.min.reserve(buckets.size());
+        history.max.reserve(buckets.size());
+        for (const Bucket& bucket : buckets) {
+            history.iterations.push_back(bucket.first_iteration);
+            history.values.push_back(bucket.sum / static_cast<double>(bucket.count));
+            history.min.push_back(bucket.min);
+            history.max.push_back(bucket.max);
+        }
+        buckets.clear();
+        break;
+    }
+
+    CostHistory result = std::move(history);
+    history = CostHistory{};
+    bucket_width = 1;
+    seen = 0;
+    has_last = false;
+    return result;
+}
+
+void decimate(CostHistory& history, const CostHistoryPolicy& policy) {
+    const size_t capacity = std::max<size_t>(policy.capacity, 2);
+    if (history.size() <= capacity) {
+        return;
+    }
+
+    if (policy.mode == CostHistoryMode::BUCKETS) {
+        const bool has_bounds = history.min.size() == history.size();
+        while (history.size() > capacity) {
+            size_t merged = 0;
+            for (size_t b = 0; b < history.size(); b += 2, ++merged) {
+                const size_t right = std::min(b + 1, history.size() - 1);
+                history.iterations[merged] = history.iterations[b];
+                history.values[merged] = (history.values[b] + history.values[right]) / 2.0;
+                if (has_bounds) {
+                    history.min[merged] = std::min(history.min[b], history.min[right]);
+                    history.max[merged] = std::max(history.max[b], history.max[right]);
+                }
+            }
+            history.iterations.resize(merged);
+            history.values.resize(merged);
+            if (has_bounds) {
+                history.min.resize(merged);
+                history.max.resize(merged);
+            }
+        }
+    } else if (policy.mode == CostHistoryMode::RESERVOIR) {
+        const size_t last = history.size() - 1;
+        CostHistory thinned;
+        thinned.iterations.reserve(capacity);
+        thinned.values.reserve(capacity);
+        for (size_t k = 0; k < capacity; ++k) {
+            const size_t source = k * last / (capacity - 1);
+            thinned.iterations.push_back(history.iterations[source]);
+            thinned.values.push_back(history.values[source]);
+        }
+        history = std::move(thinned);
+    }
+}
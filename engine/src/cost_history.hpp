@@ -0,0 +1,94 @@
+#ifndef ELASTISCHED_COST_HISTORY_HPP
+#define ELASTISCHED_COST_HISTORY_HPP
+
+#include "rng.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class CostHistoryMode : uint8_t {
+    OFF,        // record nothing
+    FULL,       // every iteration
+    EVERY_NTH,  // iterations that are multiples of interval, plus the last
+    RESERVOIR,  // a uniform sample of capacity iterations, plus the last
+    BUCKETS     // min/mean/max over at most capacity equal-width buckets
+};
+
+/**
+ * CostHistoryPolicy
+ *
+ * How much of an optimizer's cost trace to keep. Only FULL grows with the
+ * number of iterations; every other mode is bounded by interval or
+ * capacity. Runs no longer than capacity keep every iteration in BUCKETS
+ * mode, since each bucket then holds a single cost.
+ */
+struct CostHistoryPolicy {
+    CostHistoryMode mode = CostHistoryMode::BUCKETS;
+    uint64_t interval = 1;
+    size_t capacity = 1024;
+};
+
+/**
+ * CostHistory
+ *
+ * Recorded samples in iteration order. iterations holds the iteration of
+ * each sample, or the first iteration of each bucket; values holds the
+ * sampled cost, or the bucket mean. min and max are filled in BUCKETS mode
+ * only.
+ */
+struct CostHistory {
+    std::vector<uint64_t> iterations;
+    std::vector<double> values;
+    std::vector<double> min;
+    std::vector<double> max;
+
+    size_t size() const;
+    bool empty() const;
+};
+
+/**
+ * CostHistoryRecorder
+ *
+ * Applies a CostHistoryPolicy to a stream of (iteration, cost) samples with
+ * non-decreasing iterations. RESERVOIR draws from its own generator, so the
+ * kept iterations depend only on the seed and the number of samples.
+ */
+class CostHistoryRecorder {
+public:
+    explicit CostHistoryRecorder(CostHistoryPolicy policy = CostHistoryPolicy{}, uint64_t seed = 0);
+
+    void record(uint64_t iteration, double cost);
+
+    // Finalizes and hands over the history; the recorder is empty afterwards.
+    CostHistory take();
+
+private:
+    struct Bucket {
+        uint64_t first_iteration;
+        uint64_t count;
+        double sum;
+        double min;
+        double max;
+    };
+
+    CostHistoryPolicy policy;
+    CostHistory history;
+    std::vector<Bucket> buckets;
+    uint64_t bucket_width = 1;
+    uint64_t seen = 0;
+    Rng gen;
+    bool has_last = false;
+    uint64_t last_iteration = 0;
+    double last_cost = 0.0;
+};
+
+/**
+ * Shrinks a history that outgrew its policy, e.g. after histories of
+ * several optimizers were combined. BUCKETS merges neighbouring buckets,
+ * RESERVOIR keeps evenly spaced samples and the last one; other modes are
+ * left alone.
+ */
+void decimate(CostHistory& history, const CostHistoryPolicy& policy);
+
+#endif // ELASTISCHED_COST_HISTORY_HPP
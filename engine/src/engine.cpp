@@ -1,44 +1,37 @@
 #include "engine.hpp"
 
 #include "constants.hpp"
+#include "cost_history.hpp"
+#include "feasibility.hpp"
+#include "greedy_placement.hpp"
+#include "incremental_cost.hpp"
+#include "move_library.hpp"
+#include "parallel.hpp"
 #include "policy.hpp"
+#include "problem_table.hpp"
 #include "optimizer.hpp"
+#include "rng.hpp"
+#include "solve_handle.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <functional>
 #include <iostream>
-#include <optional>
-#include <queue>
+#include <limits>
+#include <memory>
 #include <random>
 #include <set>
+#include <stdexcept>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 namespace {
 
-template<typename T>
-std::optional<T> safe_min(std::optional<T> u, std::optional<T> v) {
-    if (u.has_value() && v.has_value()) {
-        return (u.value() < v.value() ? u : v);
-    } else if (u.has_value()) {
-        return u;
-    } else if (v.has_value()) {
-        return v;
-    }
-    return std::nullopt;
-}
-
-template<typename T>
-std::optional<T> safe_max(std::optional<T> u, std::optional<T> v) {
-    if (u.has_value() && v.has_value()) {
-        return (u.value() > v.value() ? u : v);
-    } else if (u.has_value()) {
-        return u;
-    } else if (v.has_value()) {
-        return v;
-    }
-    return std::nullopt;
-}
+using Clock = AnnealingLimits::Clock;
 
 std::vector<TimeRange> get_job_scheduled_ranges(const Job& job) {
     if (!job.scheduled_time_ranges.empty()) {
@@ -47,260 +40,694 @@ std::vector<TimeRange> get_job_scheduled_ranges(const Job& job) {
     return {job.scheduled_time_range};
 }
 
-std::vector<std::vector<Job>> get_disjoint_intervals(std::vector<Job> jobs) {
-    if (jobs.empty()) {
-        return {};
+/**
+ * Groups of jobs that can never interact. The components are ordered by
+ * time: every job of component c lies entirely before every job of
+ * component c + 1.
+ */
+struct ProblemPartition {
+    std::vector<std::vector<job_index_t>> components;
+    std::vector<uint32_t> component_of;
+    std::vector<job_index_t> local_index;
+};
+
+ProblemPartition get_disjoint_intervals(const ProblemTable& problem) {
+    ProblemPartition partition;
+    const size_t n = problem.size();
+    if (n == 0) {
+        return partition;
     }
 
-    std::vector<std::vector<Job>> disjoint_intervals;
+    // A job can only ever occupy its schedulable range or its initial
+    // placement, and a rigid job only its placement. Zero-length ranges are
+    // widened by one so that a point touching the next component still
+    // lands in the same one.
+    auto widened_high = [](const TimeRange& range) {
+        return range.get_high() == range.get_low() ? range.get_high() + 1 : range.get_high();
+    };
+    std::vector<sec_t> envelope_low(n);
+    std::vector<sec_t> envelope_high(n);
+    for (job_index_t i = 0; i < n; ++i) {
+        if (problem.rigid[i]) {
+            envelope_low[i] = std::numeric_limits<sec_t>::max();
+            envelope_high[i] = std::numeric_limits<sec_t>::min();
+        } else {
+            envelope_low[i] = problem.window_low[i];
+            envelope_high[i] = widened_high(problem.window(i));
+        }
+        for (uint32_t k = problem.segment_offsets[i]; k < problem.segment_offsets[i + 1]; ++k) {
+            envelope_low[i] = std::min(envelope_low[i], problem.segments[k].get_low());
+            envelope_high[i] = std::max(envelope_high[i], widened_high(problem.segments[k]));
+        }
+    }
 
-    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
-        return a.schedulable_time_range.get_low() < b.schedulable_time_range.get_low();
+    std::vector<job_index_t> order(n);
+    for (job_index_t i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&envelope_low](job_index_t a, job_index_t b) {
+        return envelope_low[a] < envelope_low[b];
     });
 
-    sec_t curr_end = jobs[0].schedulable_time_range.get_high();
-    disjoint_intervals.push_back({jobs[0]});
-
-    for (size_t i = 1; i < jobs.size(); ++i) {
-        auto& job = jobs[i];
+    partition.component_of.resize(n);
+    partition.local_index.resize(n);
+    sec_t curr_end = envelope_high[order[0]];
+    partition.components.push_back({});
 
-        if (job.schedulable_time_range.get_low() >= curr_end) {
-            disjoint_intervals.push_back({job});
-            curr_end = disjoint_intervals.back().back().schedulable_time_range.get_high();
-        } else {
-            disjoint_intervals.back().push_back(std::move(job));
-            curr_end = std::max(curr_end, disjoint_intervals.back().back().schedulable_time_range.get_high());
+    for (job_index_t job : order) {
+        if (envelope_low[job] >= curr_end && !partition.components.back().empty()) {
+            partition.components.push_back({});
         }
+        curr_end = std::max(curr_end, envelope_high[job]);
+        partition.component_of[job] = static_cast<uint32_t>(partition.components.size() - 1);
+        partition.local_index[job] = static_cast<job_index_t>(partition.components.back().size());
+        partition.components.back().push_back(job);
     }
 
-    return disjoint_intervals;
+    return partition;
 }
 
-TimeRange generate_random_time_range_within(
-    const TimeRange& schedulable_time_range,
-    sec_t duration,
-    sec_t granularity,
-    std::mt19937& gen)
-{
-    sec_t earliest_start = ((schedulable_time_range.get_low() + granularity - 1) / granularity) * granularity;
-    sec_t raw_latest_start = schedulable_time_range.get_high() - duration;
-    sec_t latest_start = (raw_latest_start / granularity) * granularity;
+/**
+ * Dependencies between components are fixed by the component order alone:
+ * an upstream job in an earlier component always ends before its dependent
+ * starts, and one in a later component never does.
+ */
+bool has_cross_component_violation(const ProblemTable& problem, const ProblemPartition& partition) {
+    for (job_index_t job = 0; job < problem.size(); ++job) {
+        for (uint32_t k = problem.predecessor_offsets[job]; k < problem.predecessor_offsets[job + 1]; ++k) {
+            if (partition.component_of[problem.predecessor_indices[k]] > partition.component_of[job]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
 
-    if (latest_start < earliest_start) {
-        throw std::invalid_argument("Schedulable timerange too small for the job duration");
+struct ComponentResult {
+    Placement best;
+    CostHistory cost_history;
+    std::vector<MoveStats> move_stats;
+    SolveStats stats;
+};
+
+// Random streams of a component, by purpose; see stream_seed.
+enum ComponentStream : uint64_t {
+    CHAIN_MOVES,
+    CHAIN_ACCEPTANCE,
+    REPLICA_MOVES,
+    TEMPERING,
+};
+
+/**
+ * AnnealingChain
+ *
+ * One annealing chain: its own placement, cost model, move library
+ * and best placement. Chains are not movable because the cost model keeps
+ * a reference to the placement.
+ */
+struct AnnealingChain {
+    Placement current;
+    IncrementalScheduleCost cost_model;
+    MoveLibrary moves;
+    Placement best;
+    Rng gen;
+
+    AnnealingChain(
+        const ProblemTable& problem,
+        const std::vector<job_index_t>& flexible_indices,
+        const Placement& initial,
+        bool adaptive_moves,
+        uint64_t seed)
+        : current(initial),
+          cost_model(problem, current),
+          moves(problem, flexible_indices, current, cost_model, adaptive_moves),
+          best(current),
+          gen(seed) {}
+
+    AnnealingChain(const AnnealingChain&) = delete;
+    AnnealingChain& operator=(const AnnealingChain&) = delete;
+
+    double cost() const {
+        return cost_model.cost();
     }
 
-    size_t num_slots = (latest_start - earliest_start) / granularity + 1;
+    double apply_move() {
+        return moves.apply(gen);
+    }
 
-    std::uniform_int_distribution<size_t> dis(0, num_slots - 1);
-    size_t random_slot = dis(gen);
+    void undo_move() {
+        moves.undo();
+    }
 
-    sec_t start = earliest_start + random_slot * granularity;
-    return TimeRange(start, start + duration);
-}
+    void accept_move() {
+        moves.accept();
+    }
+
+    double probe_move() {
+        return moves.probe(gen);
+    }
+
+    void discard_move() {
+        moves.discard();
+    }
 
-bool ranges_overlap(const TimeRange& candidate, const std::vector<TimeRange>& ranges) {
-    for (const auto& range : ranges) {
-        if (candidate.overlaps(range)) {
-            return true;
+    void record_best() {
+        best = current;
+    }
+};
+
+/**
+ * Rigid jobs never move, so the cost of the rigid jobs on their own is a
+ * lower bound on the cost of any placement of the problem.
+ */
+double rigid_cost_lower_bound(const ProblemTable& problem) {
+    std::vector<job_index_t> members;
+    std::vector<job_index_t> local_index(problem.size(), 0);
+    for (job_index_t i = 0; i < problem.size(); ++i) {
+        if (problem.rigid[i]) {
+            local_index[i] = static_cast<job_index_t>(members.size());
+            members.push_back(i);
         }
     }
-    return false;
+    if (members.empty()) {
+        return 0.0;
+    }
+    const ProblemTable rigid = extract_subproblem(problem, members, local_index);
+    Placement placement(rigid);
+    return IncrementalScheduleCost(rigid, placement).cost();
 }
 
-std::vector<sec_t> generate_split_durations(
-    sec_t duration,
-    size_t segment_count,
-    sec_t min_split_duration,
-    sec_t granularity,
-    bool round_to_granularity,
-    std::mt19937& gen
+ComponentResult solve_component_tempering(
+    const ProblemTable& problem,
+    const EngineConfig& config,
+    const AnnealingLimits& limits,
+    const std::vector<job_index_t>& flexible_indices,
+    const Placement& initial,
+    size_t num_threads,
+    uint64_t base_seed,
+    size_t component,
+    SolveMonitor* monitor
 ) {
-    if (segment_count <= 1) {
-        return {duration};
+    const size_t num_replicas = static_cast<size_t>(config.num_replicas);
+    std::vector<std::unique_ptr<AnnealingChain>> replicas;
+    std::vector<AnnealingChain*> chains;
+    replicas.reserve(num_replicas);
+    chains.reserve(num_replicas);
+    for (size_t r = 0; r < num_replicas; ++r) {
+        const uint64_t seed = stream_seed(base_seed, {component, REPLICA_MOVES, r});
+        replicas.push_back(
+            std::make_unique<AnnealingChain>(problem, flexible_indices, initial, config.adaptive_moves, seed));
+        chains.push_back(replicas.back().get());
     }
 
-    sec_t unit = 1;
-    if (round_to_granularity && granularity > 0 && duration % granularity == 0) {
-        unit = granularity;
+    ParallelTemperingOptimizer<AnnealingChain> optimizer(
+        chains,
+        config.initial_temp,
+        config.final_temp,
+        config.num_iters,
+        config.swap_interval,
+        num_threads,
+        stream_seed(base_seed, {component, TEMPERING})
+    );
+    optimizer.set_history_policy(config.cost_history);
+    auto best_replica_of = [&optimizer, num_replicas]() {
+        size_t best = 0;
+        for (size_t r = 1; r < num_replicas; ++r) {
+            if (optimizer.get_best_cost(r) < optimizer.get_best_cost(best)) {
+                best = r;
+            }
+        }
+        return best;
+    };
+    if (monitor) {
+        AnnealingLimits monitored = limits;
+        monitored.on_progress = [&](const AnnealingProgress& progress) {
+            if (monitor->report_due(component)) {
+                monitor->report(component, replicas[best_replica_of()]->best, progress, false);
+            }
+        };
+        optimizer.set_limits(monitored);
     } else {
-        round_to_granularity = false;
+        optimizer.set_limits(limits);
     }
 
-    sec_t min_split = min_split_duration > 0 ? min_split_duration : 1;
-    if (round_to_granularity && unit > 1) {
-        min_split = ((min_split + unit - 1) / unit) * unit;
+    SolveStats stats;
+    size_t best_replica = 0;
+    {
+        PhaseTimer timer(stats.anneal_seconds);
+        best_replica = optimizer.optimize();
+    }
+    if (monitor) {
+        const AnnealingReport& report = optimizer.get_report();
+        monitor->report(component, replicas[best_replica]->best,
+                        AnnealingProgress{report.iterations, optimizer.get_best_cost(best_replica), report.final_temp},
+                        true);
     }
+    std::vector<std::vector<MoveStats>> move_stats;
+    for (const auto& replica : replicas) {
+        move_stats.push_back(replica->moves.stats());
+        stats.merge(replica->moves.solve_stats());
+    }
+    return ComponentResult{
+        std::move(replicas[best_replica]->best), optimizer.take_history(), merge_move_stats(move_stats), stats};
+}
 
-    if (min_split * segment_count > duration) {
-        return {};
+ComponentResult solve_component(
+    const ProblemTable& problem,
+    const EngineConfig& config,
+    AnnealingLimits limits,
+    size_t num_threads,
+    uint64_t base_seed,
+    size_t component,
+    SolveMonitor* monitor
+) {
+    std::vector<job_index_t> flexible_indices;
+    for (job_index_t i = 0; i < problem.size(); ++i) {
+        if (!problem.rigid[i]) {
+            flexible_indices.push_back(i);
+        }
     }
 
-    std::vector<sec_t> durations(segment_count, min_split);
-    sec_t remaining = duration - min_split * segment_count;
+    if (flexible_indices.empty()) {
+        Placement current = Placement(problem);
+        const double cost = IncrementalScheduleCost(problem, current).cost();
+        CostHistoryRecorder recorder(config.cost_history);
+        recorder.record(0, cost);
+        if (monitor) {
+            monitor->report(component, current, AnnealingProgress{0, cost, 0.0}, true);
+        }
+        return ComponentResult{std::move(current), recorder.take(), {}, {}};
+    }
 
-    if (round_to_granularity && unit > 1) {
-        if (remaining % unit != 0) {
-            return {};
+    // Without an improving move the starting placement is kept as is, so
+    // the caller's placement is only replaced by a cheaper greedy one.
+    Placement initial(problem);
+    SolveStats stats;
+    if (config.greedy_start) {
+        PhaseTimer timer(stats.greedy_seconds);
+        Placement greedy = greedy_placement(problem);
+        if (IncrementalScheduleCost(problem, greedy).cost() < IncrementalScheduleCost(problem, initial).cost()) {
+            initial = std::move(greedy);
         }
-        size_t increments = remaining / unit;
-        std::uniform_int_distribution<size_t> dist(0, segment_count - 1);
-        for (size_t i = 0; i < increments; ++i) {
-            durations[dist(gen)] += unit;
+    }
+
+    limits.lower_bound = rigid_cost_lower_bound(problem);
+    if (config.num_replicas > 1) {
+        ComponentResult result = solve_component_tempering(
+            problem, config, limits, flexible_indices, initial, num_threads, base_seed, component, monitor);
+        result.stats.merge(stats);
+        return result;
+    }
+
+    AnnealingChain chain(
+        problem, flexible_indices, initial, config.adaptive_moves, stream_seed(base_seed, {component, CHAIN_MOVES}));
+    BasicInPlaceSimulatedAnnealingOptimizer<AnnealingChain> optimizer(
+        chain,
+        config.initial_temp,
+        config.final_temp,
+        config.num_iters,
+        GeometricSchedule{},
+        stream_seed(base_seed, {component, CHAIN_ACCEPTANCE})
+    );
+    optimizer.set_history_policy(config.cost_history);
+    if (monitor) {
+        limits.on_progress = [&](const AnnealingProgress& progress) {
+            if (monitor->report_due(component)) {
+                monitor->report(component, chain.best, progress, false);
+            }
+        };
+    }
+    optimizer.set_limits(limits);
+
+    double best_cost = 0.0;
+    {
+        PhaseTimer timer(stats.anneal_seconds);
+        best_cost = optimizer.optimize(chain.cost());
+    }
+    if (monitor) {
+        const AnnealingReport& report = optimizer.get_report();
+        monitor->report(component, chain.best, AnnealingProgress{report.iterations, best_cost, report.final_temp}, true);
+    }
+    stats.merge(chain.moves.solve_stats());
+    return ComponentResult{std::move(chain.best), optimizer.take_history(), chain.moves.stats(), stats};
+}
+
+/**
+ * Combines per-component histories into the history of the whole schedule.
+ * Each history is read as a step function of the iteration, so components
+ * that stop early keep contributing their last cost and sparser samples
+ * hold their value until the next one. The illegal penalty is counted once
+ * no matter how many components carry it. In BUCKETS mode the bucket
+ * statistics are summed, so min and max become bounds on the total.
+ */
+CostHistory merge_cost_histories(
+    const std::vector<ComponentResult>& results,
+    bool illegal,
+    const CostHistoryPolicy& policy
+) {
+    std::vector<const CostHistory*> histories;
+    std::vector<uint64_t> grid;
+    for (const auto& result : results) {
+        if (!result.cost_history.empty()) {
+            histories.push_back(&result.cost_history);
+            grid.insert(grid.end(), result.cost_history.iterations.begin(), result.cost_history.iterations.end());
         }
-        return durations;
     }
+    CostHistory merged;
+    if (histories.empty()) {
+        return merged;
+    }
+    std::sort(grid.begin(), grid.end());
+    grid.erase(std::unique(grid.begin(), grid.end()), grid.end());
 
-    if (remaining > 0) {
-        std::vector<sec_t> cuts;
-        cuts.reserve(segment_count + 1);
-        std::uniform_int_distribution<sec_t> dist(0, remaining);
-        cuts.push_back(0);
-        cuts.push_back(remaining);
-        for (size_t i = 0; i < segment_count - 1; ++i) {
-            cuts.push_back(dist(gen));
+    const bool has_bounds = std::all_of(histories.begin(), histories.end(), [](const CostHistory* history) {
+        return history->min.size() == history->size();
+    });
+    merged.iterations = grid;
+    merged.values.reserve(grid.size());
+    if (has_bounds) {
+        merged.min.reserve(grid.size());
+        merged.max.reserve(grid.size());
+    }
+
+    auto total = [illegal](double sum, bool any_illegal) {
+        return sum + ((illegal || any_illegal) ? constants::ILLEGAL_SCHEDULE_COST : 0.0);
+    };
+    auto add = [](double value, double& sum, bool& any_illegal) {
+        if (value >= constants::ILLEGAL_SCHEDULE_COST) {
+            value -= constants::ILLEGAL_SCHEDULE_COST;
+            any_illegal = true;
         }
-        std::sort(cuts.begin(), cuts.end());
-        for (size_t i = 0; i < segment_count; ++i) {
-            durations[i] += (cuts[i + 1] - cuts[i]);
+        sum += value;
+    };
+
+    std::vector<size_t> cursor(histories.size(), 0);
+    for (uint64_t iteration : grid) {
+        double value_sum = 0.0, min_sum = 0.0, max_sum = 0.0;
+        bool value_illegal = false, min_illegal = false, max_illegal = false;
+        for (size_t h = 0; h < histories.size(); ++h) {
+            const CostHistory& history = *histories[h];
+            size_t& k = cursor[h];
+            while (k + 1 < history.size() && history.iterations[k + 1] <= iteration) {
+                ++k;
+            }
+            add(history.values[k], value_sum, value_illegal);
+            if (has_bounds) {
+                add(history.min[k], min_sum, min_illegal);
+                add(history.max[k], max_sum, max_illegal);
+            }
+        }
+        merged.values.push_back(total(value_sum, value_illegal));
+        if (has_bounds) {
+            merged.min.push_back(total(min_sum, min_illegal));
+            merged.max.push_back(total(max_sum, max_illegal));
         }
     }
-    return durations;
+
+    decimate(merged, policy);
+    return merged;
 }
 
-std::vector<TimeRange> place_split_segments(
-    const TimeRange& schedulable_time_range,
-    const std::vector<sec_t>& durations,
-    sec_t granularity,
-    std::mt19937& gen
+/**
+ * Runs find_conflicts and names the jobs of every conflict with name_of.
+ */
+FeasibilityReport feasibility_report(
+    const ProblemTable& problem,
+    const std::function<std::string(job_index_t)>& name_of
 ) {
-    std::vector<TimeRange> segments;
-    std::vector<sec_t> durations_copy = durations;
-    std::shuffle(durations_copy.begin(), durations_copy.end(), gen);
-    for (const auto& duration : durations_copy) {
-        bool placed = false;
-        const int max_attempts = 50;
-        for (int attempt = 0; attempt < max_attempts; ++attempt) {
-            TimeRange candidate = generate_random_time_range_within(
-                schedulable_time_range,
-                duration,
-                granularity,
-                gen
-            );
-            if (!ranges_overlap(candidate, segments)) {
-                segments.push_back(candidate);
-                placed = true;
-                break;
-            }
+    FeasibilityReport report;
+    for (const Conflict& conflict : find_conflicts(problem)) {
+        FeasibilityConflict named{conflict.kind, {}, describe_conflict(problem, conflict, name_of)};
+        named.job_ids.reserve(conflict.jobs.size());
+        for (job_index_t job : conflict.jobs) {
+            named.job_ids.push_back(name_of(job));
         }
-        if (!placed) {
-            return {};
+        report.conflicts.push_back(std::move(named));
+    }
+    return report;
+}
+
+// Cyclic dependencies are rejected outright rather than reported.
+void throw_if_cyclic(const FeasibilityReport& report, const std::string& caller) {
+    for (const FeasibilityConflict& conflict : report.conflicts) {
+        if (conflict.kind == ConflictKind::DEPENDENCY_CYCLE) {
+            throw std::invalid_argument(caller + ": " + conflict.message);
         }
     }
-    std::sort(segments.begin(), segments.end(), [](const TimeRange& a, const TimeRange& b) {
-        return a.get_low() < b.get_low();
-    });
-    return segments;
 }
 
-Schedule generate_random_schedule_neighbor(
-    Schedule s,
-    const sec_t granularity,
-    std::mt19937& gen
-) {
-    std::vector<Job>& jobs = s.scheduled_jobs;
-    std::vector<size_t> flexible_indices;
+// Cost history of a problem that is returned without being annealed.
+CostHistory unsolved_history(const ProblemTable& problem, const EngineConfig& config) {
+    Placement placement(problem);
+    CostHistoryRecorder recorder(config.cost_history);
+    recorder.record(0, IncrementalScheduleCost(problem, placement).cost());
+    return recorder.take();
+}
 
-    for (size_t i = 0; i < jobs.size(); ++i) {
-        if (!jobs[i].is_rigid()) {
-            flexible_indices.push_back(i);
+struct TableSolution {
+    Placement placement;
+    CostHistory cost_history;
+    std::vector<MoveStats> move_stats;
+    SolveStats stats;
+    uint64_t seed = 0;
+};
+
+ProblemPartition timed_partition(const ProblemTable& problem, double& seconds) {
+    PhaseTimer timer(seconds);
+    return get_disjoint_intervals(problem);
+}
+
+/**
+ * TableRun
+ *
+ * A problem split into components that can never interact, solved one
+ * component at a time. Components of one run, or of several runs, can be
+ * solved concurrently with solve; finish gathers the best placements once
+ * every component has run.
+ *
+ * With a time budget, a component's share of the time left before
+ * deadline is its share of the jobs not yet started, scaled by
+ * concurrency, the number of components expected to run at once.
+ */
+class TableRun {
+public:
+    TableRun(
+        const ProblemTable& problem,
+        const EngineConfig& config,
+        Clock::time_point deadline,
+        SolveMonitor* monitor,
+        const std::vector<Job>& jobs,
+        size_t replica_threads,
+        size_t concurrency)
+        : problem(problem),
+          config(config),
+          deadline(deadline),
+          monitor(monitor),
+          partition(timed_partition(problem, partition_seconds)),
+          cross_component_violation(has_cross_component_violation(problem, partition)),
+          base_seed(resolve_seed(config.seed)),
+          replica_threads(replica_threads),
+          concurrency(concurrency),
+          unstarted_jobs(problem.size()),
+          results(partition.components.size()) {
+        base_limits.plateau_iters = config.plateau_iters;
+        base_limits.max_reheats = config.max_reheats;
+        base_limits.reheat_temp_fraction = config.reheat_temp_fraction;
+        base_limits.calibration_samples = config.calibration_samples;
+        if (monitor) {
+            monitor->begin(jobs, partition.components, cross_component_violation);
+            base_limits.cancelled = &monitor->cancellation_flag();
         }
     }
 
-    if (flexible_indices.empty()) {
-        return s;
-    }
-
-    std::uniform_int_distribution<> dist(0, flexible_indices.size() - 1);
-    size_t chosen_index = flexible_indices[dist(gen)];
-
-    Job& random_flexible_job = jobs[chosen_index];
-    Policy policy = random_flexible_job.policy;
-    bool can_split = policy.is_splittable() && policy.get_max_splits() > 0;
-    sec_t min_split_duration = policy.get_min_split_duration();
-    sec_t min_split = min_split_duration > 0 ? min_split_duration : 1;
-    bool round_to_granularity = policy.get_round_to_granularity()
-        && granularity > 0
-        && (random_flexible_job.duration % granularity == 0);
-    if (round_to_granularity && granularity > 1) {
-        min_split = ((min_split + granularity - 1) / granularity) * granularity;
-    }
-    size_t max_segments = static_cast<size_t>(policy.get_max_splits()) + 1;
-    size_t max_segments_by_duration = static_cast<size_t>(random_flexible_job.duration / min_split);
-    size_t possible_segments = std::min(max_segments, max_segments_by_duration);
-    const bool is_currently_split = random_flexible_job.get_scheduled_time_ranges().size() > 1;
-
-    if (is_currently_split) {
-        constexpr double merge_probability = 0.3;
-        std::bernoulli_distribution merge_decision(merge_probability);
-        if (merge_decision(gen)) {
-            TimeRange random_time_range = generate_random_time_range_within(
-                random_flexible_job.schedulable_time_range,
-                random_flexible_job.duration,
-                granularity,
-                gen
-            );
-            random_flexible_job.set_scheduled_time_ranges({random_time_range});
-            return s;
-        }
-    }
-
-    bool attempt_split = false;
-    if (can_split && possible_segments >= 2) {
-        std::uniform_int_distribution<int> split_decision(0, 1);
-        attempt_split = (split_decision(gen) == 1);
-    }
-
-    if (attempt_split) {
-        std::uniform_int_distribution<size_t> split_count_dist(2, possible_segments);
-        size_t segment_count = split_count_dist(gen);
-        std::vector<sec_t> split_durations = generate_split_durations(
-            random_flexible_job.duration,
-            segment_count,
-            min_split_duration,
-            granularity,
-            round_to_granularity,
-            gen
-        );
-
-        if (!split_durations.empty()) {
-            std::vector<TimeRange> split_ranges = place_split_segments(
-                random_flexible_job.schedulable_time_range,
-                split_durations,
-                granularity,
-                gen
-            );
-            if (!split_ranges.empty()) {
-                random_flexible_job.set_scheduled_time_ranges(split_ranges);
-                return s;
+    TableRun(const TableRun&) = delete;
+    TableRun& operator=(const TableRun&) = delete;
+
+    size_t component_count() const {
+        return partition.components.size();
+    }
+
+    size_t component_size(size_t c) const {
+        return partition.components[c].size();
+    }
+
+    // Solves component c in scratch, which is overwritten.
+    void solve(size_t c, ProblemTable& scratch) {
+        AnnealingLimits limits = base_limits;
+        if (config.time_budget_ms > 0) {
+            const size_t members = partition.components[c].size();
+            const size_t unstarted = unstarted_jobs.fetch_sub(members);
+            const Clock::time_point now = Clock::now();
+            const Clock::duration remaining = deadline > now ? deadline - now : Clock::duration::zero();
+            const double share = std::min(
+                1.0, static_cast<double>(members * concurrency) / static_cast<double>(unstarted));
+            limits.deadline = now + std::chrono::duration_cast<Clock::duration>(remaining * share);
+        }
+        double extract_seconds = 0.0;
+        {
+            PhaseTimer timer(extract_seconds);
+            extract_subproblem(problem, partition.components[c], partition.local_index, scratch);
+        }
+        results[c] = solve_component(scratch, config, limits, replica_threads, base_seed, c, monitor);
+        results[c].stats.partition_seconds += extract_seconds;
+    }
+
+    TableSolution finish() {
+        TableSolution solution{Placement(problem), {}, {}, {}, base_seed};
+        solution.stats.partition_seconds = partition_seconds;
+        for (size_t c = 0; c < partition.components.size(); ++c) {
+            const std::vector<job_index_t>& members = partition.components[c];
+            const Placement& best = results[c].best;
+            for (job_index_t local = 0; local < members.size(); ++local) {
+                solution.placement.assign(members[local], best.begin(local), best.count(local));
             }
         }
+        solution.cost_history = merge_cost_histories(results, cross_component_violation, config.cost_history);
+        std::vector<std::vector<MoveStats>> move_stats;
+        for (ComponentResult& result : results) {
+            move_stats.push_back(std::move(result.move_stats));
+            solution.stats.merge(result.stats);
+        }
+        solution.move_stats = merge_move_stats(move_stats);
+        return solution;
     }
 
-    TimeRange random_time_range = generate_random_time_range_within(
-        random_flexible_job.schedulable_time_range,
-        random_flexible_job.duration,
-        granularity,
-        gen
-    );
+private:
+    const ProblemTable& problem;
+    const EngineConfig& config;
+    Clock::time_point deadline;
+    SolveMonitor* monitor;
+    // Set while partition is initialised, so declared before it.
+    double partition_seconds = 0.0;
+    ProblemPartition partition;
+    bool cross_component_violation;
+    uint64_t base_seed;
+    size_t replica_threads;
+    size_t concurrency;
+    AnnealingLimits base_limits;
+    std::atomic<size_t> unstarted_jobs;
+    std::vector<ComponentResult> results;
+};
+
+// Tempering runs its replicas on threads of their own, so fewer
+// components are solved at once: returns the replica threads of each
+// component and the number of components solved concurrently.
+std::pair<size_t, size_t> split_workers(uint64_t num_workers, uint64_t num_replicas) {
+    const size_t workers = resolve_worker_count(num_workers);
+    const size_t replicas = std::max<size_t>(num_replicas, 1);
+    const size_t replica_threads = std::min(replicas, workers);
+    return {replica_threads, std::max<size_t>(workers / replica_threads, 1)};
+}
+
+/**
+ * Anneals every component of problem on a worker pool of
+ * config.num_workers threads, largest components first, and gathers the
+ * best placements. jobs are the jobs problem was compiled from, and are
+ * only read to seed the monitor's best schedule.
+ */
+TableSolution solve_table(
+    const ProblemTable& problem,
+    const EngineConfig& config,
+    Clock::time_point deadline,
+    SolveMonitor* monitor,
+    const std::vector<Job>& jobs
+) {
+    const auto [replica_threads, component_workers] = split_workers(config.num_workers, config.num_replicas);
+    TableRun run(problem, config, deadline, monitor, jobs, replica_threads, component_workers);
+
+    // Hand out the largest components first so a long solve does not start last.
+    std::vector<size_t> order(run.component_count());
+    for (size_t c = 0; c < order.size(); ++c) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&run](size_t a, size_t b) {
+        return run.component_size(a) > run.component_size(b);
+    });
+
+    const size_t workers = std::min(component_workers, std::max<size_t>(order.size(), 1));
+    std::vector<ProblemTable> scratch(workers);
+    parallel_for(order.size(), workers, [&](size_t k, size_t worker) {
+        run.solve(order[k], scratch[worker]);
+    });
+    return run.finish();
+}
+
+// Rigid jobs can only be placed on their whole schedulable range.
+void pin_rigid_jobs(std::vector<Job>& jobs) {
+    for (auto& job : jobs) {
+        if (job.is_rigid()) {
+            job.scheduled_time_range = job.schedulable_time_range;
+            job.set_scheduled_time_ranges({job.scheduled_time_range});
+        }
+    }
+}
+
+/**
+ * Marks the jobs a change can reach: the changed jobs, every flexible job
+ * whose window overlaps a touched range (the windows of the changed jobs
+ * and the placements they gave up) and every job linked to a changed one
+ * by a chain of dependencies in either direction.
+ */
+std::vector<uint8_t> affected_jobs(
+    const ProblemTable& problem,
+    const std::vector<job_index_t>& changed,
+    std::vector<TimeRange> touched
+) {
+    const size_t n = problem.size();
+    std::vector<uint8_t> affected(n, 0);
+    for (job_index_t job : changed) {
+        touched.push_back(problem.window(job));
+    }
 
-    random_flexible_job.set_scheduled_time_ranges({random_time_range});
+    // Merge the touched ranges so each window needs one binary search.
+    std::sort(touched.begin(), touched.end(), [](const TimeRange& a, const TimeRange& b) {
+        return a.get_low() < b.get_low();
+    });
+    std::vector<TimeRange> merged;
+    for (const TimeRange& range : touched) {
+        if (!merged.empty() && range.get_low() <= merged.back().get_high()) {
+            merged.back() = TimeRange(merged.back().get_low(), std::max(merged.back().get_high(), range.get_high()));
+        } else {
+            merged.push_back(range);
+        }
+    }
+    for (job_index_t i = 0; i < n; ++i) {
+        if (problem.rigid[i]) {
+            continue;
+        }
+        auto it = std::upper_bound(merged.begin(), merged.end(), problem.window_low[i],
+                                   [](sec_t low, const TimeRange& range) { return low < range.get_high(); });
+        if (it != merged.end() && it->get_low() < problem.window_high[i]) {
+            affected[i] = 1;
+        }
+    }
 
-    return s;
+    auto reach = [&problem, &affected, &changed](
+                     const std::vector<uint32_t>& offsets, const std::vector<job_index_t>& indices) {
+        std::vector<uint8_t> seen(problem.size(), 0);
+        std::vector<job_index_t> stack(changed.begin(), changed.end());
+        while (!stack.empty()) {
+            const job_index_t job = stack.back();
+            stack.pop_back();
+            if (seen[job]) {
+                continue;
+            }
+            seen[job] = 1;
+            affected[job] = 1;
+            for (uint32_t k = offsets[job]; k < offsets[job + 1]; ++k) {
+                stack.push_back(indices[k]);
+            }
+        }
+    };
+    reach(problem.predecessor_offsets, problem.predecessor_indices);
+    reach(problem.successor_offsets, problem.successor_indices);
+    return affected;
 }
+
 } // namespace
 
-Schedule::Schedule(std::vector<Job> scheduled_jobs) : scheduled_jobs(scheduled_jobs) {}
+
+Schedule::Schedule(std::vector<Job> scheduled_jobs) : scheduled_jobs(std::move(scheduled_jobs)) {}
 
 void Schedule::add_job(const Job& job) {
     scheduled_jobs.push_back(job);
@@ -323,92 +750,67 @@ DependencyViolation::DependencyViolation(ID job_id, const std::set<ID>& violated
     : job_id(std::move(job_id)), violated_dependencies(violated_dependencies) {}
 
 DependencyCheckResult::DependencyCheckResult()
-    : has_violations(false), has_cyclic_dependencies(false) {}
+    : has_violations(false), has_cyclic_dependencies(false), has_duplicate_ids(false) {}
 
 DependencyCheckResult check_dependency_violations(const Schedule& schedule) {
     DependencyCheckResult result;
+    const std::vector<Job>& jobs = schedule.scheduled_jobs;
+    const size_t n = jobs.size();
 
-    if (schedule.scheduled_jobs.empty()) {
+    if (n == 0) {
         return result;
     }
 
-    std::unordered_map<ID, const Job*> job_map;
-    std::unordered_map<ID, sec_t> earliest_start;
-    std::unordered_map<ID, sec_t> latest_end;
-    for (const auto& job : schedule.scheduled_jobs) {
-        job_map[job.id] = &job;
-        sec_t min_start = job.scheduled_time_range.get_low();
-        sec_t max_end = job.scheduled_time_range.get_high();
-        if (!job.scheduled_time_ranges.empty()) {
-            min_start = job.scheduled_time_ranges.front().get_low();
-            max_end = job.scheduled_time_ranges.front().get_high();
-            for (const auto& range : job.scheduled_time_ranges) {
-                min_start = std::min(min_start, range.get_low());
-                max_end = std::max(max_end, range.get_high());
-            }
-        }
-        earliest_start[job.id] = min_start;
-        latest_end[job.id] = max_end;
-    }
-
-    std::unordered_map<ID, std::vector<ID>> adj_list;
-    std::unordered_map<ID, int> in_degree;
-
-    for (const auto& job : schedule.scheduled_jobs) {
-        in_degree[job.id] = 0;
-        adj_list[job.id] = std::vector<ID>();
-    }
-
-    for (const auto& job : schedule.scheduled_jobs) {
-        for (const ID& dep_id : job.dependencies) {
-            if (job_map.find(dep_id) != job_map.end()) {
-                adj_list[dep_id].push_back(job.id);
-                in_degree[job.id]++;
-            }
-        }
-    }
-
-    std::queue<ID> queue;
-    std::vector<ID> topological_order;
-
-    for (const auto& pair : in_degree) {
-        if (pair.second == 0) {
-            queue.push(pair.first);
+    // A duplicated id makes dependencies on it ambiguous, so nothing else
+    // is checked.
+    std::unordered_set<ID> seen;
+    seen.reserve(n);
+    for (const Job& job : jobs) {
+        if (!seen.insert(job.id).second) {
+            result.duplicate_ids.insert(job.id);
         }
     }
-
-    while (!queue.empty()) {
-        ID current_id = queue.front();
-        queue.pop();
-        topological_order.push_back(current_id);
-
-        for (ID neighbor_id : adj_list[current_id]) {
-            in_degree[neighbor_id]--;
-            if (in_degree[neighbor_id] == 0) {
-                queue.push(neighbor_id);
-            }
-        }
+    if (!result.duplicate_ids.empty()) {
+        result.has_duplicate_ids = true;
+        result.has_violations = true;
+        return result;
     }
 
-    if (topological_order.size() != schedule.scheduled_jobs.size()) {
+    // The dependency graph and its cycle check are the solver's.
+    const ProblemTable problem = compile_problem(jobs, 0);
+    if (problem.has_cyclic_dependencies) {
         result.has_cyclic_dependencies = true;
         result.has_violations = true;
         return result;
     }
 
-    for (const auto& job : schedule.scheduled_jobs) {
+    std::vector<sec_t> earliest_start(n);
+    std::vector<sec_t> latest_end(n);
+    for (job_index_t i = 0; i < n; ++i) {
+        const TimeRange* first = problem.segments.data() + problem.segment_offsets[i];
+        const TimeRange* last = problem.segments.data() + problem.segment_offsets[i + 1];
+        sec_t min_start = first->get_low();
+        sec_t max_end = first->get_high();
+        for (const TimeRange* range = first; range != last; ++range) {
+            min_start = std::min(min_start, range->get_low());
+            max_end = std::max(max_end, range->get_high());
+        }
+        earliest_start[i] = min_start;
+        latest_end[i] = max_end;
+    }
+
+    for (job_index_t i = 0; i < n; ++i) {
         std::set<ID> violated_deps;
 
-        for (const ID& dep_id : job.dependencies) {
-            if (job_map.find(dep_id) != job_map.end()) {
-                if (latest_end[dep_id] > earliest_start[job.id]) {
-                    violated_deps.insert(dep_id);
-                }
+        for (uint32_t k = problem.predecessor_offsets[i]; k < problem.predecessor_offsets[i + 1]; ++k) {
+            const job_index_t dep = problem.predecessor_indices[k];
+            if (latest_end[dep] > earliest_start[i]) {
+                violated_deps.insert(jobs[dep].id);
             }
         }
 
         if (!violated_deps.empty()) {
-            result.violations.emplace_back(job.id, violated_deps);
+            result.violations.emplace_back(jobs[i].id, violated_deps);
             result.has_violations = true;
         }
     }
@@ -420,38 +822,7 @@ ScheduleCostFunction::ScheduleCostFunction(const Schedule& schedule, sec_t granu
     :
 schedule_ref(schedule),
 granularity(granularity)
-{
-    if (schedule.scheduled_jobs.size() == 0) {
-        return;
-    }
-
-    for (const auto& job : schedule.scheduled_jobs) {
-        for (const auto& range : get_job_scheduled_ranges(job)) {
-            min_time = safe_min<sec_t>(min_time, range.get_low());
-            max_time = safe_max<sec_t>(max_time, range.get_high());
-        }
-    }
-
-    TimeRange curr = TimeRange(0, constants::DAY - 1);
-    day_based_schedule.insert(curr, std::nullopt);
-
-    while (curr.get_high() < max_time.value()) {
-        sec_t next_low = curr.get_high() + 1;
-        TimeRange next = TimeRange(next_low, next_low + constants::DAY - 1);
-        day_based_schedule.insert(next, std::nullopt);
-        curr = next;
-    }
-
-    for (const auto& job : schedule.scheduled_jobs) {
-        for (const auto& range : get_job_scheduled_ranges(job)) {
-            TimeRange curr_interval = TimeRange(range.get_low()); // TimeRange representing unit of time
-            std::optional<std::vector<Job>>* curr_day_jobs = day_based_schedule.search_value(curr_interval);
-            if (curr_day_jobs) {
-                curr_day_jobs->emplace().push_back(job);
-            }
-        }
-    }
-}
+{}
 
 double ScheduleCostFunction::context_switch_cost() const {
     return 0.0f;
@@ -460,6 +831,7 @@ double ScheduleCostFunction::context_switch_cost() const {
 double ScheduleCostFunction::illegal_schedule_cost() const {
     const std::vector<Job>& scheduled_jobs = schedule_ref.scheduled_jobs;
     IntervalTree<sec_t, size_t> non_overlappable_jobs;
+    non_overlappable_jobs.reserve(scheduled_jobs.size());
 
     for (size_t i = 0; i < scheduled_jobs.size(); ++i) {
         const Job& curr = scheduled_jobs[i];
@@ -502,13 +874,13 @@ double ScheduleCostFunction::overlap_cost() const {
     }
     const double granularity_value = granularity > 0 ? static_cast<double>(granularity) : 1.0;
     IntervalTree<sec_t, size_t> overlap_tree;
+    overlap_tree.reserve(scheduled_jobs.size());
     double cost = 0.0f;
     for (size_t i = 0; i < scheduled_jobs.size(); ++i) {
         for (const auto& current : get_job_scheduled_ranges(scheduled_jobs[i])) {
-            const auto overlaps = overlap_tree.find_overlapping(current);
-            for (const auto* interval : overlaps) {
-                cost += static_cast<double>(current.overlap_length(*interval)) / granularity_value;
-            }
+            overlap_tree.visit_overlapping(current, [&cost, &current, granularity_value](const TimeRange& interval, size_t) {
+                cost += static_cast<double>(current.overlap_length(interval)) / granularity_value;
+            });
             overlap_tree.insert(current, i);
         }
     }
@@ -534,73 +906,424 @@ double ScheduleCostFunction::schedule_cost() const {
 
 /**
  *
- * @param rigid := a linked list containing nodes which cannot be moved
- * @param flexible := a linked list containing all flexible nodes
- * @param granularity := the smallest schedulable delta
+ * @param jobs := the jobs to place; rigid jobs are pinned to their schedulable range
+ * @param config := solver parameters
+ * @param monitor := optional observer that can cancel and follow the solve
+ *
+ * Splits the jobs into components that can never interact, anneals each
+ * component on a worker pool of config.num_workers threads and merges the
+ * results. Returns the approximately best Schedule.
+ *
+ * With a monitor, the solve can be cancelled and followed from other
+ * threads; a cancelled solve returns the best placement found so far.
+ *
+ * Jobs that cannot be scheduled legally (see find_conflicts) are not
+ * annealed: they are returned as given, with the conflicts in
+ * feasibility.
  *
- * Returns the approximately best Schedule.
+ * Throws std::invalid_argument if the dependencies contain a cycle or two
+ * jobs share an id, as no schedule can satisfy them.
  *
  */
-std::pair<Schedule, std::vector<double>> schedule_jobs(
-    std::vector<Job> jobs,
-    const sec_t granularity,
-    const double initial_temp,
-    const double final_temp,
-    const uint64_t num_iters
+SolveResult solve(std::vector<Job> jobs, const EngineConfig& config, SolveMonitor* monitor) {
+    if (jobs.empty()) {
+        return SolveResult{};
+    }
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(config.time_budget_ms);
+
+    pin_rigid_jobs(jobs);
+
+    SolveStats stats;
+    ProblemTable problem;
+    FeasibilityReport feasibility;
+    {
+        PhaseTimer timer(stats.compile_seconds);
+        problem = compile_problem(jobs, config.granularity);
+    }
+    {
+        PhaseTimer timer(stats.feasibility_seconds);
+        feasibility = feasibility_report(problem, [&jobs](job_index_t job) {
+            return jobs[job].id;
+        });
+    }
+    throw_if_cyclic(feasibility, "solve");
+    if (!feasibility.feasible()) {
+        CostHistory history = unsolved_history(problem, config);
+        return SolveResult{
+            Schedule(std::move(jobs)), std::move(history), std::move(feasibility), {}, stats, resolve_seed(config.seed)};
+    }
+
+    TableSolution solution = solve_table(problem, config, deadline, monitor, jobs);
+    stats.merge(solution.stats);
+    {
+        PhaseTimer timer(stats.write_back_seconds);
+        write_back(solution.placement, jobs);
+    }
+    return SolveResult{
+        Schedule(std::move(jobs)),
+        std::move(solution.cost_history),
+        {},
+        std::move(solution.move_stats),
+        stats,
+        solution.seed};
+}
+
+/**
+ *
+ * @param batch := columnar jobs, read in place
+ * @param config := solver parameters
+ *
+ * Solves the jobs of batch like solve, without building a Job per row.
+ * Rigid jobs are pinned to their window. Returns the placement of every job
+ * in CSR form. Conflicts are reported as in solve, naming jobs by
+ * their index in batch.
+ *
+ * Throws std::invalid_argument if the batch is malformed or its
+ * dependencies contain a cycle.
+ *
+ */
+BatchSolveResult solve_batch(const JobBatch& batch, const EngineConfig& config) {
+    BatchSolveResult result;
+    result.segment_offsets.assign(1, 0);
+    if (batch.size == 0) {
+        return result;
+    }
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(config.time_budget_ms);
+
+    ProblemTable problem;
+    {
+        PhaseTimer timer(result.stats.compile_seconds);
+        problem = compile_batch(batch, config.granularity);
+    }
+    {
+        PhaseTimer timer(result.stats.feasibility_seconds);
+        result.feasibility = feasibility_report(problem, [](job_index_t job) {
+            return std::to_string(job);
+        });
+    }
+    throw_if_cyclic(result.feasibility, "solve_batch");
+
+    TableSolution solution;
+    if (result.feasibility.feasible()) {
+        solution = solve_table(problem, config, deadline, nullptr, {});
+    } else {
+        solution = TableSolution{Placement(problem), unsolved_history(problem, config), {}, {}, resolve_seed(config.seed)};
+    }
+    result.stats.merge(solution.stats);
+    {
+        PhaseTimer timer(result.stats.write_back_seconds);
+        const Placement& placement = solution.placement;
+        result.segment_offsets.reserve(problem.size() + 1);
+        result.segment_low.reserve(placement.slots.size());
+        result.segment_high.reserve(placement.slots.size());
+        for (job_index_t i = 0; i < problem.size(); ++i) {
+            for (const TimeRange* range = placement.begin(i); range != placement.end(i); ++range) {
+                result.segment_low.push_back(range->get_low());
+                result.segment_high.push_back(range->get_high());
+            }
+            result.segment_offsets.push_back(static_cast<uint32_t>(result.segment_low.size()));
+        }
+    }
+    result.cost_history = std::move(solution.cost_history);
+    result.move_stats = std::move(solution.move_stats);
+    result.seed = solution.seed;
+    return result;
+}
+
+/**
+ *
+ * @param previous := a solved schedule, used as the starting placement
+ * @param change := jobs added to, replaced in and removed from previous
+ * @param config := solver parameters
+ * @param monitor := optional observer that can cancel and follow the solve
+ *
+ * Applies change to previous and re-solves only the part of the schedule
+ * the change can affect (see affected_jobs); every other job keeps its
+ * previous placement and is treated as rigid. Components without an
+ * affected job are not annealed at all, so small edits cost a fraction of
+ * a full solve. Jobs keep the order of previous with added jobs last.
+ *
+ * Throws std::invalid_argument if change names an unknown id, modifies a
+ * job twice or both modifies and removes it, if an added job reuses an id
+ * or if the dependencies contain a cycle.
+ *
+ */
+SolveResult reschedule(
+    const Schedule& previous,
+    const ScheduleChange& change,
+    const EngineConfig& config,
+    SolveMonitor* monitor
 ) {
-    if (jobs.size() == 0) {
-        return std::make_pair<Schedule, std::vector<double>>(Schedule(), {});
-    };
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(config.time_budget_ms);
 
-    for (auto& job : jobs) {
-        if (job.is_rigid()) {
-            job.scheduled_time_range = job.schedulable_time_range;
-            job.set_scheduled_time_ranges({job.scheduled_time_range});
+    std::unordered_map<ID, const Job*> modified_by_id;
+    for (const Job& job : change.modified) {
+        if (change.removed.count(job.id) > 0) {
+            throw std::invalid_argument("reschedule: job " + job.id + " is both modified and removed");
+        }
+        if (!modified_by_id.emplace(job.id, &job).second) {
+            throw std::invalid_argument("reschedule: job " + job.id + " is modified more than once");
+        }
+    }
+    std::vector<Job> jobs;
+    jobs.reserve(previous.scheduled_jobs.size() + change.added.size());
+    std::vector<job_index_t> changed;
+    std::vector<TimeRange> freed;
+    size_t found = 0;
+    for (const Job& job : previous.scheduled_jobs) {
+        const bool removed = change.removed.count(job.id) > 0;
+        auto modified = modified_by_id.find(job.id);
+        if (removed || modified != modified_by_id.end()) {
+            ++found;
+            const std::vector<TimeRange>& ranges = job.get_scheduled_time_ranges();
+            if (ranges.empty()) {
+                freed.push_back(job.scheduled_time_range);
+            } else {
+                freed.insert(freed.end(), ranges.begin(), ranges.end());
+            }
+        }
+        if (removed) {
+            continue;
+        }
+        if (modified != modified_by_id.end()) {
+            changed.push_back(static_cast<job_index_t>(jobs.size()));
+            jobs.push_back(*modified->second);
+        } else {
+            jobs.push_back(job);
+        }
+    }
+    if (found != change.removed.size() + modified_by_id.size()) {
+        throw std::invalid_argument("reschedule: change names a job that is not in the previous schedule");
+    }
+    for (const Job& job : change.added) {
+        changed.push_back(static_cast<job_index_t>(jobs.size()));
+        jobs.push_back(job);
+    }
+    if (jobs.empty()) {
+        return SolveResult{};
+    }
+
+    pin_rigid_jobs(jobs);
+
+    // Conflicts are looked for before the unchanged jobs are pinned, as
+    // pinned jobs could still move in a full solve.
+    SolveStats stats;
+    ProblemTable problem;
+    FeasibilityReport feasibility;
+    {
+        PhaseTimer timer(stats.compile_seconds);
+        problem = compile_problem(jobs, config.granularity);
+    }
+    {
+        PhaseTimer timer(stats.feasibility_seconds);
+        feasibility = feasibility_report(problem, [&jobs](job_index_t job) {
+            return jobs[job].id;
+        });
+    }
+    throw_if_cyclic(feasibility, "reschedule");
+    if (!feasibility.feasible()) {
+        CostHistory history = unsolved_history(problem, config);
+        return SolveResult{
+            Schedule(std::move(jobs)), std::move(history), std::move(feasibility), {}, stats, resolve_seed(config.seed)};
+    }
+
+    {
+        PhaseTimer timer(stats.partition_seconds);
+        const std::vector<uint8_t> affected = affected_jobs(problem, changed, std::move(freed));
+        for (job_index_t i = 0; i < problem.size(); ++i) {
+            if (!affected[i]) {
+                problem.rigid[i] = 1;
+            }
         }
     }
 
-    std::vector<std::vector<Job>> disjoint_jobs = get_disjoint_intervals(jobs);
-    (void)disjoint_jobs;
-    std::mt19937 gen(constants::RNG_SEED());
+    TableSolution solution = solve_table(problem, config, deadline, monitor, jobs);
+    stats.merge(solution.stats);
+    {
+        PhaseTimer timer(stats.write_back_seconds);
+        write_back(solution.placement, jobs);
+    }
+    return SolveResult{
+        Schedule(std::move(jobs)),
+        std::move(solution.cost_history),
+        {},
+        std::move(solution.move_stats),
+        stats,
+        solution.seed};
+}
 
-    Schedule initial_schedule = Schedule(jobs);
+bool FeasibilityReport::feasible() const {
+    return conflicts.empty();
+}
 
-    ScheduleCostFunction initial_cost_function = ScheduleCostFunction(initial_schedule, granularity);
-    (void)initial_cost_function;
+/**
+ *
+ * @param jobs := the jobs to check; rigid jobs are pinned to their schedulable range
+ * @param granularity := grid flexible jobs start on
+ *
+ * Reports the conflicts that rule out every legal schedule of jobs, as
+ * solve would find them, without solving. Throws std::invalid_argument if
+ * two jobs share an id.
+ *
+ */
+FeasibilityReport check_feasibility(std::vector<Job> jobs, sec_t granularity) {
+    pin_rigid_jobs(jobs);
+    const ProblemTable problem = compile_problem(jobs, granularity);
+    return feasibility_report(problem, [&jobs](job_index_t job) {
+        return jobs[job].id;
+    });
+}
 
-    SimulatedAnnealingOptimizer<Schedule> optimizer = SimulatedAnnealingOptimizer<Schedule>(
-        [granularity](Schedule s) {
-            ScheduleCostFunction cost_function = ScheduleCostFunction(s, granularity);
-            return cost_function.schedule_cost();
-        },
-        [granularity, &gen](Schedule s) {
-            return generate_random_schedule_neighbor(
-                s,
-                granularity,
-                gen);
-        },
-        initial_temp,
-        final_temp,
-        num_iters
-    );
+/**
+ *
+ * @param requests := independent problems, each with its own configuration
+ * @param num_workers := threads shared by every problem (0 = one per hardware thread)
+ *
+ * Solves every request like solve, on one pool of num_workers threads.
+ * The components of all requests are handed out largest first, so a
+ * thread that finishes a small problem moves on to whatever is left of
+ * any other, and each thread reuses one scratch table for every component
+ * it solves. The num_workers of each request's config is ignored.
+ *
+ * A request's time_budget_ms counts from the start of the batch, so time
+ * spent waiting for a thread is part of it. Results are in request order.
+ * Unlike solve, cyclic dependencies are reported in the feasibility of
+ * their request rather than thrown, so one bad request does not fail the
+ * batch.
+ *
+ * Throws std::invalid_argument, naming the request, if two jobs of a
+ * request share an id.
+ *
+ */
+std::vector<SolveResult> schedule_batch(std::vector<SolveRequest> requests, uint64_t num_workers) {
+    const Clock::time_point start = Clock::now();
+    std::vector<SolveResult> results(requests.size());
+
+    uint64_t num_replicas = 1;
+    for (const SolveRequest& request : requests) {
+        num_replicas = std::max(num_replicas, request.config.num_replicas);
+    }
+    const auto [replica_threads, component_workers] = split_workers(num_workers, num_replicas);
+
+    // Tables are sized up front: runs keep references to them.
+    std::vector<ProblemTable> problems(requests.size());
+    std::vector<std::unique_ptr<TableRun>> runs(requests.size());
+    std::vector<std::pair<size_t, size_t>> tasks;
+    for (size_t r = 0; r < requests.size(); ++r) {
+        std::vector<Job>& jobs = requests[r].jobs;
+        const EngineConfig& config = requests[r].config;
+        if (jobs.empty()) {
+            continue;
+        }
+        pin_rigid_jobs(jobs);
+        SolveStats& stats = results[r].stats;
+        try {
+            PhaseTimer timer(stats.compile_seconds);
+            problems[r] = compile_problem(jobs, config.granularity);
+        } catch (const std::invalid_argument& error) {
+            throw std::invalid_argument("schedule_batch: request " + std::to_string(r) + ": " + error.what());
+        }
+        {
+            PhaseTimer timer(stats.feasibility_seconds);
+            results[r].feasibility = feasibility_report(problems[r], [&jobs](job_index_t job) {
+                return jobs[job].id;
+            });
+        }
+        if (!results[r].feasibility.feasible()) {
+            results[r].cost_history = unsolved_history(problems[r], config);
+            results[r].seed = resolve_seed(config.seed);
+            continue;
+        }
+        const Clock::time_point deadline = start + std::chrono::milliseconds(config.time_budget_ms);
+        runs[r] = std::make_unique<TableRun>(
+            problems[r], config, deadline, nullptr, jobs, replica_threads, 1);
+        for (size_t c = 0; c < runs[r]->component_count(); ++c) {
+            tasks.emplace_back(r, c);
+        }
+    }
+    std::stable_sort(tasks.begin(), tasks.end(), [&runs](const auto& a, const auto& b) {
+        return runs[a.first]->component_size(a.second) > runs[b.first]->component_size(b.second);
+    });
+
+    const size_t workers = std::min(component_workers, std::max<size_t>(tasks.size(), 1));
+    std::vector<ProblemTable> scratch(workers);
+    parallel_for(tasks.size(), workers, [&](size_t k, size_t worker) {
+        runs[tasks[k].first]->solve(tasks[k].second, scratch[worker]);
+    });
+
+    for (size_t r = 0; r < requests.size(); ++r) {
+        if (runs[r]) {
+            TableSolution solution = runs[r]->finish();
+            results[r].stats.merge(solution.stats);
+            {
+                PhaseTimer timer(results[r].stats.write_back_seconds);
+                write_back(solution.placement, requests[r].jobs);
+            }
+            results[r].cost_history = std::move(solution.cost_history);
+            results[r].move_stats = std::move(solution.move_stats);
+            results[r].seed = solution.seed;
+        }
+        results[r].schedule = Schedule(std::move(requests[r].jobs));
+    }
+    return results;
+}
 
-    Schedule best_schedule = optimizer.optimize(initial_schedule);
-    std::vector<double> cost_history = optimizer.get_cost_history();
+/**
+ *
+ * @param stats := optional; receives the SolveStats of the solve
+ *
+ * Solves jobs by iteration count from a greedy start and returns the
+ * schedule with its cost history, one cost per iteration as it always
+ * has been: the history is recorded in FULL mode whatever the default
+ * CostHistoryPolicy is.
+ *
+ */
+std::pair<Schedule, std::vector<double>> schedule_jobs(
+    std::vector<Job> jobs,
+    const sec_t granularity,
+    const double initial_temp,
+    const double final_temp,
+    const uint64_t num_iters,
+    SolveStats* stats
+) {
+    EngineConfig config;
+    config.granularity = granularity;
+    config.initial_temp = initial_temp;
+    config.final_temp = final_temp;
+    config.num_iters = num_iters;
+    config.greedy_start = true;
+    config.adaptive_moves = true;
+    config.cost_history.mode = CostHistoryMode::FULL;
+
+    SolveResult result = solve(std::move(jobs), config);
+    if (stats) {
+        *stats = result.stats;
+    }
+    return std::make_pair(std::move(result.schedule), std::move(result.cost_history.values));
+}
 
-    return std::make_pair(best_schedule, cost_history);
+/**
+ * Configuration of the default solve used by the HTTP path: a 200 ms budget
+ * with calibrated temperatures, reheats and early stopping, so latency does
+ * not depend on the size of the request, starting from a greedy placement
+ * and drawing from every move operator.
+ */
+EngineConfig default_engine_config(uint64_t granularity) {
+    EngineConfig config;
+    config.granularity = granularity;
+    config.cost_history.mode = CostHistoryMode::OFF;
+    config.time_budget_ms = 200;
+    config.calibration_samples = 64;
+    config.plateau_iters = 5000;
+    config.max_reheats = 3;
+    config.greedy_start = true;
+    config.adaptive_moves = true;
+    return config;
 }
 
 Schedule schedule(
     std::vector<Job> jobs,
     const uint64_t granularity
 ) {
-    std::pair<Schedule, std::vector<double>> s = schedule_jobs(
-        jobs,
-        granularity,
-        10.0f,
-        1e-4,
-        1000000
-    );
-
-    return s.first;
+    return solve(std::move(jobs), default_engine_config(granularity)).schedule;
 }
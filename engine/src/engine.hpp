@@ -2,11 +2,16 @@
 #define ELASTISCHED_ENGINE_HPP
 
 #include "types.hpp"
+#include "cost_history.hpp"
 #include "job.hpp"
 #include "interval_tree.hpp"
+#include "feasibility.hpp"
+#include "move_library.hpp"
+#include "problem_table.hpp"
+#include "solve_stats.hpp"
 
-#include <optional>
 #include <set>
+#include <string>
 #include <utility>
 #include <vector>
 #include <ostream>
@@ -37,6 +42,8 @@ struct DependencyCheckResult {
     bool has_violations;
     std::vector<DependencyViolation> violations;
     bool has_cyclic_dependencies;
+    bool has_duplicate_ids;
+    std::set<ID> duplicate_ids; // Ids held by more than one job
 
     DependencyCheckResult();
 };
@@ -48,9 +55,6 @@ private:
     const Schedule& schedule_ref;
     const sec_t granularity;
     const std::set<Tag> rest_tags{};
-    IntervalTree<sec_t, std::optional<std::vector<Job>>> day_based_schedule;
-    std::optional<sec_t> min_time = std::nullopt;
-    std::optional<sec_t> max_time = std::nullopt;
 
 public:
     double context_switch_cost() const;
@@ -62,26 +66,165 @@ public:
     ScheduleCostFunction(const Schedule& schedule, sec_t granularity);
 };
 
-// @note: currently unused
+/**
+ * EngineConfig
+ *
+ * Solver parameters. num_workers bounds how many independent components are
+ * annealed concurrently; 0 uses every hardware thread.
+ *
+ * With num_replicas > 1 each component is solved by parallel tempering:
+ * num_replicas chains on a geometric temperature ladder between final_temp
+ * and initial_temp, each running num_iters iterations and exchanging
+ * neighbouring temperatures every swap_interval iterations.
+ *
+ * cost_history bounds the cost trace returned with the schedule.
+ *
+ * time_budget_ms > 0 gives the solve a wall-clock deadline, shared out
+ * between components by size, and makes each annealer cool over its share
+ * of the time rather than by the iteration count. calibration_samples > 0
+ * replaces initial_temp and final_temp with temperatures fitted to sampled
+ * moves. A component that goes plateau_iters iterations without improving
+ * is reheated, up to max_reheats times, and then stops. Every component
+ * also stops once it reaches the cost of its rigid jobs alone, as no
+ * placement can do better.
+ *
+ * With greedy_start, each component is annealed from greedy_placement
+ * instead of the given placement whenever the greedy one costs less.
+ *
+ * With adaptive_moves, annealers draw from every MoveLibrary operator with
+ * weights that adapt to how well each does, instead of only re-placing
+ * random jobs.
+ *
+ * seed fixes every random draw of the solve: each component, chain and
+ * replica draws from its own stream derived from it (see stream_seed), so
+ * a solve with the same jobs and seed gives the same schedule for any
+ * num_workers unless it is stopped by time_budget_ms. 0 takes the seed from
+ * ELASTISCHED_RNG_SEED. The seed used is returned with the result.
+ *
+ * @note: the cost weights and logging fields are currently unused
+ */
 struct EngineConfig {
-    const uint64_t granularity;
-    const double initial_temp;
-    const double final_temp;
-    const uint64_t num_iters;
-    const uint64_t num_workers;
-    const double illegal_schedule_weight;
-    const double overlap_cost_weight;
-    const double split_cost_weight;
-    const bool log_engine_run;
-    const std::string output_file;
+    uint64_t granularity = 0;
+    double initial_temp = 10.0;
+    double final_temp = 1e-4;
+    uint64_t num_iters = 1000000;
+    uint64_t num_workers = 0;
+    uint64_t num_replicas = 1;
+    uint64_t swap_interval = 100;
+    CostHistoryPolicy cost_history;
+    uint64_t time_budget_ms = 0;
+    uint32_t calibration_samples = 0;
+    uint64_t plateau_iters = 0;
+    uint32_t max_reheats = 0;
+    double reheat_temp_fraction = 0.5;
+    bool greedy_start = false;
+    bool adaptive_moves = false;
+    uint64_t seed = 0;
+    double illegal_schedule_weight = 1.0;
+    double overlap_cost_weight = 1.0;
+    double split_cost_weight = 1.0;
+    bool log_engine_run = false;
+    std::string output_file = "";
 };
 
+/**
+ * FeasibilityReport
+ *
+ * Conflicts that rule out every legal schedule (see find_conflicts), with
+ * the jobs of each named by id, or by index for a JobBatch, and a message.
+ */
+struct FeasibilityConflict {
+    ConflictKind kind;
+    std::vector<ID> job_ids;
+    std::string message;
+};
+
+struct FeasibilityReport {
+    std::vector<FeasibilityConflict> conflicts;
+
+    bool feasible() const;
+};
+
+/**
+ * SolveResult
+ *
+ * The solved schedule and its cost history. When feasibility holds
+ * conflicts the solver did not run: schedule holds the jobs as given, with
+ * rigid jobs pinned, and the history only their cost. move_stats sums the
+ * MoveStats of every annealer, one entry per MoveKind, and is empty when
+ * nothing was annealed. stats breaks the solve down by phase (see
+ * SolveStats). seed is the seed the solve ran with; setting it as
+ * EngineConfig::seed replays the solve.
+ */
+struct SolveResult {
+    Schedule schedule;
+    CostHistory cost_history;
+    FeasibilityReport feasibility;
+    std::vector<MoveStats> move_stats;
+    SolveStats stats;
+    uint64_t seed = 0;
+};
+
+/**
+ * BatchSolveResult
+ *
+ * Placement of every job of a JobBatch, in batch order. The segments of job
+ * i are [segment_low[k], segment_high[k]) for k in
+ * [segment_offsets[i], segment_offsets[i + 1]).
+ */
+struct BatchSolveResult {
+    std::vector<uint32_t> segment_offsets;
+    std::vector<sec_t> segment_low;
+    std::vector<sec_t> segment_high;
+    CostHistory cost_history;
+    FeasibilityReport feasibility;
+    std::vector<MoveStats> move_stats;
+    SolveStats stats;
+    uint64_t seed = 0;
+};
+
+/**
+ * ScheduleChange
+ *
+ * Edits to a solved schedule: jobs to add, jobs that replace the job of
+ * the same id, and ids of jobs to drop.
+ */
+struct ScheduleChange {
+    std::vector<Job> added;
+    std::vector<Job> modified;
+    std::set<ID> removed;
+};
+
+/**
+ * SolveRequest
+ *
+ * One independent problem of a schedule_batch: its jobs and the
+ * configuration to solve them with.
+ */
+struct SolveRequest {
+    std::vector<Job> jobs;
+    EngineConfig config;
+};
+
+class SolveMonitor;
+
+SolveResult solve(std::vector<Job> jobs, const EngineConfig& config, SolveMonitor* monitor = nullptr);
+BatchSolveResult solve_batch(const JobBatch& batch, const EngineConfig& config);
+FeasibilityReport check_feasibility(std::vector<Job> jobs, sec_t granularity);
+std::vector<SolveResult> schedule_batch(std::vector<SolveRequest> requests, uint64_t num_workers = 0);
+SolveResult reschedule(
+    const Schedule& previous,
+    const ScheduleChange& change,
+    const EngineConfig& config,
+    SolveMonitor* monitor = nullptr);
+EngineConfig default_engine_config(uint64_t granularity);
 Schedule schedule(std::vector<Job> jobs, const uint64_t granularity);
 std::pair<Schedule, std::vector<double>> schedule_jobs(
     std::vector<Job> jobs,
     const uint64_t granularity,
     const double initial_temp,
     const double final_temp,
-    const uint64_t num_iters);
+    const uint64_t num_iters,
+    SolveStats* stats = nullptr);
 
 #endif // ELASTISCHED_ENGINE_HPP
@@ -0,0 +1,200 @@
+#include "feasibility.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <utility>
+
+namespace {
+
+constexpr job_index_t NO_JOB = std::numeric_limits<job_index_t>::max();
+
+// Mirrors generate_random_time_range_within: flexible jobs only start on
+// the granularity grid, which is every second when the granularity is 0.
+bool window_fits(const ProblemTable& problem, job_index_t job) {
+    const sec_t low = problem.window_low[job];
+    const sec_t high = problem.window_high[job];
+    const sec_t duration = problem.duration[job];
+    if (high < low || high - low < duration) {
+        return false;
+    }
+    if (problem.rigid[job]) {
+        return true;
+    }
+    const sec_t step = problem.granularity > 0 ? problem.granularity : 1;
+    const sec_t start = ((low + step - 1) / step) * step;
+    return start <= high && high - start >= duration;
+}
+
+void find_rigid_overlaps(const ProblemTable& problem, std::vector<Conflict>& conflicts) {
+    struct Piece {
+        TimeRange range;
+        job_index_t job;
+    };
+    std::vector<Piece> pieces;
+    for (job_index_t i = 0; i < problem.size(); ++i) {
+        if (!problem.rigid[i] || problem.is_overlappable(i)) {
+            continue;
+        }
+        for (uint32_t k = problem.segment_offsets[i]; k < problem.segment_offsets[i + 1]; ++k) {
+            pieces.push_back(Piece{problem.segments[k], i});
+        }
+    }
+    std::sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b) {
+        return a.range.get_low() < b.range.get_low();
+    });
+
+    // The piece reaching furthest so far overlaps every later piece that
+    // any earlier piece overlaps, so comparing against it finds a partner
+    // for every colliding piece.
+    std::set<std::pair<job_index_t, job_index_t>> reported;
+    const Piece* reach = nullptr;
+    for (const Piece& piece : pieces) {
+        if (reach != nullptr && reach->job != piece.job && piece.range.overlaps(reach->range)) {
+            const auto pair = std::minmax(reach->job, piece.job);
+            if (reported.insert(pair).second) {
+                conflicts.push_back(Conflict{ConflictKind::RIGID_OVERLAP, {pair.first, pair.second}});
+            }
+        }
+        if (reach == nullptr || piece.range.get_high() > reach->range.get_high()) {
+            reach = &piece;
+        }
+    }
+}
+
+void find_dependency_window_conflicts(
+    const ProblemTable& problem,
+    std::vector<uint8_t>& reported,
+    std::vector<Conflict>& conflicts
+) {
+    const size_t n = problem.size();
+    std::vector<job_index_t> order;
+    order.reserve(n);
+    std::vector<uint32_t> in_degree(n);
+    for (job_index_t i = 0; i < n; ++i) {
+        in_degree[i] = problem.predecessor_offsets[i + 1] - problem.predecessor_offsets[i];
+        if (in_degree[i] == 0) {
+            order.push_back(i);
+        }
+    }
+    for (size_t head = 0; head < order.size(); ++head) {
+        const job_index_t job = order[head];
+        for (uint32_t k = problem.successor_offsets[job]; k < problem.successor_offsets[job + 1]; ++k) {
+            if (--in_degree[problem.successor_indices[k]] == 0) {
+                order.push_back(problem.successor_indices[k]);
+            }
+        }
+    }
+
+    // Earliest start and latest end of every job, and the neighbour that
+    // pushed each bound past the job's own window.
+    std::vector<sec_t> earliest_start(problem.window_low);
+    std::vector<sec_t> latest_end(problem.window_high);
+    std::vector<job_index_t> pushed_by(n, NO_JOB);
+    std::vector<job_index_t> pulled_by(n, NO_JOB);
+    for (job_index_t job : order) {
+        for (uint32_t k = problem.predecessor_offsets[job]; k < problem.predecessor_offsets[job + 1]; ++k) {
+            const job_index_t predecessor = problem.predecessor_indices[k];
+            const sec_t ready = earliest_start[predecessor] + problem.duration[predecessor];
+            if (ready > earliest_start[job]) {
+                earliest_start[job] = ready;
+                pushed_by[job] = predecessor;
+            }
+        }
+    }
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        const job_index_t job = *it;
+        for (uint32_t k = problem.successor_offsets[job]; k < problem.successor_offsets[job + 1]; ++k) {
+            const job_index_t successor = problem.successor_indices[k];
+            const sec_t due = latest_end[successor] > problem.duration[successor]
+                ? latest_end[successor] - problem.duration[successor]
+                : 0;
+            if (due < latest_end[job]) {
+                latest_end[job] = due;
+                pulled_by[job] = successor;
+            }
+        }
+    }
+
+    std::vector<job_index_t> chain;
+    for (job_index_t job : order) {
+        if (reported[job]
+            || (earliest_start[job] <= latest_end[job]
+                && latest_end[job] - earliest_start[job] >= problem.duration[job])) {
+            continue;
+        }
+        chain.clear();
+        for (job_index_t k = pushed_by[job]; k != NO_JOB; k = pushed_by[k]) {
+            chain.push_back(k);
+        }
+        std::reverse(chain.begin(), chain.end());
+        chain.push_back(job);
+        for (job_index_t k = pulled_by[job]; k != NO_JOB; k = pulled_by[k]) {
+            chain.push_back(k);
+        }
+        if (std::any_of(chain.begin(), chain.end(), [&reported](job_index_t k) { return reported[k] != 0; })) {
+            continue;
+        }
+        for (job_index_t k : chain) {
+            reported[k] = 1;
+        }
+        conflicts.push_back(Conflict{ConflictKind::DEPENDENCY_WINDOW, chain});
+    }
+}
+
+std::string join_names(
+    const std::vector<job_index_t>& jobs,
+    const std::function<std::string(job_index_t)>& name_of
+) {
+    std::string names;
+    for (size_t k = 0; k < jobs.size(); ++k) {
+        names += (k == 0 ? "" : " -> ") + name_of(jobs[k]);
+    }
+    return names;
+}
+
+} // namespace
+
+std::vector<Conflict> find_conflicts(const ProblemTable& problem) {
+    std::vector<Conflict> conflicts;
+    std::vector<uint8_t> reported(problem.size(), 0);
+    for (job_index_t i = 0; i < problem.size(); ++i) {
+        if (!window_fits(problem, i)) {
+            conflicts.push_back(Conflict{ConflictKind::WINDOW_TOO_SHORT, {i}});
+            reported[i] = 1;
+        }
+    }
+    find_rigid_overlaps(problem, conflicts);
+    if (problem.has_cyclic_dependencies) {
+        conflicts.push_back(Conflict{ConflictKind::DEPENDENCY_CYCLE, problem.dependency_cycle});
+    } else {
+        find_dependency_window_conflicts(problem, reported, conflicts);
+    }
+    return conflicts;
+}
+
+std::string describe_conflict(
+    const ProblemTable& problem,
+    const Conflict& conflict,
+    const std::function<std::string(job_index_t)>& name_of
+) {
+    switch (conflict.kind) {
+    case ConflictKind::WINDOW_TOO_SHORT: {
+        const job_index_t job = conflict.jobs.front();
+        return name_of(job) + " (" + std::to_string(problem.duration[job]) + "s) does not fit in its window ["
+            + std::to_string(problem.window_low[job]) + ", " + std::to_string(problem.window_high[job]) + ")";
+    }
+    case ConflictKind::RIGID_OVERLAP:
+        return "rigid jobs " + name_of(conflict.jobs[0]) + " and " + name_of(conflict.jobs[1]) + " overlap";
+    case ConflictKind::DEPENDENCY_CYCLE: {
+        std::vector<job_index_t> closed = conflict.jobs;
+        closed.push_back(conflict.jobs.front());
+        return "cyclic dependencies (each job waits for the previous one): " + join_names(closed, name_of);
+    }
+    case ConflictKind::DEPENDENCY_WINDOW:
+        return "dependency chain " + join_names(conflict.jobs, name_of) + " does not fit in its windows";
+    }
+    return "";
+}
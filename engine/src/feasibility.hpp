@@ -0,0 +1,48 @@
+#ifndef ELASTISCHED_FEASIBILITY_HPP
+#define ELASTISCHED_FEASIBILITY_HPP
+
+#include "problem_table.hpp"
+#include "types.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class ConflictKind {
+    // A flexible job has no start on the granularity grid that keeps it
+    // inside its window.
+    WINDOW_TOO_SHORT,
+    // Two rigid jobs that may not overlap do.
+    RIGID_OVERLAP,
+    // The dependencies contain a cycle; jobs lists it in order.
+    DEPENDENCY_CYCLE,
+    // Once its predecessors end as early as their windows allow and its
+    // successors start as late as theirs allow, a job no longer fits.
+    // jobs lists the chain that squeezes it, in dependency order.
+    DEPENDENCY_WINDOW,
+};
+
+struct Conflict {
+    ConflictKind kind;
+    std::vector<job_index_t> jobs;
+};
+
+/**
+ * Finds reasons why no placement of problem can be legal, without
+ * annealing: window checks, a sweep over the rigid jobs and propagation of
+ * the earliest start and latest end of every job through its
+ * dependencies. Runs in O(n log n + e) for n jobs and e dependencies.
+ *
+ * An empty result does not prove that a legal placement exists; every
+ * conflict found does prove that none does. Each job is named by at most
+ * one DEPENDENCY_WINDOW conflict so that one tight chain is reported once.
+ */
+std::vector<Conflict> find_conflicts(const ProblemTable& problem);
+
+// One line describing conflict, with jobs named by name_of.
+std::string describe_conflict(
+    const ProblemTable& problem,
+    const Conflict& conflict,
+    const std::function<std::string(job_index_t)>& name_of);
+
+#endif // ELASTISCHED_FEASIBILITY_HPP
@@ -0,0 +1,229 @@
+#include "greedy_placement.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+sec_t align_up(sec_t time, sec_t unit) {
+    return ((time + unit - 1) / unit) * unit;
+}
+
+/**
+ * BusyRanges
+ *
+ * Time already taken, as sorted, disjoint ranges. Touching ranges are
+ * merged, which never hides a gap a segment could use.
+ */
+class BusyRanges {
+public:
+    void insert(const TimeRange& range) {
+        if (range.get_low() == range.get_high()) {
+            return;
+        }
+        auto first = first_ending_after(range.get_low(), true);
+        auto last = first;
+        sec_t low = range.get_low();
+        sec_t high = range.get_high();
+        while (last != busy.end() && last->get_low() <= high) {
+            low = std::min(low, last->get_low());
+            high = std::max(high, last->get_high());
+            ++last;
+        }
+        first = busy.erase(first, last);
+        busy.insert(first, TimeRange(low, high));
+    }
+
+    // Earliest start on the unit grid, at or after from, such that
+    // [start, start + duration) is free and ends by deadline.
+    bool earliest_fit(sec_t from, sec_t deadline, sec_t duration, sec_t unit, sec_t& start) const {
+        start = align_up(from, unit);
+        auto it = first_ending_after(start, false);
+        while (start <= deadline && deadline - start >= duration) {
+            if (it == busy.end() || it->get_low() >= start + duration) {
+                return true;
+            }
+            start = std::max(start, align_up(it->get_high(), unit));
+            ++it;
+        }
+        return false;
+    }
+
+    // Cuts duration into at most max_segments pieces of at least min_split
+    // over the free gaps of [from, deadline), earliest first.
+    bool fill_gaps(
+        sec_t from,
+        sec_t deadline,
+        sec_t duration,
+        sec_t unit,
+        sec_t min_split,
+        bool round_to_unit,
+        size_t max_segments,
+        std::vector<TimeRange>& segments
+    ) const {
+        segments.clear();
+        sec_t remaining = duration;
+        sec_t cursor = align_up(from, unit);
+        auto it = first_ending_after(cursor, false);
+        while (remaining > 0 && segments.size() < max_segments && cursor < deadline) {
+            const sec_t gap_end = it == busy.end() ? deadline : std::min(deadline, it->get_low());
+            if (gap_end > cursor) {
+                sec_t chunk = std::min(gap_end - cursor, remaining);
+                if (round_to_unit) {
+                    chunk -= chunk % unit;
+                }
+                // Never leave a tail too short to be a segment of its own.
+                if (chunk < remaining && remaining - chunk < min_split) {
+                    chunk = remaining >= 2 * min_split ? remaining - min_split : 0;
+                }
+                if (chunk > 0 && chunk >= min_split) {
+                    segments.emplace_back(cursor, cursor + chunk);
+                    remaining -= chunk;
+                }
+            }
+            if (it == busy.end()) {
+                break;
+            }
+            cursor = std::max(cursor, align_up(it->get_high(), unit));
+            ++it;
+        }
+        return remaining == 0 && !segments.empty();
+    }
+
+private:
+    std::vector<TimeRange> busy;
+
+    std::vector<TimeRange>::iterator first_ending_after(sec_t time, bool inclusive) {
+        return std::partition_point(busy.begin(), busy.end(), [time, inclusive](const TimeRange& range) {
+            return inclusive ? range.get_high() < time : range.get_high() <= time;
+        });
+    }
+
+    std::vector<TimeRange>::const_iterator first_ending_after(sec_t time, bool inclusive) const {
+        return std::partition_point(busy.begin(), busy.end(), [time, inclusive](const TimeRange& range) {
+            return inclusive ? range.get_high() < time : range.get_high() <= time;
+        });
+    }
+};
+
+// Topological order of the dependency graph; among the jobs whose
+// predecessors are all ordered, the one with the least slack in its window
+// comes first. Jobs on a cycle are left out.
+std::vector<job_index_t> placement_order(const ProblemTable& problem) {
+    const size_t n = problem.size();
+    using Entry = std::tuple<sec_t, sec_t, job_index_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> ready;
+    std::vector<uint32_t> in_degree(n);
+    auto push = [&problem, &ready](job_index_t job) {
+        const sec_t window = problem.window_high[job] - problem.window_low[job];
+        const sec_t slack = window > problem.duration[job] ? window - problem.duration[job] : 0;
+        ready.emplace(slack, problem.window_low[job], job);
+    };
+    for (job_index_t i = 0; i < n; ++i) {
+        in_degree[i] = problem.predecessor_offsets[i + 1] - problem.predecessor_offsets[i];
+        if (in_degree[i] == 0) {
+            push(i);
+        }
+    }
+
+    std::vector<job_index_t> order;
+    order.reserve(n);
+    while (!ready.empty()) {
+        const job_index_t job = std::get<2>(ready.top());
+        ready.pop();
+        order.push_back(job);
+        for (uint32_t k = problem.successor_offsets[job]; k < problem.successor_offsets[job + 1]; ++k) {
+            const job_index_t successor = problem.successor_indices[k];
+            if (--in_degree[successor] == 0) {
+                push(successor);
+            }
+        }
+    }
+    return order;
+}
+
+} // namespace
+
+Placement greedy_placement(const ProblemTable& problem) {
+    Placement placement(problem);
+    const sec_t unit = problem.granularity > 0 ? problem.granularity : 1;
+
+    // Everything placed so far, and the part of it that hard jobs may not overlap.
+    BusyRanges busy_all;
+    BusyRanges busy_hard;
+    auto occupy = [&](job_index_t job) {
+        for (const TimeRange* range = placement.begin(job); range != placement.end(job); ++range) {
+            busy_all.insert(*range);
+            if (!problem.is_overlappable(job)) {
+                busy_hard.insert(*range);
+            }
+        }
+    };
+    for (job_index_t i = 0; i < problem.size(); ++i) {
+        if (problem.rigid[i]) {
+            occupy(i);
+        }
+    }
+
+    std::vector<TimeRange> segments;
+    for (job_index_t job : placement_order(problem)) {
+        if (problem.rigid[job]) {
+            continue;
+        }
+        const sec_t duration = problem.duration[job];
+        const bool hard = !problem.is_overlappable(job);
+
+        sec_t from = problem.window_low[job];
+        for (uint32_t k = problem.predecessor_offsets[job]; k < problem.predecessor_offsets[job + 1]; ++k) {
+            from = std::max(from, placement.latest_end[problem.predecessor_indices[k]]);
+        }
+        sec_t deadline = problem.window_high[job];
+        for (uint32_t k = problem.successor_offsets[job]; k < problem.successor_offsets[job + 1]; ++k) {
+            const job_index_t successor = problem.successor_indices[k];
+            if (problem.rigid[successor]) {
+                deadline = std::min(deadline, placement.earliest_start[successor]);
+            }
+        }
+
+        // Split pieces follow the same rules as split moves.
+        const bool can_split = problem.is_splittable(job) && problem.max_splits[job] > 0;
+        const bool round_to_unit = problem.rounds_to_granularity(job)
+            && problem.granularity > 0
+            && duration % problem.granularity == 0;
+        sec_t min_split = problem.min_split_duration[job] > 0 ? problem.min_split_duration[job] : 1;
+        if (round_to_unit) {
+            min_split = align_up(min_split, unit);
+        }
+        const size_t max_segments = static_cast<size_t>(problem.max_splits[job]) + 1;
+        auto split_into = [&](const BusyRanges& busy) {
+            return can_split
+                && busy.fill_gaps(from, deadline, duration, unit, min_split, round_to_unit, max_segments, segments);
+        };
+
+        sec_t start = 0;
+        bool whole = busy_all.earliest_fit(from, deadline, duration, unit, start);
+        bool split = !whole && split_into(busy_all);
+        if (!whole && !split && hard) {
+            whole = busy_hard.earliest_fit(from, deadline, duration, unit, start);
+            split = !whole && split_into(busy_hard);
+        }
+        if (!whole && !split && !hard) {
+            start = align_up(from, unit);
+            whole = start <= deadline && deadline - start >= duration;
+        }
+
+        if (whole) {
+            const TimeRange range(start, start + duration);
+            placement.assign(job, &range, 1);
+        } else if (split) {
+            placement.assign(job, segments.data(), static_cast<uint32_t>(segments.size()));
+        }
+        occupy(job);
+    }
+    return placement;
+}
@@ -0,0 +1,19 @@
+#ifndef ELASTISCHED_GREEDY_PLACEMENT_HPP
+#define ELASTISCHED_GREEDY_PLACEMENT_HPP
+
+#include "problem_table.hpp"
+
+/**
+ * Builds a placement of problem constructively, as a starting point for
+ * annealing. Rigid jobs keep their placement. Flexible jobs are then placed
+ * one at a time in dependency order, tightest window first: each goes to
+ * the earliest granularity-aligned start in its window that comes after its
+ * predecessors end, ends before its rigid successors start and overlaps
+ * nothing placed so far. Failing that, a hard job may overlap overlappable
+ * jobs, an overlappable job takes the earliest start, and a splittable job
+ * is cut into the free gaps. A job that fits nowhere keeps its initial
+ * placement.
+ */
+Placement greedy_placement(const ProblemTable& problem);
+
+#endif // ELASTISCHED_GREEDY_PLACEMENT_HPP
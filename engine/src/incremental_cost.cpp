@@ -0,0 +1,235 @@
+#include "incremental_cost.hpp"
+
+#include "constants.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+std::pair<sec_t, sec_t> ranges_span(const TimeRange* ranges, uint32_t count) {
+    sec_t earliest_start = ranges[0].get_low();
+    sec_t latest_end = ranges[0].get_high();
+    for (uint32_t k = 1; k < count; ++k) {
+        earliest_start = std::min(earliest_start, ranges[k].get_low());
+        latest_end = std::max(latest_end, ranges[k].get_high());
+    }
+    return {earliest_start, latest_end};
+}
+
+} // namespace
+
+IncrementalScheduleCost::IncrementalScheduleCost(
+    const ProblemTable& problem,
+    Placement& placement,
+    OverlapBackend backend
+)
+    :
+problem(problem),
+placement(placement)
+{
+    const size_t n = problem.size();
+    if (backend != OverlapBackend::CALENDAR) {
+        use_slots = SlotOccupancy::supports(problem, placement);
+        if (backend == OverlapBackend::SLOTS && !use_slots) {
+            throw std::invalid_argument("IncrementalScheduleCost: problem is not on the slot grid");
+        }
+    }
+    if (use_slots) {
+        slots = SlotOccupancy(problem, placement);
+    } else {
+        calendar = CalendarIndex(problem, placement);
+    }
+
+    // Every pairwise term is counted from both of its jobs, so sum the
+    // per-job terms and halve the pairwise parts.
+    Terms doubled;
+    sec_t self_overlap = 0;
+    size_t self_overlap_violations = 0;
+    for (job_index_t i = 0; i < n; ++i) {
+        const TimeRange* ranges = placement.begin(i);
+        const uint32_t count = placement.count(i);
+        Terms terms = job_terms(i, ranges, count);
+        doubled.containment_violations += terms.containment_violations;
+        doubled.splits += terms.splits;
+        doubled.overlap_violations += terms.overlap_violations;
+        doubled.dependency_violations += terms.dependency_violations;
+        doubled.overlap += terms.overlap;
+
+        for (uint32_t a = 0; a < count && !use_slots; ++a) {
+            for (uint32_t b = a + 1; b < count; ++b) {
+                if (ranges[a].overlaps(ranges[b])) {
+                    self_overlap += ranges[a].overlap_length(ranges[b]);
+                    if (!problem.is_overlappable(i)) {
+                        ++self_overlap_violations;
+                    }
+                }
+            }
+        }
+    }
+    totals.containment_violations = doubled.containment_violations;
+    totals.splits = doubled.splits;
+    totals.dependency_violations = doubled.dependency_violations / 2;
+    totals.overlap_violations = (doubled.overlap_violations - self_overlap_violations) / 2
+        + self_overlap_violations;
+    totals.overlap = (doubled.overlap - self_overlap) / 2 + self_overlap;
+    if (use_slots) {
+        totals.overlap_violations = slots.conflict_slots();
+        totals.overlap = static_cast<sec_t>(slots.overlap_slots() * problem.granularity);
+    }
+}
+
+IncrementalScheduleCost::Terms IncrementalScheduleCost::job_terms(
+    job_index_t job,
+    const TimeRange* ranges,
+    uint32_t count
+) const {
+    const bool is_hard = !problem.is_overlappable(job);
+    const sec_t window_low = problem.window_low[job];
+    const sec_t window_high = problem.window_high[job];
+    Terms terms;
+
+    if (count == 0) {
+        return terms;
+    }
+    terms.splits = count - 1;
+
+    for (uint32_t a = 0; a < count; ++a) {
+        if (ranges[a].get_low() < window_low || ranges[a].get_high() > window_high) {
+            ++terms.containment_violations;
+        }
+        for (uint32_t b = a + 1; b < count && !use_slots; ++b) {
+            if (ranges[a].overlaps(ranges[b])) {
+                terms.overlap += ranges[a].overlap_length(ranges[b]);
+                if (is_hard) {
+                    ++terms.overlap_violations;
+                }
+            }
+        }
+    }
+
+    // A segment pair is listed in every bucket both segments touch; it is
+    // only counted in the bucket where the later of the two starts. The
+    // slot backend keeps its overlap totals itself.
+    for (uint32_t a = 0; a < count && !use_slots; ++a) {
+        const TimeRange& range = ranges[a];
+        const uint32_t last = calendar.bucket_of(range.get_high());
+        for (uint32_t day = calendar.bucket_of(range.get_low()); day <= last; ++day) {
+            for (const CalendarEntry& entry : calendar.bucket(day)) {
+                if (entry.job == job) {
+                    continue;
+                }
+                const TimeRange& other_range = placement.begin(entry.job)[entry.segment];
+                if (!range.overlaps(other_range)
+                    || calendar.bucket_of(std::max(range.get_low(), other_range.get_low())) != day) {
+                    continue;
+                }
+                terms.overlap += range.overlap_length(other_range);
+                if (is_hard && !problem.is_overlappable(entry.job)) {
+                    ++terms.overlap_violations;
+                }
+            }
+        }
+    }
+
+    const auto [earliest_start, latest_end] = ranges_span(ranges, count);
+    for (uint32_t k = problem.predecessor_offsets[job]; k < problem.predecessor_offsets[job + 1]; ++k) {
+        if (placement.latest_end[problem.predecessor_indices[k]] > earliest_start) {
+            ++terms.dependency_violations;
+        }
+    }
+    for (uint32_t k = problem.successor_offsets[job]; k < problem.successor_offsets[job + 1]; ++k) {
+        if (latest_end > placement.earliest_start[problem.successor_indices[k]]) {
+            ++terms.dependency_violations;
+        }
+    }
+
+    return terms;
+}
+
+double IncrementalScheduleCost::terms_cost(const Terms& terms) const {
+    double cost = 0.0f;
+    if (problem.has_cyclic_dependencies
+        || terms.containment_violations > 0
+        || terms.overlap_violations > 0
+        || terms.dependency_violations > 0) {
+        cost += constants::ILLEGAL_SCHEDULE_COST;
+    }
+    const double granularity_value = problem.granularity > 0 ? static_cast<double>(problem.granularity) : 1.0;
+    cost += static_cast<double>(terms.overlap) / granularity_value;
+    cost += static_cast<double>(terms.splits) * constants::SPLIT_COST_FACTOR;
+    return cost;
+}
+
+void IncrementalScheduleCost::apply_delta(Terms& totals, const Terms& before, const Terms& after) {
+    totals.containment_violations = totals.containment_violations - before.containment_violations + after.containment_violations;
+    totals.overlap_violations = totals.overlap_violations - before.overlap_violations + after.overlap_violations;
+    totals.dependency_violations = totals.dependency_violations - before.dependency_violations + after.dependency_violations;
+    totals.overlap = totals.overlap - before.overlap + after.overlap;
+    totals.splits = totals.splits - before.splits + after.splits;
+}
+
+double IncrementalScheduleCost::cost() const {
+    return terms_cost(totals);
+}
+
+double IncrementalScheduleCost::apply(const ScheduleMove& move) {
+    if (use_slots && !slots.holds(move.ranges.data(), static_cast<uint32_t>(move.ranges.size()))) {
+        throw std::invalid_argument("IncrementalScheduleCost::apply: move leaves the slot grid");
+    }
+    if (journal_size == journal.size()) {
+        journal.emplace_back();
+    }
+    JournalEntry& entry = journal[journal_size++];
+    const job_index_t job = move.job_index;
+    const uint32_t count = static_cast<uint32_t>(move.ranges.size());
+
+    entry.job_index = job;
+    entry.ranges.assign(placement.begin(job), placement.end(job));
+    entry.before = job_terms(job, placement.begin(job), placement.count(job));
+    entry.after = job_terms(job, move.ranges.data(), count);
+    apply_delta(totals, entry.before, entry.after);
+
+    move_job(job, move.ranges.data(), count);
+    return cost();
+}
+
+void IncrementalScheduleCost::undo() {
+    if (journal_size == 0) {
+        return;
+    }
+    const JournalEntry& entry = journal[--journal_size];
+    apply_delta(totals, entry.after, entry.before);
+    move_job(entry.job_index, entry.ranges.data(), static_cast<uint32_t>(entry.ranges.size()));
+}
+
+void IncrementalScheduleCost::move_job(job_index_t job, const TimeRange* ranges, uint32_t count) {
+    if (use_slots) {
+        const bool hard = !problem.is_overlappable(job);
+        slots.remove(hard, placement.begin(job), placement.count(job));
+        placement.assign(job, ranges, count);
+        slots.insert(hard, ranges, count);
+        totals.overlap_violations = slots.conflict_slots();
+        totals.overlap = static_cast<sec_t>(slots.overlap_slots() * problem.granularity);
+    } else {
+        calendar.remove(job, placement.begin(job), placement.count(job));
+        placement.assign(job, ranges, count);
+        calendar.insert(job, ranges, count);
+    }
+}
+
+void IncrementalScheduleCost::accept() {
+    journal_size = 0;
+}
+
+bool IncrementalScheduleCost::in_conflict(job_index_t job) const {
+    const Terms terms = job_terms(job, placement.begin(job), placement.count(job));
+    if (terms.containment_violations > 0
+        || terms.overlap_violations > 0
+        || terms.dependency_violations > 0
+        || terms.overlap > 0) {
+        return true;
+    }
+    return use_slots && slots.crowded(placement.begin(job), placement.count(job));
+}
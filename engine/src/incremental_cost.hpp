@@ -0,0 +1,108 @@
+#ifndef ELASTISCHED_INCREMENTAL_COST_HPP
+#define ELASTISCHED_INCREMENTAL_COST_HPP
+
+#include "calendar_index.hpp"
+#include "problem_table.hpp"
+#include "slot_occupancy.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * ScheduleMove
+ *
+ * A neighbor move: the job at job_index is re-placed onto ranges while
+ * every other job keeps its current placement. Moves are reused between
+ * iterations so that their range buffer keeps its capacity; ranges may not
+ * hold more than ProblemTable::segment_capacity(job_index) entries.
+ */
+struct ScheduleMove {
+    job_index_t job_index = 0;
+    std::vector<TimeRange> ranges;
+};
+
+/**
+ * OverlapBackend
+ *
+ * How IncrementalScheduleCost finds the segments a move overlaps:
+ *  - CALENDAR looks them up in a CalendarIndex over the current placement
+ *    and works for any problem;
+ *  - SLOTS counts occupancy per granularity slot (see SlotOccupancy) and
+ *    needs every segment on the slot grid. Overlap violations are then
+ *    counted in slots rather than segment pairs, which changes nothing in
+ *    the cost;
+ *  - AUTO picks SLOTS whenever SlotOccupancy::supports the problem.
+ */
+enum class OverlapBackend {
+    AUTO,
+    CALENDAR,
+    SLOTS,
+};
+
+/**
+ * IncrementalScheduleCost
+ *
+ * Keeps the terms of ScheduleCostFunction::schedule_cost up to date for a
+ * Placement that changes one job at a time. apply() places a move in
+ * place, re-scoring only the moved job against the jobs it can interact
+ * with, and records the previous placement in a journal so that undo() can
+ * revert rejected moves. accept() forgets the journal.
+ *
+ * The overlap index of the chosen backend is kept in sync with the
+ * placement by apply() and undo().
+ */
+class IncrementalScheduleCost {
+private:
+    struct Terms {
+        size_t containment_violations = 0;
+        size_t overlap_violations = 0;
+        size_t dependency_violations = 0;
+        sec_t overlap = 0;
+        size_t splits = 0;
+    };
+
+    struct JournalEntry {
+        job_index_t job_index = 0;
+        std::vector<TimeRange> ranges;
+        Terms before;
+        Terms after;
+    };
+
+    const ProblemTable& problem;
+    Placement& placement;
+    bool use_slots = false;
+    CalendarIndex calendar;
+    SlotOccupancy slots;
+    Terms totals;
+
+    // Entries are reused between moves; only the first journal_size are live.
+    std::vector<JournalEntry> journal;
+    size_t journal_size = 0;
+
+    Terms job_terms(job_index_t job, const TimeRange* ranges, uint32_t count) const;
+    double terms_cost(const Terms& terms) const;
+    static void apply_delta(Terms& totals, const Terms& before, const Terms& after);
+    void move_job(job_index_t job, const TimeRange* ranges, uint32_t count);
+
+public:
+    // Throws std::invalid_argument if SLOTS is asked for and not supported.
+    IncrementalScheduleCost(
+        const ProblemTable& problem,
+        Placement& placement,
+        OverlapBackend backend = OverlapBackend::AUTO);
+
+    double cost() const;
+    // With the SLOTS backend, throws std::invalid_argument if the move
+    // leaves the slot grid; moves from generate_random_schedule_move never do.
+    double apply(const ScheduleMove& move);
+    void undo();
+    void accept();
+
+    // Whether job, where it is placed now, overlaps any segment or breaks
+    // its window or a dependency.
+    bool in_conflict(job_index_t job) const;
+};
+
+#endif // ELASTISCHED_INCREMENTAL_COST_HPP
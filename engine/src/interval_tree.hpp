@@ -1,160 +1,266 @@
 #ifndef ELASTISCHED_INTERVALTREE_HPP
 #define ELASTISCHED_INTERVALTREE_HPP
 
-#include <memory>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <iostream>
 #include <utility>
+#include <vector>
 #include "interval.hpp"
 
-template<typename T, typename U>
-struct Node {
-    std::unique_ptr<Interval<T>> interval;
-    U value;
-    T max;
-    std::unique_ptr<Node<T, U>> left;
-    std::unique_ptr<Node<T, U>> right;
-    
-    Node(std::unique_ptr<Interval<T>> interval_ptr, U node_value)
-        : interval(std::move(interval_ptr)),
-          value(node_value),
-          max(interval->get_high()),
-          left(nullptr),
-          right(nullptr) {}
-};
-
+/**
+ * IntervalTree
+ *
+ * Augmented AVL tree keyed on interval low. Nodes live contiguously in an
+ * arena and refer to each other by index, every node caches the largest
+ * high in its subtree, and insert and all queries are iterative, so sorted
+ * input neither degrades the tree into a list nor deepens the call stack.
+ *
+ * Pointers returned by the queries stay valid until the next insert.
+ */
 template<typename T, typename U>
 class IntervalTree {
 private:
-    std::unique_ptr<Node<T, U>> root;
-    
-    std::unique_ptr<Node<T, U>> insert(std::unique_ptr<Node<T, U>> node,
-                                       std::unique_ptr<Interval<T>> interval_ptr,
-                                       U value) {
-        if (!node) {
-            return std::make_unique<Node<T, U>>(std::move(interval_ptr), value);
-        }
-        T interval_low = interval_ptr->get_low();
-        T interval_high = interval_ptr->get_high();
+    using index_t = uint32_t;
+    static constexpr index_t NIL = UINT32_MAX;
+    // An AVL tree of 2^32 nodes is at most 46 levels deep.
+    static constexpr size_t MAX_DEPTH = 64;
 
-        if (interval_low < node->interval->get_low()) {
-            node->left = insert(std::move(node->left), std::move(interval_ptr), value);
-        } else {
-            node->right = insert(std::move(node->right), std::move(interval_ptr), value);
-        }
+    struct Node {
+        Interval<T> interval;
+        U value;
+        T max;
+        index_t left;
+        index_t right;
+        int32_t height;
 
-        node->max = std::max(node->max, interval_high);
-        return node;
-    }
+        Node(const Interval<T>& interval, U value)
+            : interval(interval),
+              value(std::move(value)),
+              max(interval.get_high()),
+              left(NIL),
+              right(NIL),
+              height(1) {}
+    };
 
-    bool do_overlap(Interval<T>* left, Interval<T>* right) const {
-        return left->overlaps(*right);
-    }
+    std::vector<Node> nodes;
+    index_t root = NIL;
 
-    Node<T, U>* overlap_search(Node<T, U>* node, Interval<T>& interval) const {
-        if (!node)
-            return nullptr;
-
-        if (do_overlap(node->interval.get(), &interval))
-            return node;
+    int32_t height(index_t node) const {
+        return node == NIL ? 0 : nodes[node].height;
+    }
 
-        if (node->left && node->left->max >= interval.get_low())
-            return overlap_search(node->left.get(), interval);
+    void update(index_t node) {
+        Node& n = nodes[node];
+        n.height = 1 + std::max(height(n.left), height(n.right));
+        n.max = n.interval.get_high();
+        if (n.left != NIL) {
+            n.max = std::max(n.max, nodes[n.left].max);
+        }
+        if (n.right != NIL) {
+            n.max = std::max(n.max, nodes[n.right].max);
+        }
+    }
 
-        return overlap_search(node->right.get(), interval);
+    index_t rotate_right(index_t node) {
+        const index_t pivot = nodes[node].left;
+        nodes[node].left = nodes[pivot].right;
+        nodes[pivot].right = node;
+        update(node);
+        update(pivot);
+        return pivot;
     }
 
-    void find_overlapping(const Node<T, U>* node,
-                          const Interval<T>& key,
-                          std::vector<const Interval<T>*>& result) const {
-        if (!node) return;
+    index_t rotate_left(index_t node) {
+        const index_t pivot = nodes[node].right;
+        nodes[node].right = nodes[pivot].left;
+        nodes[pivot].left = node;
+        update(node);
+        update(pivot);
+        return pivot;
+    }
 
-        if (node->interval->overlaps(key)) {
-            result.push_back(node->interval.get());
+    // Restores the AVL invariant at node and returns the subtree's new root.
+    index_t rebalance(index_t node) {
+        update(node);
+        const int32_t balance = height(nodes[node].left) - height(nodes[node].right);
+        if (balance > 1) {
+            const index_t left = nodes[node].left;
+            if (height(nodes[left].left) < height(nodes[left].right)) {
+                nodes[node].left = rotate_left(left);
+            }
+            return rotate_right(node);
+        }
+        if (balance < -1) {
+            const index_t right = nodes[node].right;
+            if (height(nodes[right].right) < height(nodes[right].left)) {
+                nodes[node].right = rotate_right(right);
+            }
+            return rotate_left(node);
         }
+        return node;
+    }
 
-        if (node->left && node->left->max >= key.get_low()) {
-            find_overlapping(node->left.get(), key, result);
+    /**
+     * Depth-first walk over the nodes whose interval overlaps key. visit
+     * returns true to stop the walk; the index of that node is returned, or
+     * NIL if the walk ran to completion.
+     */
+    template<typename Visitor>
+    index_t walk_overlapping(const Interval<T>& key, Visitor&& visit) const {
+        std::array<index_t, 2 * MAX_DEPTH> stack;
+        size_t top = 0;
+        if (root != NIL) {
+            stack[top++] = root;
         }
-        if (node->right && node->interval->get_low() <= key.get_high()) {
-            find_overlapping(node->right.get(), key, result);
+        while (top > 0) {
+            const index_t current = stack[--top];
+            const Node& node = nodes[current];
+            // Point intervals overlap a key that starts at their position,
+            // so subtrees ending exactly at key.low are still searched.
+            if (node.max < key.get_low()) {
+                continue;
+            }
+            if (node.interval.overlaps(key) && visit(current)) {
+                return current;
+            }
+            if (node.right != NIL && node.interval.get_low() <= key.get_high()) {
+                stack[top++] = node.right;
+            }
+            if (node.left != NIL) {
+                stack[top++] = node.left;
+            }
         }
+        return NIL;
     }
 
-    std::unique_ptr<Node<T, U>> clone_node(const std::unique_ptr<Node<T, U>>& node) const {
-        if (!node)
-            return nullptr;
+    index_t first_overlap(const Interval<T>& key) const {
+        return walk_overlapping(key, [](index_t) { return true; });
+    }
 
-        auto new_interval = std::make_unique<Interval<T>>(*node->interval);
-        auto new_node = std::make_unique<Node<T, U>>(std::move(new_interval), node->value);
-        new_node->max = node->max;
-        new_node->left = clone_node(node->left);
-        new_node->right = clone_node(node->right);
-        return new_node;
+public:
+    IntervalTree() = default;
+
+    void reserve(size_t count) {
+        nodes.reserve(count);
     }
 
-    void print_in_order(const Node<T, U>* node) const {
-        if (!node) return;
-        print_in_order(node->left.get());
-        std::cout << "[" << node->interval->get_low() << ", " << node->interval->get_high()
-                  << "] max=" << node->max << std::endl;
-        print_in_order(node->right.get());
+    size_t size() const {
+        return nodes.size();
     }
 
-public:
-    IntervalTree() = default;
-    
-    IntervalTree(const IntervalTree<T, U>& other) {
-        root = clone_node(other.root);
-    }
-    
-    IntervalTree<T, U>& operator=(const IntervalTree<T, U>& other) {
-        if (this != &other) {
-            root = clone_node(other.root);
-        }
-        return *this;
+    void clear() {
+        nodes.clear();
+        root = NIL;
     }
-    
+
     void insert(T low, T high, U value) {
-        auto interval = std::make_unique<Interval<T>>(low, high);
-        root = insert(std::move(root), std::move(interval), value);
+        insert(Interval<T>(low, high), std::move(value));
     }
-    
+
     void insert(Interval<T> interval, U value) {
-        auto i = std::make_unique<Interval<T>>(interval);
-        root = insert(std::move(root), std::move(i), value);
+        const index_t inserted = static_cast<index_t>(nodes.size());
+        nodes.emplace_back(interval, std::move(value));
+        if (root == NIL) {
+            root = inserted;
+            return;
+        }
+
+        std::array<index_t, MAX_DEPTH> path;
+        size_t depth = 0;
+        index_t current = root;
+        while (current != NIL) {
+            path[depth++] = current;
+            current = interval.get_low() < nodes[current].interval.get_low()
+                ? nodes[current].left
+                : nodes[current].right;
+        }
+        const index_t parent = path[depth - 1];
+        if (interval.get_low() < nodes[parent].interval.get_low()) {
+            nodes[parent].left = inserted;
+        } else {
+            nodes[parent].right = inserted;
+        }
+
+        // Rebalance bottom-up, re-linking each rebalanced subtree to its parent.
+        index_t subtree = NIL;
+        for (size_t level = depth; level-- > 0;) {
+            subtree = rebalance(path[level]);
+            if (level > 0) {
+                Node& up = nodes[path[level - 1]];
+                if (up.left == path[level]) {
+                    up.left = subtree;
+                } else {
+                    up.right = subtree;
+                }
+            }
+        }
+        root = subtree;
+    }
+
+    /**
+     * Calls visit(interval, value) for every stored interval overlapping key,
+     * without allocating.
+     */
+    template<typename Visitor>
+    void visit_overlapping(const Interval<T>& key, Visitor&& visit) const {
+        walk_overlapping(key, [this, &visit](index_t node) {
+            visit(nodes[node].interval, nodes[node].value);
+            return false;
+        });
     }
 
     Interval<T>* search_overlap(Interval<T> query) const {
-        auto result = overlap_search(root.get(), query);
-        return result ? result->interval.get() : nullptr;
+        const index_t result = first_overlap(query);
+        return result == NIL ? nullptr : const_cast<Interval<T>*>(&nodes[result].interval);
     }
-    
+
     Interval<T>* search_overlap(T low, T high) const {
         return search_overlap(Interval<T>(low, high));
     }
 
     std::vector<const Interval<T>*> find_overlapping(const Interval<T>& key) const {
         std::vector<const Interval<T>*> result;
-        find_overlapping(root.get(), key, result);
+        walk_overlapping(key, [this, &result](index_t node) {
+            result.push_back(&nodes[node].interval);
+            return false;
+        });
         return result;
     }
 
     U* search_value(T low, T high) const {
-        Interval<T> query(low, high);
-        auto result = overlap_search(root.get(), query);
-        return result ? &result->value : nullptr;
+        const index_t result = first_overlap(Interval<T>(low, high));
+        return result == NIL ? nullptr : const_cast<U*>(&nodes[result].value);
     }
 
     U* search_value(Interval<T> interval) const {
         return search_value(interval.get_low(), interval.get_high());
     }
 
-    bool is_in(const Interval<T>& interval) {
+    bool is_in(const Interval<T>& interval) const {
         return search_overlap(interval.get_low(), interval.get_high()) != nullptr;
     }
-    
+
+    int32_t depth() const {
+        return height(root);
+    }
+
     void print() const {
-        print_in_order(root.get());
+        std::array<index_t, MAX_DEPTH> stack;
+        size_t top = 0;
+        index_t current = root;
+        while (current != NIL || top > 0) {
+            while (current != NIL) {
+                stack[top++] = current;
+                current = nodes[current].left;
+            }
+            current = stack[--top];
+            const Node& node = nodes[current];
+            std::cout << "[" << node.interval.get_low() << ", " << node.interval.get_high()
+                      << "] max=" << node.max << std::endl;
+            current = node.right;
+        }
     }
 };
 
@@ -0,0 +1,492 @@
+#include "engine.hpp"
+#include "feasibility.hpp"
+#include "incremental_cost.hpp"
+#include "parallel.hpp"
+#include "problem_json.hpp"
+#include "problem_table.hpp"
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * engine
+ *
+ * Solves problem files offline and streams one JSON line per problem as
+ * it finishes. Problems are JSON (see problem_json.hpp) or snapshots
+ * (see snapshot.hpp); snapshots are solved straight from the mapping.
+ * Directories are expanded to the .json and .elsnap files they hold.
+ * --write-snapshots saves each solved problem as DIR/N-stem.elsnap, N
+ * being the problem's position in the run.
+ *
+ * With several problems each is solved on one thread and --workers
+ * problems run at once; a single problem uses the workers for its
+ * components instead.
+ */
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+constexpr const char* SNAPSHOT_EXTENSION = ".elsnap";
+
+struct Options {
+    std::vector<std::string> inputs;
+    uint64_t workers = 0;
+    bool has_time_budget = false;
+    uint64_t time_budget_ms = 0;
+    bool has_seed = false;
+    uint64_t seed = 0;
+    bool has_iters = false;
+    uint64_t num_iters = 0;
+    std::string output_path;
+    bool with_schedule = true;
+    std::string snapshot_dir;
+};
+
+/**
+ * Outcome
+ *
+ * What is reported for one problem, whichever format it came from. The
+ * segments of job i are [segment_low[k], segment_high[k]) for k in
+ * [segment_offsets[i], segment_offsets[i + 1]).
+ */
+struct Outcome {
+    std::vector<std::string> ids;
+    std::vector<uint32_t> segment_offsets;
+    std::vector<sec_t> segment_low;
+    std::vector<sec_t> segment_high;
+    FeasibilityReport feasibility;
+    SolveStats stats;
+    uint64_t seed = 0;
+    double cost = 0.0;
+};
+
+bool is_snapshot(const fs::path& path) {
+    return path.extension() == SNAPSHOT_EXTENSION;
+}
+
+std::vector<fs::path> expand_inputs(const std::vector<std::string>& inputs) {
+    std::vector<fs::path> files;
+    for (const std::string& input : inputs) {
+        if (!fs::is_directory(input)) {
+            files.emplace_back(input);
+            continue;
+        }
+        std::vector<fs::path> found;
+        for (const fs::directory_entry& entry : fs::directory_iterator(input)) {
+            if (entry.is_regular_file() && (entry.path().extension() == ".json" || is_snapshot(entry.path()))) {
+                found.push_back(entry.path());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    return files;
+}
+
+void apply_overrides(EngineConfig& config, const Options& options) {
+    if (options.has_time_budget) {
+        config.time_budget_ms = options.time_budget_ms;
+    }
+    if (options.has_seed) {
+        config.seed = options.seed;
+    }
+    if (options.has_iters) {
+        config.num_iters = options.num_iters;
+    }
+}
+
+// The config a problem is solved with. Workers are handed out by the
+// driver, and only the final cost is reported.
+EngineConfig run_config(EngineConfig config, uint64_t num_workers) {
+    config.num_workers = num_workers;
+    config.cost_history.mode = CostHistoryMode::OFF;
+    return config;
+}
+
+// Cost of the placement a batch solve returned, scored on the whole batch
+// so dependencies between components count too.
+double batch_cost(const ProblemTable& problem, const BatchSolveResult& result) {
+    Placement placement(problem);
+    std::vector<TimeRange> ranges;
+    for (job_index_t i = 0; i < problem.size(); ++i) {
+        ranges.clear();
+        for (uint32_t k = result.segment_offsets[i]; k < result.segment_offsets[i + 1]; ++k) {
+            ranges.emplace_back(result.segment_low[k], result.segment_high[k]);
+        }
+        placement.assign(i, ranges.data(), static_cast<uint32_t>(ranges.size()));
+    }
+    return IncrementalScheduleCost(problem, placement).cost();
+}
+
+// Where the snapshot of files[index] is written. The position in the run
+// keeps inputs with the same stem, or the same file given twice, apart.
+fs::path snapshot_path(const Options& options, const std::vector<fs::path>& files, size_t index) {
+    const size_t width = std::to_string(files.size() - 1).size();
+    std::string prefix = std::to_string(index);
+    prefix.insert(0, width - prefix.size(), '0');
+    return fs::path(options.snapshot_dir) / (prefix + "-" + files[index].stem().string() + SNAPSHOT_EXTENSION);
+}
+
+// Both solvers write the solved problem to snapshot unless it is empty.
+Outcome solve_json(const fs::path& path, const fs::path& snapshot, const Options& options, uint64_t num_workers) {
+    SolveRequest request = load_problem_json(path.string());
+    apply_overrides(request.config, options);
+    std::vector<Job> problem_jobs;
+    if (!snapshot.empty()) {
+        problem_jobs = request.jobs;
+    }
+    SolveResult result = solve(std::move(request.jobs), run_config(request.config, num_workers));
+
+    Outcome outcome;
+    outcome.feasibility = std::move(result.feasibility);
+    outcome.stats = result.stats;
+    outcome.seed = result.seed;
+    outcome.cost = ScheduleCostFunction(result.schedule, request.config.granularity).schedule_cost();
+    outcome.ids.reserve(result.schedule.scheduled_jobs.size());
+    outcome.segment_offsets.push_back(0);
+    for (const Job& job : result.schedule.scheduled_jobs) {
+        outcome.ids.push_back(job.id);
+        for (const TimeRange& range : job.get_scheduled_time_ranges()) {
+            outcome.segment_low.push_back(range.get_low());
+            outcome.segment_high.push_back(range.get_high());
+        }
+        outcome.segment_offsets.push_back(static_cast<uint32_t>(outcome.segment_low.size()));
+    }
+    if (!snapshot.empty()) {
+        // With the seed it ran with, so the snapshot replays this solve.
+        request.config.seed = result.seed;
+        write_snapshot(snapshot.string(), problem_jobs, request.config, &result.schedule);
+    }
+    return outcome;
+}
+
+Outcome solve_snapshot(const fs::path& path, const fs::path& snapshot_out, const Options& options, uint64_t num_workers) {
+    const MappedSnapshot snapshot(path.string());
+    EngineConfig config = snapshot.config();
+    apply_overrides(config, options);
+    const JobBatch batch = snapshot.batch();
+    BatchSolveResult result = solve_batch(batch, run_config(config, num_workers));
+
+    Outcome outcome;
+    outcome.ids.reserve(batch.size);
+    for (job_index_t i = 0; i < batch.size; ++i) {
+        outcome.ids.emplace_back(snapshot.id(i));
+    }
+    // Batch conflicts name jobs by index; name them by id, message too, as
+    // a JSON problem would.
+    const ProblemTable problem = compile_batch(batch, config.granularity);
+    const auto name_of = [&outcome](job_index_t job) { return outcome.ids[job]; };
+    for (FeasibilityConflict& conflict : result.feasibility.conflicts) {
+        Conflict indexed{conflict.kind, {}};
+        for (std::string& job : conflict.job_ids) {
+            indexed.jobs.push_back(static_cast<job_index_t>(std::stoul(job)));
+            job = outcome.ids[indexed.jobs.back()];
+        }
+        conflict.message = describe_conflict(problem, indexed, name_of);
+    }
+    outcome.feasibility = std::move(result.feasibility);
+    outcome.stats = result.stats;
+    outcome.seed = result.seed;
+    outcome.cost = batch_cost(problem, result);
+    outcome.segment_offsets = std::move(result.segment_offsets);
+    outcome.segment_low = std::move(result.segment_low);
+    outcome.segment_high = std::move(result.segment_high);
+    if (!snapshot_out.empty()) {
+        const std::vector<Job> jobs = snapshot.jobs();
+        std::vector<Job> placed = jobs;
+        for (job_index_t i = 0; i < placed.size(); ++i) {
+            std::vector<TimeRange> ranges;
+            for (uint32_t k = outcome.segment_offsets[i]; k < outcome.segment_offsets[i + 1]; ++k) {
+                ranges.emplace_back(outcome.segment_low[k], outcome.segment_high[k]);
+            }
+            placed[i].set_scheduled_time_ranges(std::move(ranges));
+        }
+        const Schedule schedule(std::move(placed));
+        config.seed = outcome.seed;
+        write_snapshot(snapshot_out.string(), jobs, config, &schedule);
+    }
+    return outcome;
+}
+
+void append_escaped(std::string& out, std::string_view text) {
+    out += '"';
+    for (const char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+void append_number(std::string& out, double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.10g", value);
+    out += text;
+}
+
+const char* conflict_name(ConflictKind kind) {
+    switch (kind) {
+    case ConflictKind::WINDOW_TOO_SHORT: return "WINDOW_TOO_SHORT";
+    case ConflictKind::RIGID_OVERLAP: return "RIGID_OVERLAP";
+    case ConflictKind::DEPENDENCY_CYCLE: return "DEPENDENCY_CYCLE";
+    case ConflictKind::DEPENDENCY_WINDOW: return "DEPENDENCY_WINDOW";
+    }
+    return "UNKNOWN";
+}
+
+void append_stats(std::string& out, const SolveStats& stats) {
+    const std::pair<const char*, double> seconds[] = {
+        {"compile_seconds", stats.compile_seconds},
+        {"feasibility_seconds", stats.feasibility_seconds},
+        {"partition_seconds", stats.partition_seconds},
+        {"greedy_seconds", stats.greedy_seconds},
+        {"anneal_seconds", stats.anneal_seconds},
+        {"move_generation_seconds", stats.move_generation_seconds},
+        {"cost_evaluation_seconds", stats.cost_evaluation_seconds},
+        {"write_back_seconds", stats.write_back_seconds},
+    };
+    const std::pair<const char*, uint64_t> counters[] = {
+        {"cost_evaluations", stats.cost_evaluations},
+        {"accepted_moves", stats.accepted_moves},
+        {"rejected_moves", stats.rejected_moves},
+        {"improving_moves", stats.improving_moves},
+        {"split_attempts", stats.split_attempts},
+        {"merge_attempts", stats.merge_attempts},
+        {"split_placement_failures", stats.split_placement_failures},
+        {"window_sampling_failures", stats.window_sampling_failures},
+    };
+    out += '{';
+    for (const auto& [name, value] : seconds) {
+        out += '"';
+        out += name;
+        out += "\": ";
+        append_number(out, value);
+        out += ", ";
+    }
+    for (const auto& [name, value] : counters) {
+        out += '"';
+        out += name;
+        out += "\": ";
+        out += std::to_string(value);
+        out += ", ";
+    }
+    out.resize(out.size() - 2);
+    out += '}';
+}
+
+std::string result_line(const std::string& file, const Outcome& outcome, double solve_ms, bool with_schedule) {
+    std::string line = "{\"file\": ";
+    append_escaped(line, file);
+    line += ", \"jobs\": " + std::to_string(outcome.ids.size());
+    line += ", \"feasible\": ";
+    line += outcome.feasibility.feasible() ? "true" : "false";
+    line += ", \"cost\": ";
+    append_number(line, outcome.cost);
+    line += ", \"seed\": " + std::to_string(outcome.seed);
+    line += ", \"solve_ms\": ";
+    append_number(line, solve_ms);
+    line += ", \"stats\": ";
+    append_stats(line, outcome.stats);
+
+    line += ", \"conflicts\": [";
+    for (size_t c = 0; c < outcome.feasibility.conflicts.size(); ++c) {
+        const FeasibilityConflict& conflict = outcome.feasibility.conflicts[c];
+        line += c > 0 ? ", {\"kind\": \"" : "{\"kind\": \"";
+        line += conflict_name(conflict.kind);
+        line += "\", \"jobs\": [";
+        for (size_t j = 0; j < conflict.job_ids.size(); ++j) {
+            if (j > 0) {
+                line += ", ";
+            }
+            append_escaped(line, conflict.job_ids[j]);
+        }
+        line += "], \"message\": ";
+        append_escaped(line, conflict.message);
+        line += '}';
+    }
+    line += ']';
+
+    if (with_schedule) {
+        line += ", \"schedule\": {";
+        for (size_t i = 0; i < outcome.ids.size(); ++i) {
+            if (i > 0) {
+                line += ", ";
+            }
+            append_escaped(line, outcome.ids[i]);
+            line += ": [";
+            for (uint32_t k = outcome.segment_offsets[i]; k < outcome.segment_offsets[i + 1]; ++k) {
+                if (k > outcome.segment_offsets[i]) {
+                    line += ", ";
+                }
+                line += '[' + std::to_string(outcome.segment_low[k]) + ", " + std::to_string(outcome.segment_high[k]) + ']';
+            }
+            line += ']';
+        }
+        line += '}';
+    }
+    line += "}\n";
+    return line;
+}
+
+std::string error_line(const std::string& file, const std::string& message) {
+    std::string line = "{\"file\": ";
+    append_escaped(line, file);
+    line += ", \"error\": ";
+    append_escaped(line, message);
+    line += "}\n";
+    return line;
+}
+
+void usage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [--workers N] [--time-budget-ms N] [--seed N] [--iters N]\n"
+                 "          [--output FILE] [--no-schedule] [--write-snapshots DIR] PATH...\n"
+                 "PATH is a problem (.json, or a .elsnap snapshot) or a directory of them.\n"
+                 "Writes one JSON line per problem, in completion order, to FILE or stdout;\n"
+                 "--time-budget-ms, --seed and --iters override every problem's config;\n"
+                 "--write-snapshots saves problem N of the run as DIR/N-<name>.elsnap.\n",
+                 program);
+}
+
+// Reads a whole decimal number; strtoull alone would take "abc" as 0 and
+// "-1" as its largest value.
+bool parse_count(const char* value, uint64_t& out) {
+    if (*value < '0' || *value > '9') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    out = std::strtoull(value, &end, 10);
+    return *end == '\0' && errno == 0;
+}
+
+bool parse_options(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* flag = argv[i];
+        if (flag[0] != '-') {
+            options.inputs.emplace_back(flag);
+            continue;
+        }
+        if (std::strcmp(flag, "--no-schedule") == 0) {
+            options.with_schedule = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        bool valid = true;
+        if (std::strcmp(flag, "--workers") == 0) {
+            valid = parse_count(value, options.workers);
+        } else if (std::strcmp(flag, "--time-budget-ms") == 0) {
+            options.has_time_budget = true;
+            valid = parse_count(value, options.time_budget_ms);
+        } else if (std::strcmp(flag, "--seed") == 0) {
+            options.has_seed = true;
+            valid = parse_count(value, options.seed);
+        } else if (std::strcmp(flag, "--iters") == 0) {
+            options.has_iters = true;
+            valid = parse_count(value, options.num_iters);
+        } else if (std::strcmp(flag, "--output") == 0) {
+            options.output_path = value;
+        } else if (std::strcmp(flag, "--write-snapshots") == 0) {
+            options.snapshot_dir = value;
+        } else {
+            return false;
+        }
+        if (!valid) {
+            std::fprintf(stderr, "%s: not a non-negative integer: %s\n", flag, value);
+            return false;
+        }
+    }
+    return !options.inputs.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<fs::path> files;
+    try {
+        files = expand_inputs(options.inputs);
+        if (!options.snapshot_dir.empty()) {
+            fs::create_directories(options.snapshot_dir);
+        }
+    } catch (const fs::filesystem_error& error) {
+        std::fprintf(stderr, "%s\n", error.what());
+        return 1;
+    }
+
+    std::FILE* out = options.output_path.empty() ? stdout : std::fopen(options.output_path.c_str(), "w");
+    if (out == nullptr) {
+        std::fprintf(stderr, "cannot write %s\n", options.output_path.c_str());
+        return 1;
+    }
+
+    const size_t workers = resolve_worker_count(options.workers);
+    const uint64_t problem_workers = files.size() == 1 ? workers : 1;
+    std::mutex out_mutex;
+    std::atomic<size_t> failures{0};
+    const Clock::time_point start = Clock::now();
+
+    parallel_for(files.size(), workers, [&](size_t f) {
+        const fs::path& path = files[f];
+        std::string line;
+        try {
+            const fs::path snapshot = options.snapshot_dir.empty() ? fs::path() : snapshot_path(options, files, f);
+            const Clock::time_point solve_start = Clock::now();
+            const Outcome outcome = is_snapshot(path)
+                ? solve_snapshot(path, snapshot, options, problem_workers)
+                : solve_json(path, snapshot, options, problem_workers);
+            const double solve_ms = std::chrono::duration<double, std::milli>(Clock::now() - solve_start).count();
+            line = result_line(path.string(), outcome, solve_ms, options.with_schedule);
+        } catch (const std::exception& error) {
+            failures.fetch_add(1);
+            line = error_line(path.string(), error.what());
+        }
+        std::lock_guard<std::mutex> lock(out_mutex);
+        std::fwrite(line.data(), 1, line.size(), out);
+        std::fflush(out);
+    });
+
+    const double total_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    std::fprintf(stderr, "%zu problems, %zu failed, %.1f ms (%.1f problems/s)\n",
+                 files.size(), failures.load(), total_ms,
+                 total_ms > 0.0 ? 1000.0 * files.size() / total_ms : 0.0);
+    return failures.load() > 0 ? 1 : 0;
+}
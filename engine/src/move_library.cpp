@@ -0,0 +1,628 @@
+#include "move_library.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr job_index_t NO_JOB = std::numeric_limits<job_index_t>::max();
+
+// Jobs sampled when looking for one in conflict.
+constexpr int TARGET_SAMPLES = 8;
+// Largest shift of SHIFT and SEGMENT moves, in granularity steps.
+constexpr uint64_t MAX_SHIFT_STEPS = 4;
+// Partners tried before a SWAP gives up.
+constexpr int SWAP_ATTEMPTS = 4;
+
+// Outcomes between two weight updates, the weight given to the latest
+// period's score and the score of an accepted and of an improving move.
+constexpr uint64_t ADAPT_PERIOD = 256;
+constexpr double ADAPT_RATE = 0.2;
+constexpr double ACCEPTED_SCORE = 1.0;
+constexpr double IMPROVED_SCORE = 4.0;
+// Floor that keeps every applicable kind in play.
+constexpr double MIN_WEIGHT = 0.05;
+
+TimeRange generate_random_time_range_within(
+    const TimeRange& schedulable_time_range,
+    sec_t duration,
+    sec_t granularity,
+    Rng& gen)
+{
+    // A granularity of 0 places jobs to the second, as greedy placement does.
+    const sec_t step = granularity > 0 ? granularity : 1;
+    sec_t earliest_start = ((schedulable_time_range.get_low() + step - 1) / step) * step;
+    sec_t raw_latest_start = schedulable_time_range.get_high() - duration;
+    sec_t latest_start = (raw_latest_start / step) * step;
+
+    if (latest_start < earliest_start) {
+        throw std::invalid_argument("Schedulable timerange too small for the job duration");
+    }
+
+    size_t num_slots = (latest_start - earliest_start) / step + 1;
+
+    std::uniform_int_distribution<size_t> dis(0, num_slots - 1);
+    size_t random_slot = dis(gen);
+
+    sec_t start = earliest_start + random_slot * step;
+    return TimeRange(start, start + duration);
+}
+
+bool generate_split_durations(
+    sec_t duration,
+    size_t segment_count,
+    sec_t min_split_duration,
+    sec_t granularity,
+    bool round_to_granularity,
+    Rng& gen,
+    MoveScratch& scratch
+) {
+    std::vector<sec_t>& durations = scratch.split_durations;
+    durations.clear();
+    if (segment_count <= 1) {
+        durations.push_back(duration);
+        return true;
+    }
+
+    sec_t unit = 1;
+    if (round_to_granularity && granularity > 0 && duration % granularity == 0) {
+        unit = granularity;
+    } else {
+        round_to_granularity = false;
+    }
+
+    sec_t min_split = min_split_duration > 0 ? min_split_duration : 1;
+    if (round_to_granularity && unit > 1) {
+        min_split = ((min_split + unit - 1) / unit) * unit;
+    }
+
+    if (min_split * segment_count > duration) {
+        return false;
+    }
+
+    durations.assign(segment_count, min_split);
+    sec_t remaining = duration - min_split * segment_count;
+
+    if (round_to_granularity && unit > 1) {
+        if (remaining % unit != 0) {
+            return false;
+        }
+        size_t increments = remaining / unit;
+        std::uniform_int_distribution<size_t> dist(0, segment_count - 1);
+        for (size_t i = 0; i < increments; ++i) {
+            durations[dist(gen)] += unit;
+        }
+        return true;
+    }
+
+    if (remaining > 0) {
+        std::vector<sec_t>& cuts = scratch.cuts;
+        cuts.clear();
+        std::uniform_int_distribution<sec_t> dist(0, remaining);
+        cuts.push_back(0);
+        cuts.push_back(remaining);
+        for (size_t i = 0; i < segment_count - 1; ++i) {
+            cuts.push_back(dist(gen));
+        }
+        std::sort(cuts.begin(), cuts.end());
+        for (size_t i = 0; i < segment_count; ++i) {
+            durations[i] += (cuts[i + 1] - cuts[i]);
+        }
+    }
+    return true;
+}
+
+/**
+ * Lays the segments of scratch.split_durations out in a random order with
+ * random gaps between them. Every segment starts on the granularity grid
+ * and the layout packs them as tightly as the grid allows, so the
+ * remaining slack, in grid steps, is exactly what the gaps can share; it
+ * is split by sorted random cuts. Fails only when no placement in the
+ * window exists.
+ */
+bool place_split_segments(
+    const TimeRange& schedulable_time_range,
+    sec_t granularity,
+    Rng& gen,
+    MoveScratch& scratch,
+    std::vector<TimeRange>& segments
+) {
+    std::vector<sec_t>& durations = scratch.split_durations;
+    segments.clear();
+    if (durations.empty()) {
+        return true;
+    }
+    const sec_t step = granularity > 0 ? granularity : 1;
+    auto steps_of = [step](sec_t duration) {
+        return (duration + step - 1) / step;
+    };
+    std::shuffle(durations.begin(), durations.end(), gen);
+
+    const sec_t first_start = steps_of(schedulable_time_range.get_low()) * step;
+    const sec_t high = schedulable_time_range.get_high();
+    sec_t total_steps = 0;
+    for (sec_t duration : durations) {
+        total_steps += steps_of(duration);
+    }
+    // Every segment takes whole grid steps except the last, which only
+    // needs its duration; steps_free is the slack left for the gaps.
+    auto steps_free = [&](sec_t tail, sec_t& free) {
+        const sec_t packed_steps = total_steps - steps_of(tail);
+        if (first_start > high || high - first_start < tail
+            || (high - first_start - tail) / step < packed_steps) {
+            return false;
+        }
+        free = (high - first_start - tail) / step - packed_steps;
+        return true;
+    };
+
+    sec_t slack = 0;
+    if (!steps_free(durations.back(), slack)) {
+        // The segment that wastes the most of its last step is the best
+        // one to end with.
+        const auto last = std::max_element(durations.begin(), durations.end(), [&](sec_t a, sec_t b) {
+            return steps_of(a) * step - a < steps_of(b) * step - b;
+        });
+        std::iter_swap(last, durations.end() - 1);
+        if (!steps_free(durations.back(), slack)) {
+            return false;
+        }
+    }
+
+    std::vector<sec_t>& cuts = scratch.cuts;
+    cuts.clear();
+    std::uniform_int_distribution<sec_t> dist(0, slack);
+    for (size_t k = 0; k < durations.size(); ++k) {
+        cuts.push_back(dist(gen));
+    }
+    std::sort(cuts.begin(), cuts.end());
+
+    sec_t start = first_start;
+    sec_t previous_cut = 0;
+    for (size_t k = 0; k < durations.size(); ++k) {
+        start += (cuts[k] - previous_cut) * step;
+        previous_cut = cuts[k];
+        segments.emplace_back(start, start + durations[k]);
+        start += steps_of(durations[k]) * step;
+    }
+    return true;
+}
+
+bool within(const TimeRange& range, const TimeRange& window) {
+    return range.get_low() >= window.get_low() && range.get_high() <= window.get_high();
+}
+
+void sort_ranges(std::vector<TimeRange>& ranges) {
+    std::sort(ranges.begin(), ranges.end(), [](const TimeRange& a, const TimeRange& b) {
+        return a.get_low() < b.get_low();
+    });
+}
+
+} // namespace
+
+// Fills out with a random re-placement of chosen_index anywhere in its
+// window. The range buffer of out is overwritten rather than reallocated.
+void MoveLibrary::resample(job_index_t chosen_index, Rng& gen, ScheduleMove& out) {
+    const sec_t granularity = problem.granularity;
+
+    out.job_index = chosen_index;
+    out.ranges.clear();
+
+    const sec_t duration = problem.duration[chosen_index];
+    const TimeRange schedulable_time_range = problem.window(chosen_index);
+    bool can_split = problem.is_splittable(chosen_index) && problem.max_splits[chosen_index] > 0;
+    sec_t min_split_duration = problem.min_split_duration[chosen_index];
+    sec_t min_split = min_split_duration > 0 ? min_split_duration : 1;
+    bool round_to_granularity = problem.rounds_to_granularity(chosen_index)
+        && granularity > 0
+        && (duration % granularity == 0);
+    if (round_to_granularity && granularity > 1) {
+        min_split = ((min_split + granularity - 1) / granularity) * granularity;
+    }
+    size_t max_segments = static_cast<size_t>(problem.max_splits[chosen_index]) + 1;
+    size_t max_segments_by_duration = static_cast<size_t>(duration / min_split);
+    size_t possible_segments = std::min(max_segments, max_segments_by_duration);
+    const bool is_currently_split = placement.count(chosen_index) > 1;
+
+    if (is_currently_split) {
+        constexpr double merge_probability = 0.3;
+        std::bernoulli_distribution merge_decision(merge_probability);
+        if (merge_decision(gen)) {
+            ELASTISCHED_STAT(++counters.merge_attempts);
+            out.ranges.push_back(generate_random_time_range_within(
+                schedulable_time_range,
+                duration,
+                granularity,
+                gen
+            ));
+            return;
+        }
+    }
+
+    bool attempt_split = false;
+    if (can_split && possible_segments >= 2) {
+        std::uniform_int_distribution<int> split_decision(0, 1);
+        attempt_split = (split_decision(gen) == 1);
+    }
+
+    if (attempt_split) {
+        ELASTISCHED_STAT(++counters.split_attempts);
+        std::uniform_int_distribution<size_t> split_count_dist(2, possible_segments);
+        size_t segment_count = split_count_dist(gen);
+        bool has_durations = generate_split_durations(
+            duration,
+            segment_count,
+            min_split_duration,
+            granularity,
+            round_to_granularity,
+            gen,
+            scratch
+        );
+
+        if (has_durations && place_split_segments(
+                schedulable_time_range,
+                granularity,
+                gen,
+                scratch,
+                out.ranges)) {
+            return;
+        }
+        ELASTISCHED_STAT(++counters.split_placement_failures);
+    }
+
+    out.ranges.push_back(generate_random_time_range_within(
+        schedulable_time_range,
+        duration,
+        granularity,
+        gen
+    ));
+}
+
+
+MoveLibrary::MoveLibrary(
+    const ProblemTable& problem,
+    const std::vector<job_index_t>& flexible_indices,
+    const Placement& placement,
+    IncrementalScheduleCost& cost_model,
+    bool adaptive
+)
+    :
+problem(problem),
+flexible_indices(flexible_indices),
+placement(placement),
+cost_model(cost_model),
+adaptive(adaptive)
+{
+    bool has_splittable = false;
+    for (job_index_t job : flexible_indices) {
+        has_splittable = has_splittable || problem.segment_capacity(job) > 1;
+    }
+    for (size_t k = 0; k < MOVE_KIND_COUNT; ++k) {
+        kinds[k].stats.kind = static_cast<MoveKind>(k);
+        kinds[k].weight = 1.0;
+    }
+    if (!adaptive) {
+        for (size_t k = 1; k < MOVE_KIND_COUNT; ++k) {
+            kinds[k].weight = 0.0;
+        }
+    }
+    if (flexible_indices.size() < 2) {
+        kinds[static_cast<size_t>(MoveKind::SWAP)].weight = 0.0;
+    }
+    if (!has_splittable) {
+        kinds[static_cast<size_t>(MoveKind::SEGMENT)].weight = 0.0;
+    }
+}
+
+MoveKind MoveLibrary::pick_kind(Rng& gen) const {
+    double total = 0.0;
+    for (const KindState& kind : kinds) {
+        total += kind.weight;
+    }
+    double point = std::uniform_real_distribution<double>(0.0, total)(gen);
+    for (size_t k = 0; k < MOVE_KIND_COUNT; ++k) {
+        if (point < kinds[k].weight) {
+            return static_cast<MoveKind>(k);
+        }
+        point -= kinds[k].weight;
+    }
+    return MoveKind::RESAMPLE;
+}
+
+// Samples a few flexible jobs and returns the first that fits and is in
+// conflict, else the first that fits, else NO_JOB.
+template <typename Predicate>
+job_index_t MoveLibrary::pick_job(Rng& gen, Predicate fits) const {
+    std::uniform_int_distribution<size_t> dist(0, flexible_indices.size() - 1);
+    job_index_t fallback = NO_JOB;
+    for (int sample = 0; sample < TARGET_SAMPLES; ++sample) {
+        const job_index_t job = flexible_indices[dist(gen)];
+        if (!fits(job)) {
+            continue;
+        }
+        if (cost_model.in_conflict(job)) {
+            return job;
+        }
+        if (fallback == NO_JOB) {
+            fallback = job;
+        }
+    }
+    return fallback;
+}
+
+bool MoveLibrary::shift(job_index_t job, Rng& gen) {
+    const sec_t step = problem.granularity > 0 ? problem.granularity : 1;
+    const sec_t offset = static_cast<sec_t>(std::uniform_int_distribution<uint64_t>(1, MAX_SHIFT_STEPS)(gen)) * step;
+    const TimeRange window = problem.window(job);
+    const bool later_first = std::bernoulli_distribution(0.5)(gen);
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const bool later = later_first == (attempt == 0);
+        if (!later && placement.earliest_start[job] < window.get_low() + offset) {
+            continue;
+        }
+        if (later && placement.latest_end[job] + offset > window.get_high()) {
+            continue;
+        }
+        move.job_index = job;
+        move.ranges.clear();
+        for (const TimeRange* range = placement.begin(job); range != placement.end(job); ++range) {
+            move.ranges.push_back(later
+                ? TimeRange(range->get_low() + offset, range->get_high() + offset)
+                : TimeRange(range->get_low() - offset, range->get_high() - offset));
+        }
+        return true;
+    }
+    return false;
+}
+
+bool MoveLibrary::swap(job_index_t job, Rng& gen) {
+    const sec_t start = placement.begin(job)->get_low();
+    std::uniform_int_distribution<size_t> dist(0, flexible_indices.size() - 1);
+    for (int attempt = 0; attempt < SWAP_ATTEMPTS; ++attempt) {
+        const job_index_t partner = flexible_indices[dist(gen)];
+        if (partner == job || placement.count(partner) != 1) {
+            continue;
+        }
+        const sec_t partner_start = placement.begin(partner)->get_low();
+        const TimeRange moved(partner_start, partner_start + problem.duration[job]);
+        const TimeRange partner_moved(start, start + problem.duration[partner]);
+        if (!within(moved, problem.window(job)) || !within(partner_moved, problem.window(partner))) {
+            continue;
+        }
+        move.job_index = job;
+        move.ranges.assign(1, moved);
+        partner_move.job_index = partner;
+        partner_move.ranges.assign(1, partner_moved);
+        return true;
+    }
+    return false;
+}
+
+bool MoveLibrary::move_segment(job_index_t job, Rng& gen) {
+    const uint32_t count = placement.count(job);
+    const uint32_t chosen = std::uniform_int_distribution<uint32_t>(0, count - 1)(gen);
+    const TimeRange& segment = placement.begin(job)[chosen];
+    const TimeRange window = problem.window(job);
+    const sec_t step = problem.granularity > 0 ? problem.granularity : 1;
+
+    TimeRange moved = segment;
+    if (std::bernoulli_distribution(0.5)(gen)) {
+        const sec_t offset = static_cast<sec_t>(std::uniform_int_distribution<uint64_t>(1, MAX_SHIFT_STEPS)(gen)) * step;
+        if (std::bernoulli_distribution(0.5)(gen)) {
+            moved = TimeRange(segment.get_low() + offset, segment.get_high() + offset);
+        } else if (segment.get_low() >= offset) {
+            moved = TimeRange(segment.get_low() - offset, segment.get_high() - offset);
+        }
+    } else if (window.length() >= segment.length()) {
+        try {
+            moved = generate_random_time_range_within(window, segment.length(), step, gen);
+        } catch (const std::invalid_argument&) {
+            ELASTISCHED_STAT(++counters.window_sampling_failures);
+            return false;
+        }
+    }
+    if (moved == segment || !within(moved, window)) {
+        return false;
+    }
+
+    move.job_index = job;
+    move.ranges.clear();
+    for (uint32_t k = 0; k < count; ++k) {
+        const TimeRange& other = placement.begin(job)[k];
+        if (k == chosen) {
+            continue;
+        }
+        if (other.overlaps(moved)) {
+            return false;
+        }
+        move.ranges.push_back(other);
+    }
+    move.ranges.push_back(moved);
+    sort_ranges(move.ranges);
+    return true;
+}
+
+double MoveLibrary::apply(Rng& gen) {
+#if ELASTISCHED_SOLVE_STATS
+    using StatsClock = std::chrono::steady_clock;
+    const bool timed = proposals++ % STATS_TIMING_PERIOD == 0;
+    const StatsClock::time_point generation_start = timed ? StatsClock::now() : StatsClock::time_point{};
+#endif
+    cost_before = cost_model.cost();
+    last_kind = adaptive ? pick_kind(gen) : MoveKind::RESAMPLE;
+
+    job_index_t job = NO_JOB;
+    bool built = false;
+    switch (last_kind) {
+    case MoveKind::RESAMPLE:
+        break;
+    case MoveKind::TARGETED:
+        job = pick_job(gen, [](job_index_t) { return true; });
+        break;
+    case MoveKind::SHIFT:
+        job = pick_job(gen, [](job_index_t) { return true; });
+        built = shift(job, gen);
+        break;
+    case MoveKind::SWAP:
+        job = pick_job(gen, [this](job_index_t k) { return placement.count(k) == 1; });
+        built = job != NO_JOB && swap(job, gen);
+        break;
+    case MoveKind::SEGMENT:
+        job = pick_job(gen, [this](job_index_t k) { return placement.count(k) > 1; });
+        built = job != NO_JOB && move_segment(job, gen);
+        break;
+    }
+
+    if (!built) {
+        if (job == NO_JOB) {
+            std::uniform_int_distribution<> dist(0, flexible_indices.size() - 1);
+            job = flexible_indices[dist(gen)];
+        }
+        if (last_kind != MoveKind::TARGETED) {
+            last_kind = MoveKind::RESAMPLE;
+        }
+        try {
+            resample(job, gen, move);
+        } catch (const std::invalid_argument&) {
+            ELASTISCHED_STAT(++counters.window_sampling_failures);
+            move.job_index = job;
+            move.ranges.assign(placement.begin(job), placement.end(job));
+        }
+    }
+
+#if ELASTISCHED_SOLVE_STATS
+    const StatsClock::time_point evaluation_start = timed ? StatsClock::now() : StatsClock::time_point{};
+#endif
+    ++kinds[static_cast<size_t>(last_kind)].stats.proposed;
+    applied = 1;
+    double cost = cost_model.apply(move);
+    if (built && last_kind == MoveKind::SWAP) {
+        applied = 2;
+        cost = cost_model.apply(partner_move);
+    }
+    ELASTISCHED_STAT(counters.cost_evaluations += applied);
+#if ELASTISCHED_SOLVE_STATS
+    if (timed) {
+        const double period = static_cast<double>(STATS_TIMING_PERIOD);
+        counters.move_generation_seconds
+            += std::chrono::duration<double>(evaluation_start - generation_start).count() * period;
+        counters.cost_evaluation_seconds
+            += std::chrono::duration<double>(StatsClock::now() - evaluation_start).count() * period;
+    }
+#endif
+    return cost;
+}
+
+void MoveLibrary::undo() {
+    revert();
+    record(false);
+}
+
+double MoveLibrary::probe(Rng& gen) {
+    const SolveStats saved_counters = counters;
+    const std::array<KindState, MOVE_KIND_COUNT> saved_kinds = kinds;
+#if ELASTISCHED_SOLVE_STATS
+    const uint64_t saved_proposals = proposals;
+#endif
+    const double cost = apply(gen);
+    counters = saved_counters;
+    kinds = saved_kinds;
+#if ELASTISCHED_SOLVE_STATS
+    proposals = saved_proposals;
+#endif
+    return cost;
+}
+
+void MoveLibrary::discard() {
+    revert();
+}
+
+void MoveLibrary::revert() {
+    for (; applied > 0; --applied) {
+        cost_model.undo();
+    }
+}
+
+void MoveLibrary::accept() {
+    applied = 0;
+    cost_model.accept();
+    record(true);
+}
+
+void MoveLibrary::record(bool accepted) {
+    KindState& kind = kinds[static_cast<size_t>(last_kind)];
+    ++kind.period_proposed;
+    ELASTISCHED_STAT(++(accepted ? counters.accepted_moves : counters.rejected_moves));
+    if (accepted) {
+        ++kind.stats.accepted;
+        if (cost_model.cost() < cost_before) {
+            ELASTISCHED_STAT(++counters.improving_moves);
+            ++kind.stats.improved;
+            kind.period_score += IMPROVED_SCORE;
+        } else {
+            kind.period_score += ACCEPTED_SCORE;
+        }
+    }
+    if (adaptive && ++outcomes % ADAPT_PERIOD == 0) {
+        adapt();
+    }
+}
+
+void MoveLibrary::adapt() {
+    for (KindState& kind : kinds) {
+        if (kind.period_proposed == 0 || kind.weight == 0.0) {
+            continue;
+        }
+        const double score = kind.period_score / static_cast<double>(kind.period_proposed);
+        kind.weight = std::max(MIN_WEIGHT, (1.0 - ADAPT_RATE) * kind.weight + ADAPT_RATE * score);
+        kind.period_proposed = 0;
+        kind.period_score = 0.0;
+    }
+}
+
+std::vector<MoveStats> MoveLibrary::stats() const {
+    double total = 0.0;
+    for (const KindState& kind : kinds) {
+        total += kind.weight;
+    }
+    std::vector<MoveStats> stats;
+    stats.reserve(MOVE_KIND_COUNT);
+    for (const KindState& kind : kinds) {
+        stats.push_back(kind.stats);
+        stats.back().share = total > 0.0 ? kind.weight / total : 0.0;
+    }
+    return stats;
+}
+
+const SolveStats& MoveLibrary::solve_stats() const {
+    return counters;
+}
+
+std::vector<MoveStats> merge_move_stats(const std::vector<std::vector<MoveStats>>& per_chain) {
+    std::vector<MoveStats> merged;
+    size_t chains = 0;
+    for (const std::vector<MoveStats>& stats : per_chain) {
+        if (stats.empty()) {
+            continue;
+        }
+        if (merged.empty()) {
+            merged.resize(stats.size());
+            for (size_t k = 0; k < stats.size(); ++k) {
+                merged[k].kind = stats[k].kind;
+            }
+        }
+        for (size_t k = 0; k < stats.size(); ++k) {
+            merged[k].proposed += stats[k].proposed;
+            merged[k].accepted += stats[k].accepted;
+            merged[k].improved += stats[k].improved;
+            merged[k].share += stats[k].share;
+        }
+        ++chains;
+    }
+    for (MoveStats& stats : merged) {
+        stats.share /= static_cast<double>(chains);
+    }
+    return merged;
+}
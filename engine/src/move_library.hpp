@@ -0,0 +1,141 @@
+#ifndef ELASTISCHED_MOVE_LIBRARY_HPP
+#define ELASTISCHED_MOVE_LIBRARY_HPP
+
+#include "incremental_cost.hpp"
+#include "problem_table.hpp"
+#include "rng.hpp"
+#include "solve_stats.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class MoveKind : uint8_t {
+    // Re-place a uniformly random job anywhere in its window.
+    RESAMPLE,
+    // Re-place a job that currently overlaps another or breaks its window
+    // or a dependency.
+    TARGETED,
+    // Shift every segment of a job by a few granularity steps.
+    SHIFT,
+    // Exchange the starts of two unsplit jobs.
+    SWAP,
+    // Move one segment of a split job.
+    SEGMENT,
+};
+
+constexpr size_t MOVE_KIND_COUNT = 5;
+
+/**
+ * MoveStats
+ *
+ * How one kind of move fared: how often it was proposed, accepted and
+ * accepted with a lower cost, and its share of the proposals when the run
+ * ended.
+ */
+struct MoveStats {
+    MoveKind kind = MoveKind::RESAMPLE;
+    uint64_t proposed = 0;
+    uint64_t accepted = 0;
+    uint64_t improved = 0;
+    double share = 0.0;
+};
+
+// Buffers reused across neighbor moves so split moves do not allocate.
+struct MoveScratch {
+    std::vector<sec_t> split_durations;
+    std::vector<sec_t> cuts;
+};
+
+/**
+ * MoveLibrary
+ *
+ * Proposes neighbor moves for an annealing chain and applies them to its
+ * cost model. Without adaptive weights every proposal is a RESAMPLE. With
+ * them, each proposal picks a MoveKind with probability proportional to a
+ * weight that follows the kind's recent acceptance and improvement rates,
+ * so operators that stop paying off are proposed less. Kinds that cannot
+ * apply to the problem (SWAP with one flexible job, SEGMENT without
+ * splittable jobs) get no weight, and a move that cannot be built falls
+ * back to a RESAMPLE of the same job.
+ *
+ * TARGETED, SHIFT, SWAP and SEGMENT pick their job from a few samples,
+ * preferring one that is in conflict where it is placed now.
+ *
+ * A move that finds no start on the grid inside its window leaves the job
+ * where it is. Such moves and the other SolveStats counters of the
+ * annealing loop are kept in solve_stats().
+ */
+class MoveLibrary {
+public:
+    MoveLibrary(
+        const ProblemTable& problem,
+        const std::vector<job_index_t>& flexible_indices,
+        const Placement& placement,
+        IncrementalScheduleCost& cost_model,
+        bool adaptive);
+
+    MoveLibrary(const MoveLibrary&) = delete;
+    MoveLibrary& operator=(const MoveLibrary&) = delete;
+
+    // Proposes a move, applies it and returns the new cost.
+    double apply(Rng& gen);
+    void undo();
+    void accept();
+
+    // Applies a move like apply, for temperature calibration, and reverts
+    // it. Probes are left out of stats(), solve_stats() and the weights.
+    double probe(Rng& gen);
+    void discard();
+
+    std::vector<MoveStats> stats() const;
+    const SolveStats& solve_stats() const;
+
+private:
+    struct KindState {
+        MoveStats stats;
+        double weight = 0.0;
+        uint64_t period_proposed = 0;
+        double period_score = 0.0;
+    };
+
+    const ProblemTable& problem;
+    const std::vector<job_index_t>& flexible_indices;
+    const Placement& placement;
+    IncrementalScheduleCost& cost_model;
+    bool adaptive;
+
+    std::array<KindState, MOVE_KIND_COUNT> kinds;
+    uint64_t outcomes = 0;
+    MoveKind last_kind = MoveKind::RESAMPLE;
+    double cost_before = 0.0;
+    uint32_t applied = 0;
+    SolveStats counters;
+#if ELASTISCHED_SOLVE_STATS
+    uint64_t proposals = 0;
+#endif
+
+    ScheduleMove move;
+    ScheduleMove partner_move;
+    MoveScratch scratch;
+
+    MoveKind pick_kind(Rng& gen) const;
+    template <typename Predicate>
+    job_index_t pick_job(Rng& gen, Predicate fits) const;
+
+    void resample(job_index_t job, Rng& gen, ScheduleMove& out);
+    bool shift(job_index_t job, Rng& gen);
+    bool swap(job_index_t job, Rng& gen);
+    bool move_segment(job_index_t job, Rng& gen);
+
+    void revert();
+    void record(bool accepted);
+    void adapt();
+};
+
+// Adds up the stats of several chains kind by kind; shares are averaged.
+std::vector<MoveStats> merge_move_stats(const std::vector<std::vector<MoveStats>>& per_chain);
+
+#endif // ELASTISCHED_MOVE_LIBRARY_HPP
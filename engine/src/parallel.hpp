@@ -0,0 +1,112 @@
+#ifndef ELASTISCHED_PARALLEL_HPP
+#define ELASTISCHED_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+inline size_t resolve_worker_count(size_t requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    size_t hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+/**
+ * Reusable thread barrier. The last thread to arrive runs on_completion
+ * before any waiting thread is released, which gives a single-threaded
+ * window between phases.
+ */
+class Barrier {
+public:
+    explicit Barrier(size_t count) : count(count), waiting(0), phase(0) {}
+
+    template<typename Completion>
+    void arrive_and_wait(Completion&& on_completion) {
+        std::unique_lock<std::mutex> lock(mutex);
+        const size_t arrival_phase = phase;
+        if (++waiting == count) {
+            on_completion();
+            waiting = 0;
+            ++phase;
+            condition.notify_all();
+            return;
+        }
+        condition.wait(lock, [this, arrival_phase] { return phase != arrival_phase; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t count;
+    size_t waiting;
+    size_t phase;
+};
+
+/**
+ * Runs task(i) for every i in [0, count) on up to num_workers threads
+ * (0 = one per hardware thread). Tasks are handed out in index order from a
+ * shared counter. The first exception thrown by a task is rethrown on the
+ * calling thread once every worker has finished.
+ *
+ * A task taking two arguments is called as task(i, worker), where worker
+ * in [0, min(num_workers, count)) names the thread running it, so that
+ * each thread can keep scratch space of its own.
+ */
+template<typename Task>
+void parallel_for(size_t count, size_t num_workers, Task&& task) {
+    if (count == 0) {
+        return;
+    }
+    auto invoke = [&task](size_t i, size_t worker) {
+        if constexpr (std::is_invocable_v<Task&, size_t, size_t>) {
+            task(i, worker);
+        } else {
+            task(i);
+        }
+    };
+    const size_t workers = std::min(resolve_worker_count(num_workers), count);
+    if (workers == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            invoke(i, 0);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::vector<std::exception_ptr> errors(workers);
+    auto run = [&](size_t worker) {
+        try {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                invoke(i, worker);
+            }
+        } catch (...) {
+            errors[worker] = std::current_exception();
+            next.store(count);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; ++worker) {
+        threads.emplace_back(run, worker);
+    }
+    run(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+#endif // ELASTISCHED_PARALLEL_HPP
@@ -2,10 +2,10 @@
 #include "policy.hpp"
 
 namespace {
-const uint8_t kPolicySplittable = 1 << 0;
-const uint8_t kPolicyOverlappable = 1 << 1;
-const uint8_t kPolicyInvisible = 1 << 2;
-const uint8_t kPolicyRoundToGranularity = 1 << 3;
+const uint8_t kPolicySplittable = policy_flags::SPLITTABLE;
+const uint8_t kPolicyOverlappable = policy_flags::OVERLAPPABLE;
+const uint8_t kPolicyInvisible = policy_flags::INVISIBLE;
+const uint8_t kPolicyRoundToGranularity = policy_flags::ROUND_TO_GRANULARITY;
 }  // namespace
 
 Policy::Policy(uint8_t max_splits,
@@ -16,6 +16,13 @@
  *      -> is_invisible (bit 2)
  *      -> round_to_granularity (bit 3)
  */
+namespace policy_flags {
+constexpr uint8_t SPLITTABLE = 1 << 0;
+constexpr uint8_t OVERLAPPABLE = 1 << 1;
+constexpr uint8_t INVISIBLE = 1 << 2;
+constexpr uint8_t ROUND_TO_GRANULARITY = 1 << 3;
+}  // namespace policy_flags
+
 class Policy {
 private:
     uint8_t max_splits;
@@ -0,0 +1,528 @@
+#include "problem_json.hpp"
+
+#include "policy.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr size_t MAX_NESTING = 64;
+
+/**
+ * JsonValue
+ *
+ * One parsed JSON value. Numbers keep their literal text so that 64-bit
+ * times convert exactly; objects keep their members in file order.
+ */
+struct JsonValue {
+    enum class Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type = Type::NUL;
+    bool boolean = false;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* find(const std::string& key) const {
+        for (const auto& member : members) {
+            if (member.first == key) {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : text(text) {}
+
+    JsonValue parse_document() {
+        JsonValue value = parse_value(0);
+        skip_whitespace();
+        if (position != text.size()) {
+            fail("trailing characters");
+        }
+        return value;
+    }
+
+private:
+    const std::string& text;
+    size_t position = 0;
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::invalid_argument("problem: " + message + " at byte " + std::to_string(position));
+    }
+
+    void skip_whitespace() {
+        while (position < text.size()
+               && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r')) {
+            ++position;
+        }
+    }
+
+    void expect(char c) {
+        skip_whitespace();
+        if (position >= text.size() || text[position] != c) {
+            fail(std::string("expected '") + c + "'");
+        }
+        ++position;
+    }
+
+    bool consume(char c) {
+        skip_whitespace();
+        if (position < text.size() && text[position] == c) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    void expect_literal(const char* literal) {
+        for (const char* c = literal; *c != '\0'; ++c, ++position) {
+            if (position >= text.size() || text[position] != *c) {
+                fail("invalid literal");
+            }
+        }
+    }
+
+    JsonValue parse_value(size_t depth) {
+        if (depth > MAX_NESTING) {
+            fail("nesting too deep");
+        }
+        skip_whitespace();
+        if (position >= text.size()) {
+            fail("unexpected end of input");
+        }
+        JsonValue value;
+        const char c = text[position];
+        if (c == '{') {
+            ++position;
+            value.type = JsonValue::Type::OBJECT;
+            if (consume('}')) {
+                return value;
+            }
+            do {
+                skip_whitespace();
+                std::string key = parse_string();
+                expect(':');
+                value.members.emplace_back(std::move(key), parse_value(depth + 1));
+            } while (consume(','));
+            expect('}');
+        } else if (c == '[') {
+            ++position;
+            value.type = JsonValue::Type::ARRAY;
+            if (consume(']')) {
+                return value;
+            }
+            do {
+                value.items.push_back(parse_value(depth + 1));
+            } while (consume(','));
+            expect(']');
+        } else if (c == '"') {
+            value.type = JsonValue::Type::STRING;
+            value.text = parse_string();
+        } else if (c == 't') {
+            expect_literal("true");
+            value.type = JsonValue::Type::BOOLEAN;
+            value.boolean = true;
+        } else if (c == 'f') {
+            expect_literal("false");
+            value.type = JsonValue::Type::BOOLEAN;
+        } else if (c == 'n') {
+            expect_literal("null");
+        } else {
+            value.type = JsonValue::Type::NUMBER;
+            value.text = parse_number();
+        }
+        return value;
+    }
+
+    std::string parse_number() {
+        const size_t start = position;
+        auto digits = [this] {
+            const size_t first = position;
+            while (position < text.size() && text[position] >= '0' && text[position] <= '9') {
+                ++position;
+            }
+            return position > first;
+        };
+        if (position < text.size() && text[position] == '-') {
+            ++position;
+        }
+        if (!digits()) {
+            fail("invalid value");
+        }
+        if (position < text.size() && text[position] == '.') {
+            ++position;
+            if (!digits()) {
+                fail("invalid number");
+            }
+        }
+        if (position < text.size() && (text[position] == 'e' || text[position] == 'E')) {
+            ++position;
+            if (position < text.size() && (text[position] == '+' || text[position] == '-')) {
+                ++position;
+            }
+            if (!digits()) {
+                fail("invalid number");
+            }
+        }
+        return text.substr(start, position - start);
+    }
+
+    unsigned hex_digit() {
+        if (position >= text.size()) {
+            fail("unexpected end of input");
+        }
+        const char c = text[position++];
+        if (c >= '0' && c <= '9') return static_cast<unsigned>(c - '0');
+        if (c >= 'a' && c <= 'f') return static_cast<unsigned>(c - 'a' + 10);
+        if (c >= 'A' && c <= 'F') return static_cast<unsigned>(c - 'A' + 10);
+        fail("invalid \\u escape");
+    }
+
+    unsigned code_unit() {
+        unsigned unit = 0;
+        for (int i = 0; i < 4; ++i) {
+            unit = unit * 16 + hex_digit();
+        }
+        return unit;
+    }
+
+    static void append_utf8(std::string& out, unsigned code_point) {
+        if (code_point < 0x80) {
+            out += static_cast<char>(code_point);
+        } else if (code_point < 0x800) {
+            out += static_cast<char>(0xC0 | (code_point >> 6));
+            out += static_cast<char>(0x80 | (code_point & 0x3F));
+        } else if (code_point < 0x10000) {
+            out += static_cast<char>(0xE0 | (code_point >> 12));
+            out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code_point & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code_point >> 18));
+            out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code_point & 0x3F));
+        }
+    }
+
+    std::string parse_string() {
+        if (position >= text.size() || text[position] != '"') {
+            fail("expected a string");
+        }
+        ++position;
+        std::string out;
+        while (true) {
+            if (position >= text.size()) {
+                fail("unterminated string");
+            }
+            const char c = text[position++];
+            if (c == '"') {
+                return out;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                fail("control character in string");
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (position >= text.size()) {
+                fail("unterminated string");
+            }
+            switch (text[position++]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned code_point = code_unit();
+                if (code_point >= 0xD800 && code_point < 0xDC00) {
+                    // High surrogate: must be followed by \u and a low one.
+                    if (text.compare(position, 2, "\\u") != 0) {
+                        fail("unpaired surrogate");
+                    }
+                    position += 2;
+                    const unsigned low = code_unit();
+                    if (low < 0xDC00 || low >= 0xE000) {
+                        fail("unpaired surrogate");
+                    }
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                } else if (code_point >= 0xDC00 && code_point < 0xE000) {
+                    fail("unpaired surrogate");
+                }
+                append_utf8(out, code_point);
+                break;
+            }
+            default:
+                fail("invalid escape");
+            }
+        }
+    }
+};
+
+[[noreturn]] void invalid(const std::string& what, const std::string& expected) {
+    throw std::invalid_argument("problem: " + what + " must be " + expected);
+}
+
+const JsonValue& require(const JsonValue& object, const std::string& key, const std::string& what) {
+    const JsonValue* value = object.find(key);
+    if (value == nullptr) {
+        throw std::invalid_argument("problem: " + what + " is missing \"" + key + "\"");
+    }
+    return *value;
+}
+
+uint64_t as_unsigned(const JsonValue& value, const std::string& what, uint64_t max = std::numeric_limits<uint64_t>::max()) {
+    if (value.type != JsonValue::Type::NUMBER || value.text[0] == '-') {
+        invalid(what, "a non-negative integer");
+    }
+    uint64_t result;
+    if (value.text.find_first_of(".eE") == std::string::npos) {
+        errno = 0;
+        result = std::strtoull(value.text.c_str(), nullptr, 10);
+        if (errno == ERANGE) {
+            invalid(what, "at most " + std::to_string(max));
+        }
+    } else {
+        // Integral values written as 1800.0 or 1.8e3.
+        const double number = std::strtod(value.text.c_str(), nullptr);
+        if (number != std::floor(number) || number >= 18446744073709551616.0) {
+            invalid(what, "a non-negative integer");
+        }
+        result = static_cast<uint64_t>(number);
+    }
+    if (result > max) {
+        invalid(what, "at most " + std::to_string(max));
+    }
+    return result;
+}
+
+sec_t as_seconds(const JsonValue& value, const std::string& what) {
+    return static_cast<sec_t>(as_unsigned(value, what, std::numeric_limits<sec_t>::max()));
+}
+
+double as_double(const JsonValue& value, const std::string& what) {
+    if (value.type != JsonValue::Type::NUMBER) {
+        invalid(what, "a number");
+    }
+    return std::strtod(value.text.c_str(), nullptr);
+}
+
+bool as_bool(const JsonValue& value, const std::string& what) {
+    if (value.type != JsonValue::Type::BOOLEAN) {
+        invalid(what, "true or false");
+    }
+    return value.boolean;
+}
+
+const std::string& as_string(const JsonValue& value, const std::string& what) {
+    if (value.type != JsonValue::Type::STRING) {
+        invalid(what, "a string");
+    }
+    return value.text;
+}
+
+const std::vector<JsonValue>& as_array(const JsonValue& value, const std::string& what) {
+    if (value.type != JsonValue::Type::ARRAY) {
+        invalid(what, "an array");
+    }
+    return value.items;
+}
+
+TimeRange as_range(const JsonValue& value, const std::string& what) {
+    const std::vector<JsonValue>& bounds = as_array(value, what);
+    if (bounds.size() != 2) {
+        invalid(what, "[low, high]");
+    }
+    const sec_t low = as_seconds(bounds[0], what);
+    const sec_t high = as_seconds(bounds[1], what);
+    if (high < low) {
+        invalid(what, "[low, high] with low <= high");
+    }
+    return TimeRange(low, high);
+}
+
+CostHistoryMode as_history_mode(const JsonValue& value, const std::string& what) {
+    const std::string& mode = as_string(value, what);
+    if (mode == "off") return CostHistoryMode::OFF;
+    if (mode == "full") return CostHistoryMode::FULL;
+    if (mode == "every_nth") return CostHistoryMode::EVERY_NTH;
+    if (mode == "reservoir") return CostHistoryMode::RESERVOIR;
+    if (mode == "buckets") return CostHistoryMode::BUCKETS;
+    invalid(what, "one of off, full, every_nth, reservoir, buckets");
+}
+
+void apply_config(const JsonValue& object, EngineConfig& config) {
+    if (object.type != JsonValue::Type::OBJECT) {
+        invalid("config", "an object");
+    }
+    constexpr uint64_t max_u32 = std::numeric_limits<uint32_t>::max();
+    for (const auto& [key, value] : object.members) {
+        const std::string what = "config." + key;
+        if (key == "initial_temp") config.initial_temp = as_double(value, what);
+        else if (key == "final_temp") config.final_temp = as_double(value, what);
+        else if (key == "num_iters") config.num_iters = as_unsigned(value, what);
+        else if (key == "num_workers") config.num_workers = as_unsigned(value, what);
+        else if (key == "num_replicas") config.num_replicas = as_unsigned(value, what);
+        else if (key == "swap_interval") config.swap_interval = as_unsigned(value, what);
+        else if (key == "cost_history_mode") config.cost_history.mode = as_history_mode(value, what);
+        else if (key == "cost_history_interval") config.cost_history.interval = as_unsigned(value, what);
+        else if (key == "cost_history_capacity") config.cost_history.capacity = static_cast<size_t>(as_unsigned(value, what));
+        else if (key == "time_budget_ms") config.time_budget_ms = as_unsigned(value, what);
+        else if (key == "calibration_samples") config.calibration_samples = static_cast<uint32_t>(as_unsigned(value, what, max_u32));
+        else if (key == "plateau_iters") config.plateau_iters = as_unsigned(value, what);
+        else if (key == "max_reheats") config.max_reheats = static_cast<uint32_t>(as_unsigned(value, what, max_u32));
+        else if (key == "reheat_temp_fraction") config.reheat_temp_fraction = as_double(value, what);
+        else if (key == "greedy_start") config.greedy_start = as_bool(value, what);
+        else if (key == "adaptive_moves") config.adaptive_moves = as_bool(value, what);
+        else if (key == "seed") config.seed = as_unsigned(value, what);
+        else if (key == "illegal_schedule_weight") config.illegal_schedule_weight = as_double(value, what);
+        else if (key == "overlap_cost_weight") config.overlap_cost_weight = as_double(value, what);
+        else if (key == "split_cost_weight") config.split_cost_weight = as_double(value, what);
+        else throw std::invalid_argument("problem: unknown config field \"" + key + "\"");
+    }
+}
+
+Policy parse_policy(const JsonValue& object, const std::string& what) {
+    if (object.type != JsonValue::Type::OBJECT) {
+        invalid(what, "an object");
+    }
+    auto flag = [&](const char* key) {
+        const JsonValue* value = object.find(key);
+        return value != nullptr && as_bool(*value, what + "." + key);
+    };
+    bool splittable, overlappable, invisible, round_to_granularity;
+    if (const JsonValue* bits = object.find("scheduling_policies")) {
+        const uint64_t policies = as_unsigned(*bits, what + ".scheduling_policies", 0xFF);
+        splittable = (policies & policy_flags::SPLITTABLE) != 0;
+        overlappable = (policies & policy_flags::OVERLAPPABLE) != 0;
+        invisible = (policies & policy_flags::INVISIBLE) != 0;
+        round_to_granularity = object.find("round_to_granularity") != nullptr
+            ? flag("round_to_granularity")
+            : (policies & policy_flags::ROUND_TO_GRANULARITY) != 0;
+    } else {
+        splittable = flag("is_splittable");
+        overlappable = flag("is_overlappable");
+        invisible = flag("is_invisible");
+        round_to_granularity = flag("round_to_granularity");
+    }
+
+    uint8_t max_splits = 0;
+    if (const JsonValue* value = object.find("max_splits")) {
+        max_splits = static_cast<uint8_t>(as_unsigned(*value, what + ".max_splits", 0xFF));
+    }
+    sec_t min_split_duration = 0;
+    if (const JsonValue* value = object.find("min_split_duration")) {
+        min_split_duration = as_seconds(*value, what + ".min_split_duration");
+    } else if (const JsonValue* seconds = object.find("min_split_duration_seconds")) {
+        min_split_duration = as_seconds(*seconds, what + ".min_split_duration_seconds");
+    }
+    return Policy(max_splits, min_split_duration, splittable, overlappable, invisible, round_to_granularity);
+}
+
+std::set<Tag> parse_tags(const JsonValue& value, const std::string& what) {
+    std::set<Tag> tags;
+    for (const JsonValue& tag : as_array(value, what)) {
+        if (tag.type == JsonValue::Type::STRING) {
+            tags.emplace(tag.text);
+            continue;
+        }
+        if (tag.type != JsonValue::Type::OBJECT) {
+            invalid(what, "an array of strings or {name, description} objects");
+        }
+        const std::string& name = as_string(require(tag, "name", what), what + ".name");
+        const JsonValue* description = tag.find("description");
+        tags.emplace(name, description != nullptr ? as_string(*description, what + ".description") : "");
+    }
+    return tags;
+}
+
+Job parse_job(const JsonValue& object, size_t index) {
+    std::string what = "jobs[" + std::to_string(index) + "]";
+    if (object.type != JsonValue::Type::OBJECT) {
+        invalid(what, "an object");
+    }
+    const ID id = as_string(require(object, "id", what), what + ".id");
+    what = "job " + id;
+
+    const sec_t duration = as_seconds(require(object, "duration", what), what + ".duration");
+    const TimeRange window = as_range(require(object, "schedulable_time_range", what), what + ".schedulable_time_range");
+
+    const JsonValue* scheduled_value = object.find("scheduled_time_range");
+    const TimeRange scheduled = scheduled_value != nullptr
+        ? as_range(*scheduled_value, what + ".scheduled_time_range")
+        : TimeRange(window.get_low(), window.get_low() + duration);
+
+    const JsonValue* policy_value = object.find("policy");
+    const Policy policy = policy_value != nullptr ? parse_policy(*policy_value, what + ".policy") : Policy();
+
+    std::set<ID> dependencies;
+    if (const JsonValue* value = object.find("dependencies")) {
+        for (const JsonValue& dependency : as_array(*value, what + ".dependencies")) {
+            dependencies.insert(as_string(dependency, what + ".dependencies"));
+        }
+    }
+    std::set<Tag> tags;
+    if (const JsonValue* value = object.find("tags")) {
+        tags = parse_tags(*value, what + ".tags");
+    }
+
+    Job job(duration, window, scheduled, id, policy, std::move(dependencies), std::move(tags));
+    if (const JsonValue* value = object.find("scheduled_time_ranges")) {
+        std::vector<TimeRange> ranges;
+        for (const JsonValue& range : as_array(*value, what + ".scheduled_time_ranges")) {
+            ranges.push_back(as_range(range, what + ".scheduled_time_ranges"));
+        }
+        job.set_scheduled_time_ranges(std::move(ranges));
+    }
+    return job;
+}
+
+}  // namespace
+
+SolveRequest parse_problem_json(const std::string& text) {
+    const JsonValue document = JsonParser(text).parse_document();
+    if (document.type != JsonValue::Type::OBJECT) {
+        invalid("the document", "an object");
+    }
+
+    SolveRequest request;
+    request.config = default_engine_config(as_unsigned(require(document, "granularity", "the document"), "granularity"));
+    if (const JsonValue* config = document.find("config")) {
+        apply_config(*config, request.config);
+    }
+
+    const std::vector<JsonValue>& jobs = as_array(require(document, "jobs", "the document"), "jobs");
+    request.jobs.reserve(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        request.jobs.push_back(parse_job(jobs[i], i));
+    }
+    return request;
+}
+
+SolveRequest load_problem_json(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::invalid_argument("problem: cannot open " + path);
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    return parse_problem_json(text.str());
+}
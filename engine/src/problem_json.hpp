@@ -0,0 +1,49 @@
+#ifndef ELASTISCHED_PROBLEM_JSON_HPP
+#define ELASTISCHED_PROBLEM_JSON_HPP
+
+#include "engine.hpp"
+
+#include <string>
+
+/**
+ * Problem JSON
+ *
+ * A problem as a JSON object, with times in seconds:
+ *
+ *   {
+ *     "granularity": 300,
+ *     "config": {"num_iters": 100000, "seed": 7, ...},
+ *     "jobs": [
+ *       {"id": "a", "duration": 1800,
+ *        "schedulable_time_range": [0, 86400],
+ *        "scheduled_time_range": [0, 1800],
+ *        "policy": {"is_splittable": true, "max_splits": 2, "min_split_duration": 900},
+ *        "dependencies": ["b"],
+ *        "tags": ["focus", {"name": "home", "description": "..."}]}
+ *     ]
+ *   }
+ *
+ * Only "granularity", "jobs" and each job's "id", "duration" and
+ * "schedulable_time_range" are required; a granularity of 0 places jobs
+ * to the second. Without a scheduled range a job
+ * starts at the beginning of its window; "scheduled_time_ranges" (a list
+ * of ranges) gives a split starting placement instead. A policy may set
+ * "scheduling_policies" as the bitfield of Policy rather than the
+ * is_* flags, as the backend does.
+ *
+ * "config" may set any numeric or boolean field of EngineConfig by name,
+ * and "cost_history_mode" as one of "off", "full", "every_nth",
+ * "reservoir" or "buckets"; fields it leaves out take the values of
+ * default_engine_config. Other unknown keys are ignored, except in
+ * "config", where they are rejected so that a misspelt parameter is not
+ * silently left at its default.
+ */
+
+// Parses text; throws std::invalid_argument naming the offending field or
+// the byte offset of a syntax error.
+SolveRequest parse_problem_json(const std::string& text);
+
+// Reads and parses the file at path.
+SolveRequest load_problem_json(const std::string& path);
+
+#endif // ELASTISCHED_PROBLEM_JSON_HPP
@@ -0,0 +1,394 @@
+#include "problem_table.hpp"
+
+#include "policy.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+size_t ProblemTable::size() const {
+    return duration.size();
+}
+
+bool ProblemTable::is_overlappable(job_index_t job) const {
+    return (policy_bits[job] & policy_flags::OVERLAPPABLE) != 0;
+}
+
+bool ProblemTable::is_splittable(job_index_t job) const {
+    return (policy_bits[job] & policy_flags::SPLITTABLE) != 0;
+}
+
+bool ProblemTable::rounds_to_granularity(job_index_t job) const {
+    return (policy_bits[job] & policy_flags::ROUND_TO_GRANULARITY) != 0;
+}
+
+TimeRange ProblemTable::window(job_index_t job) const {
+    return TimeRange(window_low[job], window_high[job]);
+}
+
+uint32_t ProblemTable::segment_capacity(job_index_t job) const {
+    uint32_t initial = segment_offsets[job + 1] - segment_offsets[job];
+    uint32_t splits = is_splittable(job) ? static_cast<uint32_t>(max_splits[job]) + 1 : 1;
+    return std::max(initial, splits);
+}
+
+namespace {
+
+// Fills the predecessor / successor CSR of problem and looks for a cycle.
+// for_each_dependency(i, visit) calls visit with the index of every job
+// that job i depends on; it is called twice per job (count, then fill).
+template<typename ForEachDependency>
+void link_dependencies(ProblemTable& problem, ForEachDependency&& for_each_dependency) {
+    const size_t n = problem.size();
+    problem.predecessor_offsets.assign(n + 1, 0);
+    problem.successor_offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for_each_dependency(i, [&problem, i](job_index_t dep) {
+            if (dep == i) {
+                if (problem.dependency_cycle.empty()) {
+                    problem.dependency_cycle.push_back(static_cast<job_index_t>(i));
+                }
+                return;
+            }
+            ++problem.predecessor_offsets[i + 1];
+            ++problem.successor_offsets[dep + 1];
+        });
+    }
+    for (size_t i = 0; i < n; ++i) {
+        problem.predecessor_offsets[i + 1] += problem.predecessor_offsets[i];
+        problem.successor_offsets[i + 1] += problem.successor_offsets[i];
+    }
+    problem.predecessor_indices.resize(problem.predecessor_offsets[n]);
+    problem.successor_indices.resize(problem.successor_offsets[n]);
+    std::vector<uint32_t> successor_fill(problem.successor_offsets.begin(), problem.successor_offsets.end() - 1);
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t predecessor_fill = problem.predecessor_offsets[i];
+        for_each_dependency(i, [&problem, &successor_fill, &predecessor_fill, i](job_index_t dep) {
+            if (dep == i) {
+                return;
+            }
+            problem.predecessor_indices[predecessor_fill++] = dep;
+            problem.successor_indices[successor_fill[dep]++] = static_cast<job_index_t>(i);
+        });
+    }
+
+    if (problem.dependency_cycle.empty()) {
+        problem.dependency_cycle = find_dependency_cycle(problem);
+    }
+    problem.has_cyclic_dependencies = !problem.dependency_cycle.empty();
+}
+
+void reserve_jobs(ProblemTable& problem, size_t n) {
+    problem.duration.reserve(n);
+    problem.window_low.reserve(n);
+    problem.window_high.reserve(n);
+    problem.policy_bits.reserve(n);
+    problem.max_splits.reserve(n);
+    problem.min_split_duration.reserve(n);
+    problem.rigid.reserve(n);
+    problem.segment_offsets.reserve(n + 1);
+    problem.segment_offsets.push_back(0);
+}
+
+} // namespace
+
+ProblemTable compile_problem(const std::vector<Job>& jobs, sec_t granularity) {
+    ProblemTable problem;
+    const size_t n = jobs.size();
+    problem.granularity = granularity;
+    reserve_jobs(problem, n);
+
+    std::unordered_map<ID, job_index_t> index_by_id;
+    index_by_id.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Job& job = jobs[i];
+        problem.duration.push_back(job.duration);
+        problem.window_low.push_back(job.schedulable_time_range.get_low());
+        problem.window_high.push_back(job.schedulable_time_range.get_high());
+        problem.policy_bits.push_back(job.policy.get_scheduling_policies());
+        problem.max_splits.push_back(job.policy.get_max_splits());
+        problem.min_split_duration.push_back(job.policy.get_min_split_duration());
+        problem.rigid.push_back(job.is_rigid() ? 1 : 0);
+
+        if (job.scheduled_time_ranges.empty()) {
+            problem.segments.push_back(job.scheduled_time_range);
+        } else {
+            problem.segments.insert(problem.segments.end(),
+                                    job.scheduled_time_ranges.begin(),
+                                    job.scheduled_time_ranges.end());
+        }
+        problem.segment_offsets.push_back(static_cast<uint32_t>(problem.segments.size()));
+
+        if (!index_by_id.emplace(job.id, static_cast<job_index_t>(i)).second) {
+            throw std::invalid_argument("compile_problem: duplicate job id " + job.id);
+        }
+    }
+
+    link_dependencies(problem, [&jobs, &index_by_id](size_t i, auto&& visit) {
+        for (const ID& dep_id : jobs[i].dependencies) {
+            auto it = index_by_id.find(dep_id);
+            if (it != index_by_id.end()) {
+                visit(it->second);
+            }
+        }
+    });
+
+    return problem;
+}
+
+ProblemTable compile_batch(const JobBatch& batch, sec_t granularity) {
+    const size_t n = batch.size;
+    if (n > 0 && (batch.duration == nullptr || batch.window_low == nullptr || batch.window_high == nullptr)) {
+        throw std::invalid_argument("compile_batch: duration, window_low and window_high are required");
+    }
+    if ((batch.scheduled_low == nullptr) != (batch.scheduled_high == nullptr)) {
+        throw std::invalid_argument("compile_batch: scheduled_low and scheduled_high must be given together");
+    }
+    if ((batch.dependency_offsets == nullptr) != (batch.dependency_indices == nullptr)) {
+        throw std::invalid_argument("compile_batch: dependency_offsets and dependency_indices must be given together");
+    }
+    if (batch.dependency_offsets != nullptr) {
+        if (batch.dependency_offsets[0] != 0) {
+            throw std::invalid_argument("compile_batch: dependency_offsets must start at 0");
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (batch.dependency_offsets[i + 1] < batch.dependency_offsets[i]) {
+                throw std::invalid_argument("compile_batch: dependency_offsets must not decrease");
+            }
+        }
+        for (uint32_t k = 0; k < batch.dependency_offsets[n]; ++k) {
+            if (batch.dependency_indices[k] >= n) {
+                throw std::invalid_argument(
+                    "compile_batch: dependency index " + std::to_string(batch.dependency_indices[k]) +
+                    " out of range");
+            }
+        }
+    }
+
+    ProblemTable problem;
+    problem.granularity = granularity;
+    reserve_jobs(problem, n);
+    problem.segments.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        const sec_t duration = batch.duration[i];
+        const sec_t low = batch.window_low[i];
+        const sec_t high = batch.window_high[i];
+        // A window shorter than the duration is a conflict for
+        // feasibility_report to name, as it is for compile_problem.
+        if (high < low) {
+            throw std::invalid_argument(
+                "compile_batch: window of job " + std::to_string(i) + " ends before it starts");
+        }
+        const bool rigid = duration == high - low;
+        problem.duration.push_back(duration);
+        problem.window_low.push_back(low);
+        problem.window_high.push_back(high);
+        problem.policy_bits.push_back(batch.policy_bits != nullptr ? batch.policy_bits[i] : 0);
+        problem.max_splits.push_back(batch.max_splits != nullptr ? batch.max_splits[i] : 0);
+        problem.min_split_duration.push_back(batch.min_split_duration != nullptr ? batch.min_split_duration[i] : 0);
+        problem.rigid.push_back(rigid ? 1 : 0);
+
+        if (rigid) {
+            problem.segments.emplace_back(low, high);
+        } else if (batch.scheduled_low != nullptr) {
+            problem.segments.emplace_back(batch.scheduled_low[i], batch.scheduled_high[i]);
+        } else {
+            problem.segments.emplace_back(low, low + duration);
+        }
+        problem.segment_offsets.push_back(static_cast<uint32_t>(problem.segments.size()));
+    }
+
+    if (batch.dependency_offsets != nullptr) {
+        link_dependencies(problem, [&batch](size_t i, auto&& visit) {
+            for (uint32_t k = batch.dependency_offsets[i]; k < batch.dependency_offsets[i + 1]; ++k) {
+                visit(batch.dependency_indices[k]);
+            }
+        });
+    } else {
+        link_dependencies(problem, [](size_t, auto&&) {});
+    }
+
+    return problem;
+}
+
+std::vector<job_index_t> find_dependency_cycle(const ProblemTable& problem) {
+    const size_t n = problem.size();
+    std::vector<uint32_t> in_degree(n);
+    std::vector<job_index_t> queue;
+    queue.reserve(n);
+    for (job_index_t i = 0; i < n; ++i) {
+        in_degree[i] = problem.predecessor_offsets[i + 1] - problem.predecessor_offsets[i];
+        if (in_degree[i] == 0) {
+            queue.push_back(i);
+        }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const job_index_t current = queue[head];
+        for (uint32_t k = problem.successor_offsets[current]; k < problem.successor_offsets[current + 1]; ++k) {
+            if (--in_degree[problem.successor_indices[k]] == 0) {
+                queue.push_back(problem.successor_indices[k]);
+            }
+        }
+    }
+    if (queue.size() == n) {
+        return {};
+    }
+
+    // Every job Kahn could not release still has an unreleased predecessor,
+    // so walking predecessors from one of them must come back around.
+    job_index_t current = 0;
+    while (in_degree[current] == 0) {
+        ++current;
+    }
+    std::vector<uint32_t> visited_at(n, UINT32_MAX);
+    std::vector<job_index_t> walk;
+    while (visited_at[current] == UINT32_MAX) {
+        visited_at[current] = static_cast<uint32_t>(walk.size());
+        walk.push_back(current);
+        for (uint32_t k = problem.predecessor_offsets[current]; k < problem.predecessor_offsets[current + 1]; ++k) {
+            if (in_degree[problem.predecessor_indices[k]] > 0) {
+                current = problem.predecessor_indices[k];
+                break;
+            }
+        }
+    }
+    std::vector<job_index_t> cycle(walk.begin() + visited_at[current], walk.end());
+    std::reverse(cycle.begin(), cycle.end());
+    return cycle;
+}
+
+ProblemTable extract_subproblem(
+    const ProblemTable& problem,
+    const std::vector<job_index_t>& members,
+    const std::vector<job_index_t>& local_index
+) {
+    ProblemTable sub;
+    extract_subproblem(problem, members, local_index, sub);
+    return sub;
+}
+
+void extract_subproblem(
+    const ProblemTable& problem,
+    const std::vector<job_index_t>& members,
+    const std::vector<job_index_t>& local_index,
+    ProblemTable& sub
+) {
+    const size_t n = members.size();
+    sub.granularity = problem.granularity;
+    sub.has_cyclic_dependencies = problem.has_cyclic_dependencies;
+    sub.dependency_cycle.clear();
+    for (auto* column : {&sub.duration, &sub.window_low, &sub.window_high, &sub.min_split_duration}) {
+        column->clear();
+        column->reserve(n);
+    }
+    for (auto* column : {&sub.policy_bits, &sub.max_splits, &sub.rigid}) {
+        column->clear();
+        column->reserve(n);
+    }
+    for (auto* offsets : {&sub.segment_offsets, &sub.predecessor_offsets, &sub.successor_offsets}) {
+        offsets->clear();
+        offsets->reserve(n + 1);
+        offsets->push_back(0);
+    }
+    sub.segments.clear();
+    sub.predecessor_indices.clear();
+    sub.successor_indices.clear();
+
+    auto is_member = [&](job_index_t global, job_index_t owner) {
+        const job_index_t local = local_index[global];
+        return local < n && members[local] == global && global != owner;
+    };
+
+    for (job_index_t global : members) {
+        sub.duration.push_back(problem.duration[global]);
+        sub.window_low.push_back(problem.window_low[global]);
+        sub.window_high.push_back(problem.window_high[global]);
+        sub.policy_bits.push_back(problem.policy_bits[global]);
+        sub.max_splits.push_back(problem.max_splits[global]);
+        sub.min_split_duration.push_back(problem.min_split_duration[global]);
+        sub.rigid.push_back(problem.rigid[global]);
+
+        sub.segments.insert(sub.segments.end(),
+                            problem.segments.begin() + problem.segment_offsets[global],
+                            problem.segments.begin() + problem.segment_offsets[global + 1]);
+        sub.segment_offsets.push_back(static_cast<uint32_t>(sub.segments.size()));
+
+        for (uint32_t k = problem.predecessor_offsets[global]; k < problem.predecessor_offsets[global + 1]; ++k) {
+            const job_index_t pred = problem.predecessor_indices[k];
+            if (is_member(pred, global)) {
+                sub.predecessor_indices.push_back(local_index[pred]);
+            }
+        }
+        sub.predecessor_offsets.push_back(static_cast<uint32_t>(sub.predecessor_indices.size()));
+
+        for (uint32_t k = problem.successor_offsets[global]; k < problem.successor_offsets[global + 1]; ++k) {
+            const job_index_t succ = problem.successor_indices[k];
+            if (is_member(succ, global)) {
+                sub.successor_indices.push_back(local_index[succ]);
+            }
+        }
+        sub.successor_offsets.push_back(static_cast<uint32_t>(sub.successor_indices.size()));
+    }
+
+}
+
+Placement::Placement(const ProblemTable& problem) {
+    const size_t n = problem.size();
+    slot_offsets.reserve(n + 1);
+    slot_offsets.push_back(0);
+    for (job_index_t i = 0; i < n; ++i) {
+        slot_offsets.push_back(slot_offsets.back() + problem.segment_capacity(i));
+    }
+    segment_counts.assign(n, 0);
+    slots.assign(slot_offsets.back(), TimeRange(0));
+    earliest_start.assign(n, 0);
+    latest_end.assign(n, 0);
+
+    for (job_index_t i = 0; i < n; ++i) {
+        const uint32_t first = problem.segment_offsets[i];
+        assign(i, problem.segments.data() + first, problem.segment_offsets[i + 1] - first);
+    }
+}
+
+size_t Placement::size() const {
+    return segment_counts.size();
+}
+
+const TimeRange* Placement::begin(job_index_t job) const {
+    return slots.data() + slot_offsets[job];
+}
+
+const TimeRange* Placement::end(job_index_t job) const {
+    return begin(job) + segment_counts[job];
+}
+
+uint32_t Placement::count(job_index_t job) const {
+    return segment_counts[job];
+}
+
+void Placement::assign(job_index_t job, const TimeRange* ranges, uint32_t count) {
+    if (count > slot_offsets[job + 1] - slot_offsets[job]) {
+        throw std::invalid_argument("Placement::assign: more segments than the job can hold");
+    }
+    TimeRange* first = slots.data() + slot_offsets[job];
+    std::copy(ranges, ranges + count, first);
+    segment_counts[job] = count;
+    if (count == 0) {
+        return;
+    }
+    sec_t low = ranges[0].get_low();
+    sec_t high = ranges[0].get_high();
+    for (uint32_t k = 1; k < count; ++k) {
+        low = std::min(low, ranges[k].get_low());
+        high = std::max(high, ranges[k].get_high());
+    }
+    earliest_start[job] = low;
+    latest_end[job] = high;
+}
+
+void write_back(const Placement& placement, std::vector<Job>& jobs) {
+    for (job_index_t i = 0; i < jobs.size() && i < placement.size(); ++i) {
+        jobs[i].set_scheduled_time_ranges(std::vector<TimeRange>(placement.begin(i), placement.end(i)));
+    }
+}
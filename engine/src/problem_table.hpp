@@ -0,0 +1,163 @@
+#ifndef ELASTISCHED_PROBLEM_TABLE_HPP
+#define ELASTISCHED_PROBLEM_TABLE_HPP
+
+#include "job.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using job_index_t = uint32_t;
+
+/**
+ * ProblemTable
+ *
+ * Flat, structure-of-arrays form of a scheduling problem. Jobs are
+ * addressed by dense indices in input order; per-job attributes live in
+ * parallel arrays and variable-length data (dependencies, initial
+ * placements) is stored in CSR form, i.e. the entries of job i are
+ * indices[offsets[i], offsets[i + 1]).
+ *
+ * A table is built once per solve by compile_problem and is read-only
+ * afterwards, so it can be shared between solver threads.
+ */
+struct ProblemTable {
+    sec_t granularity = 0;
+
+    std::vector<sec_t> duration;
+    std::vector<sec_t> window_low;
+    std::vector<sec_t> window_high;
+    std::vector<uint8_t> policy_bits;
+    std::vector<uint8_t> max_splits;
+    std::vector<sec_t> min_split_duration;
+    // Jobs that keep their initial placement: their duration fills their
+    // window, or the caller pinned them.
+    std::vector<uint8_t> rigid;
+
+    // Predecessors (jobs that must finish first) and successors, resolved
+    // to indices. Dependencies on unknown ids are dropped, matching
+    // check_dependency_violations; a dependency of a job on itself is kept
+    // out of the lists and reported as a cycle.
+    std::vector<uint32_t> predecessor_offsets;
+    std::vector<job_index_t> predecessor_indices;
+    std::vector<uint32_t> successor_offsets;
+    std::vector<job_index_t> successor_indices;
+    bool has_cyclic_dependencies = false;
+
+    // One dependency cycle, if any: every job depends on the one before it
+    // and the first depends on the last.
+    std::vector<job_index_t> dependency_cycle;
+
+    // Initial placement of every job.
+    std::vector<uint32_t> segment_offsets;
+    std::vector<TimeRange> segments;
+
+    size_t size() const;
+    bool is_overlappable(job_index_t job) const;
+    bool is_splittable(job_index_t job) const;
+    bool rounds_to_granularity(job_index_t job) const;
+    TimeRange window(job_index_t job) const;
+
+    // Upper bound on the number of segments a job can be placed in.
+    uint32_t segment_capacity(job_index_t job) const;
+};
+
+/**
+ * JobBatch
+ *
+ * Columnar view of jobs held by the caller, e.g. NumPy arrays. Nothing is
+ * owned or copied: every column points at size entries, except
+ * dependency_offsets which has size + 1 and dependency_indices which has
+ * dependency_offsets[size]. The dependencies of job i are the indices
+ * dependency_indices[dependency_offsets[i], dependency_offsets[i + 1]),
+ * each naming a job that must finish before i.
+ *
+ * duration, window_low and window_high are required. Without
+ * scheduled_low / scheduled_high a job starts at the beginning of its
+ * window; a missing policy column means no policy bits, no splits and no
+ * minimum split duration; missing dependency columns mean no
+ * dependencies. Jobs whose duration fills their window are rigid and are
+ * placed on their window.
+ */
+struct JobBatch {
+    size_t size = 0;
+    const sec_t* duration = nullptr;
+    const sec_t* window_low = nullptr;
+    const sec_t* window_high = nullptr;
+    const sec_t* scheduled_low = nullptr;
+    const sec_t* scheduled_high = nullptr;
+    const uint8_t* policy_bits = nullptr;
+    const uint8_t* max_splits = nullptr;
+    const sec_t* min_split_duration = nullptr;
+    const uint32_t* dependency_offsets = nullptr;
+    const job_index_t* dependency_indices = nullptr;
+};
+
+/**
+ * Builds the table for jobs. Dependencies are resolved and checked for
+ * cycles here, once, so the solver only ever reads integer adjacency.
+ * Throws std::invalid_argument if two jobs share an id.
+ */
+ProblemTable compile_problem(const std::vector<Job>& jobs, sec_t granularity);
+
+/**
+ * Builds the table for batch without going through Job. Throws
+ * std::invalid_argument if a required column is missing, a window ends
+ * before it starts or a dependency is out of range.
+ */
+ProblemTable compile_batch(const JobBatch& batch, sec_t granularity);
+
+// Finds a cycle in the predecessor graph (Kahn's algorithm); empty if none.
+std::vector<job_index_t> find_dependency_cycle(const ProblemTable& problem);
+
+/**
+ * Copies the jobs listed in members (global indices, in the order given)
+ * into a standalone table. local_index maps every global index of members
+ * to its position in members; dependencies on jobs outside members are
+ * dropped and must be accounted for by the caller.
+ */
+ProblemTable extract_subproblem(
+    const ProblemTable& problem,
+    const std::vector<job_index_t>& members,
+    const std::vector<job_index_t>& local_index);
+
+// Same, into sub, whose buffers are reused.
+void extract_subproblem(
+    const ProblemTable& problem,
+    const std::vector<job_index_t>& members,
+    const std::vector<job_index_t>& local_index,
+    ProblemTable& sub);
+
+/**
+ * Placement
+ *
+ * Mutable positions of every job of a ProblemTable. Each job owns a fixed
+ * block of segment slots starting at slot_offsets[i] (sized by
+ * ProblemTable::segment_capacity) of which the first segment_counts[i] are
+ * in use. Because the layout never changes, copying a Placement into one of
+ * the same problem only copies flat arrays.
+ */
+struct Placement {
+    std::vector<uint32_t> slot_offsets;
+    std::vector<uint32_t> segment_counts;
+    std::vector<TimeRange> slots;
+
+    // Cached min(low) / max(high) over each job's segments.
+    std::vector<sec_t> earliest_start;
+    std::vector<sec_t> latest_end;
+
+    Placement() = default;
+    explicit Placement(const ProblemTable& problem);
+
+    size_t size() const;
+    const TimeRange* begin(job_index_t job) const;
+    const TimeRange* end(job_index_t job) const;
+    uint32_t count(job_index_t job) const;
+    void assign(job_index_t job, const TimeRange* ranges, uint32_t count);
+};
+
+// Copies the placement back onto the jobs it was compiled from.
+void write_back(const Placement& placement, std::vector<Job>& jobs);
+
+#endif // ELASTISCHED_PROBLEM_TABLE_HPP
@@ -1,6 +1,14 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/functional.h>
 #include <pybind11/operators.h>
+#include <pybind11/numpy.h>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
 #include <utility>
 
 namespace py = pybind11;
@@ -10,7 +18,52 @@ namespace py = pybind11;
 #include "job.hpp"
 #include "engine.hpp"
 #include "constants.hpp"
+#include "cost_history.hpp"
 #include "interval.hpp"
+#include "snapshot.hpp"
+#include "solve_handle.hpp"
+
+namespace {
+
+// 1-D NumPy array over data that keeps owner alive instead of copying.
+template<typename T>
+py::array_t<T> numpy_view(const std::vector<T>& data, py::handle owner) {
+    return py::array_t<T>(
+        {static_cast<py::ssize_t>(data.size())},
+        {static_cast<py::ssize_t>(sizeof(T))},
+        data.data(),
+        owner);
+}
+
+// Batch columns are read in place when they are C-contiguous and already
+// have the column's dtype; anything else is converted once on the way in.
+template<typename T>
+using column_t = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
+template<typename T>
+const T* column_data(const column_t<T>& column, size_t size, const char* name) {
+    if (column.ndim() != 1 || static_cast<size_t>(column.shape(0)) != size) {
+        throw std::invalid_argument(
+            std::string("solve_batch: ") + name + " must be 1-D with " + std::to_string(size) + " entries");
+    }
+    return column.data();
+}
+
+template<typename T>
+const T* column_data(const std::optional<column_t<T>>& column, size_t size, const char* name) {
+    return column ? column_data(*column, size, name) : nullptr;
+}
+
+// Handles are destroyed without the GIL: the destructor waits for the
+// solver thread, which may need the GIL for a progress callback.
+struct ReleaseGilDelete {
+    void operator()(SolveHandle* handle) const {
+        py::gil_scoped_release release;
+        delete handle;
+    }
+};
+
+} // namespace
 
 PYBIND11_MODULE(engine, m) {
     // Tag
@@ -86,14 +139,334 @@ PYBIND11_MODULE(engine, m) {
             return py::make_iterator(schedule.scheduled_jobs.begin(), schedule.scheduled_jobs.end());
         }, py::keep_alive<0, 1>());
 
+    // Dependency checks
+    py::class_<DependencyViolation>(m, "DependencyViolation")
+        .def_readonly("job_id", &DependencyViolation::job_id)
+        .def_readonly("violated_dependencies", &DependencyViolation::violated_dependencies);
+
+    py::class_<DependencyCheckResult>(m, "DependencyCheckResult")
+        .def_readonly("has_violations", &DependencyCheckResult::has_violations)
+        .def_readonly("violations", &DependencyCheckResult::violations)
+        .def_readonly("has_cyclic_dependencies", &DependencyCheckResult::has_cyclic_dependencies)
+        .def_readonly("has_duplicate_ids", &DependencyCheckResult::has_duplicate_ids)
+        .def_readonly("duplicate_ids", &DependencyCheckResult::duplicate_ids);
+
+    m.def("check_dependency_violations", &check_dependency_violations,
+          "Check a schedule for duplicate ids and cyclic or out-of-order dependencies",
+          py::arg("schedule"));
+
     // Cost Function
     py::class_<ScheduleCostFunction>(m, "ScheduleCostFunction")
         .def(py::init<const Schedule&, sec_t>())
         .def("schedule_cost", &ScheduleCostFunction::schedule_cost);
 
+    // Cost history
+    py::enum_<CostHistoryMode>(m, "CostHistoryMode")
+        .value("OFF", CostHistoryMode::OFF)
+        .value("FULL", CostHistoryMode::FULL)
+        .value("EVERY_NTH", CostHistoryMode::EVERY_NTH)
+        .value("RESERVOIR", CostHistoryMode::RESERVOIR)
+        .value("BUCKETS", CostHistoryMode::BUCKETS);
+
+    py::class_<CostHistoryPolicy>(m, "CostHistoryPolicy")
+        .def(py::init<>())
+        .def(py::init([](CostHistoryMode mode, uint64_t interval, size_t capacity) {
+                 return CostHistoryPolicy{mode, interval, capacity};
+             }),
+             py::arg("mode"), py::arg("interval") = 1, py::arg("capacity") = 1024)
+        .def_readwrite("mode", &CostHistoryPolicy::mode)
+        .def_readwrite("interval", &CostHistoryPolicy::interval)
+        .def_readwrite("capacity", &CostHistoryPolicy::capacity);
+
+    // The arrays are views into the CostHistory and keep it alive; nothing is copied.
+    py::class_<CostHistory>(m, "CostHistory")
+        .def_property_readonly("iterations", [](py::object self) {
+            return numpy_view(self.cast<const CostHistory&>().iterations, self);
+        })
+        .def_property_readonly("values", [](py::object self) {
+            return numpy_view(self.cast<const CostHistory&>().values, self);
+        })
+        .def_property_readonly("min", [](py::object self) {
+            return numpy_view(self.cast<const CostHistory&>().min, self);
+        })
+        .def_property_readonly("max", [](py::object self) {
+            return numpy_view(self.cast<const CostHistory&>().max, self);
+        })
+        .def("__len__", &CostHistory::size);
+
+    // Engine configuration
+    py::class_<EngineConfig>(m, "EngineConfig")
+        .def(py::init<>())
+        .def_readwrite("granularity", &EngineConfig::granularity)
+        .def_readwrite("initial_temp", &EngineConfig::initial_temp)
+        .def_readwrite("final_temp", &EngineConfig::final_temp)
+        .def_readwrite("num_iters", &EngineConfig::num_iters)
+        .def_readwrite("num_workers", &EngineConfig::num_workers)
+        .def_readwrite("num_replicas", &EngineConfig::num_replicas)
+        .def_readwrite("swap_interval", &EngineConfig::swap_interval)
+        .def_readwrite("cost_history", &EngineConfig::cost_history)
+        .def_readwrite("time_budget_ms", &EngineConfig::time_budget_ms)
+        .def_readwrite("calibration_samples", &EngineConfig::calibration_samples)
+        .def_readwrite("plateau_iters", &EngineConfig::plateau_iters)
+        .def_readwrite("max_reheats", &EngineConfig::max_reheats)
+        .def_readwrite("reheat_temp_fraction", &EngineConfig::reheat_temp_fraction)
+        .def_readwrite("greedy_start", &EngineConfig::greedy_start)
+        .def_readwrite("adaptive_moves", &EngineConfig::adaptive_moves)
+        .def_readwrite("seed", &EngineConfig::seed)
+        .def_readwrite("illegal_schedule_weight", &EngineConfig::illegal_schedule_weight)
+        .def_readwrite("overlap_cost_weight", &EngineConfig::overlap_cost_weight)
+        .def_readwrite("split_cost_weight", &EngineConfig::split_cost_weight)
+        .def_readwrite("log_engine_run", &EngineConfig::log_engine_run)
+        .def_readwrite("output_file", &EngineConfig::output_file);
+
+    // Feasibility
+    py::enum_<ConflictKind>(m, "ConflictKind")
+        .value("WINDOW_TOO_SHORT", ConflictKind::WINDOW_TOO_SHORT)
+        .value("RIGID_OVERLAP", ConflictKind::RIGID_OVERLAP)
+        .value("DEPENDENCY_CYCLE", ConflictKind::DEPENDENCY_CYCLE)
+        .value("DEPENDENCY_WINDOW", ConflictKind::DEPENDENCY_WINDOW);
+
+    py::class_<FeasibilityConflict>(m, "FeasibilityConflict")
+        .def_readonly("kind", &FeasibilityConflict::kind)
+        .def_readonly("job_ids", &FeasibilityConflict::job_ids)
+        .def_readonly("message", &FeasibilityConflict::message);
+
+    py::class_<FeasibilityReport>(m, "FeasibilityReport")
+        .def_readonly("conflicts", &FeasibilityReport::conflicts)
+        .def("feasible", &FeasibilityReport::feasible);
+
+    m.def("check_feasibility", &check_feasibility,
+          "Find conflicts that rule out every legal schedule, without solving",
+          py::arg("jobs"), py::arg("granularity"), py::call_guard<py::gil_scoped_release>());
+
+    py::enum_<MoveKind>(m, "MoveKind")
+        .value("RESAMPLE", MoveKind::RESAMPLE)
+        .value("TARGETED", MoveKind::TARGETED)
+        .value("SHIFT", MoveKind::SHIFT)
+        .value("SWAP", MoveKind::SWAP)
+        .value("SEGMENT", MoveKind::SEGMENT);
+
+    py::class_<MoveStats>(m, "MoveStats")
+        .def_readonly("kind", &MoveStats::kind)
+        .def_readonly("proposed", &MoveStats::proposed)
+        .def_readonly("accepted", &MoveStats::accepted)
+        .def_readonly("improved", &MoveStats::improved)
+        .def_readonly("share", &MoveStats::share);
+
+    py::class_<SolveStats>(m, "SolveStats")
+        .def_readonly("compile_seconds", &SolveStats::compile_seconds)
+        .def_readonly("feasibility_seconds", &SolveStats::feasibility_seconds)
+        .def_readonly("partition_seconds", &SolveStats::partition_seconds)
+        .def_readonly("greedy_seconds", &SolveStats::greedy_seconds)
+        .def_readonly("anneal_seconds", &SolveStats::anneal_seconds)
+        .def_readonly("move_generation_seconds", &SolveStats::move_generation_seconds)
+        .def_readonly("cost_evaluation_seconds", &SolveStats::cost_evaluation_seconds)
+        .def_readonly("write_back_seconds", &SolveStats::write_back_seconds)
+        .def_readonly("cost_evaluations", &SolveStats::cost_evaluations)
+        .def_readonly("accepted_moves", &SolveStats::accepted_moves)
+        .def_readonly("rejected_moves", &SolveStats::rejected_moves)
+        .def_readonly("improving_moves", &SolveStats::improving_moves)
+        .def_readonly("split_attempts", &SolveStats::split_attempts)
+        .def_readonly("merge_attempts", &SolveStats::merge_attempts)
+        .def_readonly("split_placement_failures", &SolveStats::split_placement_failures)
+        .def_readonly("window_sampling_failures", &SolveStats::window_sampling_failures);
+    m.attr("SOLVE_STATS_ENABLED") = static_cast<bool>(ELASTISCHED_SOLVE_STATS);
+
+    py::class_<SolveResult>(m, "SolveResult")
+        .def_readonly("schedule", &SolveResult::schedule)
+        .def_readonly("cost_history", &SolveResult::cost_history, py::return_value_policy::reference_internal)
+        .def_readonly("feasibility", &SolveResult::feasibility)
+        .def_readonly("move_stats", &SolveResult::move_stats)
+        .def_readonly("stats", &SolveResult::stats)
+        .def_readonly("seed", &SolveResult::seed);
+
+    py::class_<ScheduleChange>(m, "ScheduleChange")
+        .def(py::init([](std::vector<Job> added, std::vector<Job> modified, std::set<ID> removed) {
+                 return ScheduleChange{std::move(added), std::move(modified), std::move(removed)};
+             }),
+             py::arg("added") = std::vector<Job>{},
+             py::arg("modified") = std::vector<Job>{},
+             py::arg("removed") = std::set<ID>{})
+        .def_readwrite("added", &ScheduleChange::added)
+        .def_readwrite("modified", &ScheduleChange::modified)
+        .def_readwrite("removed", &ScheduleChange::removed);
+
+    py::class_<SolveRequest>(m, "SolveRequest")
+        .def(py::init([](std::vector<Job> jobs, EngineConfig config) {
+                 return SolveRequest{std::move(jobs), std::move(config)};
+             }),
+             py::arg("jobs"), py::arg("config"))
+        .def_readwrite("jobs", &SolveRequest::jobs)
+        .def_readwrite("config", &SolveRequest::config);
+
+    py::class_<BatchSolveResult>(m, "BatchSolveResult")
+        .def_property_readonly("segment_offsets", [](py::object self) {
+            return numpy_view(self.cast<const BatchSolveResult&>().segment_offsets, self);
+        })
+        .def_property_readonly("segment_low", [](py::object self) {
+            return numpy_view(self.cast<const BatchSolveResult&>().segment_low, self);
+        })
+        .def_property_readonly("segment_high", [](py::object self) {
+            return numpy_view(self.cast<const BatchSolveResult&>().segment_high, self);
+        })
+        .def_readonly("cost_history", &BatchSolveResult::cost_history, py::return_value_policy::reference_internal)
+        .def_readonly("feasibility", &BatchSolveResult::feasibility)
+        .def_readonly("move_stats", &BatchSolveResult::move_stats)
+        .def_readonly("stats", &BatchSolveResult::stats)
+        .def_readonly("seed", &BatchSolveResult::seed);
+
+    py::class_<SolveProgress>(m, "SolveProgress")
+        .def_readonly("iterations", &SolveProgress::iterations)
+        .def_readonly("best_cost", &SolveProgress::best_cost)
+        .def_readonly("temperature", &SolveProgress::temperature)
+        .def_readonly("components_done", &SolveProgress::components_done)
+        .def_readonly("components_reported", &SolveProgress::components_reported)
+        .def_readonly("component_count", &SolveProgress::component_count);
+
+    // The solve runs on its own thread without the GIL; on_progress is
+    // called with the GIL held, at most once per progress_interval_ms.
+    py::class_<SolveHandle, std::unique_ptr<SolveHandle, ReleaseGilDelete>>(m, "SolveHandle")
+        .def(py::init([](std::vector<Job> jobs,
+                         EngineConfig config,
+                         SolveMonitor::ProgressCallback on_progress,
+                         uint64_t progress_interval_ms) {
+                 return std::unique_ptr<SolveHandle, ReleaseGilDelete>(new SolveHandle(
+                     std::move(jobs), std::move(config), std::move(on_progress),
+                     std::chrono::milliseconds(progress_interval_ms)));
+             }),
+             py::arg("jobs"),
+             py::arg("config"),
+             py::arg("on_progress") = py::none(),
+             py::arg("progress_interval_ms") = 100)
+        .def(py::init([](Schedule previous,
+                         ScheduleChange change,
+                         EngineConfig config,
+                         SolveMonitor::ProgressCallback on_progress,
+                         uint64_t progress_interval_ms) {
+                 return std::unique_ptr<SolveHandle, ReleaseGilDelete>(new SolveHandle(
+                     std::move(previous), std::move(change), std::move(config), std::move(on_progress),
+                     std::chrono::milliseconds(progress_interval_ms)));
+             }),
+             py::arg("previous"),
+             py::arg("change"),
+             py::arg("config"),
+             py::arg("on_progress") = py::none(),
+             py::arg("progress_interval_ms") = 100)
+        .def("cancel", &SolveHandle::cancel)
+        .def("done", &SolveHandle::done)
+        .def("wait", [](const SolveHandle& handle, uint64_t timeout_ms) {
+                 return handle.wait_for(std::chrono::milliseconds(timeout_ms));
+             },
+             py::arg("timeout_ms"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("best_schedule", &SolveHandle::best_schedule, py::call_guard<py::gil_scoped_release>())
+        .def("progress", &SolveHandle::progress, py::call_guard<py::gil_scoped_release>())
+        .def("result", &SolveHandle::result, py::call_guard<py::gil_scoped_release>());
+
+    m.def("default_engine_config", &default_engine_config,
+          "Configuration used by schedule", py::arg("granularity"));
+
+    m.def("solve", [](std::vector<Job> jobs, const EngineConfig& config) {
+              return solve(std::move(jobs), config);
+          },
+          "Run the scheduler with an explicit configuration",
+          py::arg("jobs"), py::arg("config"), py::call_guard<py::gil_scoped_release>());
+
+    // Columnar jobs, one entry per job; the dependencies of job i are
+    // dependency_indices[dependency_offsets[i]:dependency_offsets[i + 1]].
+    m.def("solve_batch",
+          [](column_t<sec_t> duration,
+             column_t<sec_t> window_low,
+             column_t<sec_t> window_high,
+             const EngineConfig& config,
+             std::optional<column_t<sec_t>> scheduled_low,
+             std::optional<column_t<sec_t>> scheduled_high,
+             std::optional<column_t<uint8_t>> policy_bits,
+             std::optional<column_t<uint8_t>> max_splits,
+             std::optional<column_t<sec_t>> min_split_duration,
+             std::optional<column_t<uint32_t>> dependency_offsets,
+             std::optional<column_t<job_index_t>> dependency_indices) {
+              JobBatch batch;
+              batch.size = static_cast<size_t>(duration.size());
+              batch.duration = column_data(duration, batch.size, "duration");
+              batch.window_low = column_data(window_low, batch.size, "window_low");
+              batch.window_high = column_data(window_high, batch.size, "window_high");
+              batch.scheduled_low = column_data(scheduled_low, batch.size, "scheduled_low");
+              batch.scheduled_high = column_data(scheduled_high, batch.size, "scheduled_high");
+              batch.policy_bits = column_data(policy_bits, batch.size, "policy_bits");
+              batch.max_splits = column_data(max_splits, batch.size, "max_splits");
+              batch.min_split_duration = column_data(min_split_duration, batch.size, "min_split_duration");
+              batch.dependency_offsets = column_data(dependency_offsets, batch.size + 1, "dependency_offsets");
+              if (dependency_offsets && dependency_indices) {
+                  const size_t count = batch.dependency_offsets[batch.size];
+                  batch.dependency_indices = column_data(dependency_indices, count, "dependency_indices");
+              } else if (dependency_indices) {
+                  batch.dependency_indices = dependency_indices->data();
+              }
+              py::gil_scoped_release release;
+              return solve_batch(batch, config);
+          },
+          "Run the scheduler on columnar NumPy job data without building Job objects",
+          py::arg("duration"), py::arg("window_low"), py::arg("window_high"), py::arg("config"),
+          py::kw_only(),
+          py::arg("scheduled_low") = py::none(), py::arg("scheduled_high") = py::none(),
+          py::arg("policy_bits") = py::none(), py::arg("max_splits") = py::none(),
+          py::arg("min_split_duration") = py::none(),
+          py::arg("dependency_offsets") = py::none(), py::arg("dependency_indices") = py::none());
+
+    m.def("reschedule", [](const Schedule& previous, const ScheduleChange& change, const EngineConfig& config) {
+              return reschedule(previous, change, config);
+          },
+          "Re-solve only the part of a previous schedule that a change affects",
+          py::arg("previous"), py::arg("change"), py::arg("config"), py::call_guard<py::gil_scoped_release>());
+
+    m.def("schedule_batch", &schedule_batch,
+          "Solve independent problems on one shared thread pool; results are in request order",
+          py::arg("requests"), py::arg("num_workers") = 0, py::call_guard<py::gil_scoped_release>());
+
+    m.def("write_snapshot",
+          [](const std::string& path, const std::vector<Job>& jobs, const EngineConfig& config,
+             std::optional<Schedule> schedule) {
+              write_snapshot(path, jobs, config, schedule ? &*schedule : nullptr);
+          },
+          "Write a problem, its configuration and optionally its solved schedule to a binary snapshot",
+          py::arg("path"), py::arg("jobs"), py::arg("config"), py::arg("schedule") = py::none(),
+          py::call_guard<py::gil_scoped_release>());
+
+    py::class_<MappedSnapshot>(m, "Snapshot")
+        .def(py::init<const std::string&>(), py::arg("path"))
+        .def("__len__", &MappedSnapshot::size)
+        .def_property_readonly("config", &MappedSnapshot::config)
+        .def_property_readonly("has_schedule", &MappedSnapshot::has_schedule)
+        .def("jobs", &MappedSnapshot::jobs)
+        .def("schedule", &MappedSnapshot::schedule)
+        // Solves the mapped columns in place, with the stored config unless
+        // one is given.
+        .def("solve", [](const MappedSnapshot& snapshot, std::optional<EngineConfig> config) {
+                 return solve_batch(snapshot.batch(), config ? *config : snapshot.config());
+             },
+             py::arg("config") = py::none(),
+             py::call_guard<py::gil_scoped_release>());
+
     m.def("schedule", &schedule, "Run the scheduler with default configurations",
-          py::arg("jobs"), py::arg("granularity"));
+          py::arg("jobs"), py::arg("granularity"), py::call_guard<py::gil_scoped_release>());
 
-    m.def("schedule_jobs", &schedule_jobs, "Run the scheduler",
-          py::arg("jobs"), py::arg("granularity"), py::arg("initial_temp"), py::arg("final_temp"), py::arg("num_iters"));
+    // With return_stats, returns (schedule, cost_history, stats).
+    m.def("schedule_jobs",
+          [](std::vector<Job> jobs, uint64_t granularity, double initial_temp, double final_temp, uint64_t num_iters,
+             bool return_stats) -> py::tuple {
+              SolveStats stats;
+              std::pair<Schedule, std::vector<double>> result;
+              {
+                  py::gil_scoped_release release;
+                  result = schedule_jobs(std::move(jobs), granularity, initial_temp, final_temp, num_iters, &stats);
+              }
+              if (return_stats) {
+                  return py::make_tuple(std::move(result.first), std::move(result.second), stats);
+              }
+              return py::make_tuple(std::move(result.first), std::move(result.second));
+          },
+          "Run the scheduler; cost_history holds the cost after every iteration",
+          py::arg("jobs"), py::arg("granularity"), py::arg("initial_temp"), py::arg("final_temp"), py::arg("num_iters"),
+          py::arg("return_stats") = false);
 } 
@@ -0,0 +1,108 @@
+#ifndef ELASTISCHED_RNG_HPP
+#define ELASTISCHED_RNG_HPP
+
+#include "constants.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <random>
+
+/**
+ * SplitMix64 step: advances state by a fixed odd constant and returns a
+ * well-mixed 64-bit value. Used to expand seeds, never to draw.
+ */
+inline uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Xoshiro256
+ *
+ * xoshiro256** (Blackman and Vigna): 32 bytes of state and a handful of
+ * shifts and rotations per 64-bit draw. Satisfies
+ * UniformRandomBitGenerator, so it works with the standard distributions.
+ * The state is expanded from the seed with SplitMix64, which never yields
+ * the all-zero state.
+ */
+class Xoshiro256 {
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256(uint64_t seed = 0) {
+        for (uint64_t& word : state) {
+            word = splitmix64(seed);
+        }
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()() {
+        const uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const uint64_t shifted = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+private:
+    uint64_t state[4];
+
+    static uint64_t rotl(uint64_t value, int shift) {
+        return (value << shift) | (value >> (64 - shift));
+    }
+};
+
+// The engine behind every random draw of the solver. Define
+// ELASTISCHED_RNG_MT19937 to compare against the standard Mersenne Twister.
+#ifdef ELASTISCHED_RNG_MT19937
+using Rng = std::mt19937_64;
+#else
+using Rng = Xoshiro256;
+#endif
+
+static_assert(Rng::min() == 0 && Rng::max() == std::numeric_limits<uint64_t>::max(),
+              "Rng must produce full 64-bit words");
+
+/**
+ * Seed of the stream at path under seed, e.g. {component, chain}. Every
+ * stream is a pure function of the solve's seed and its own path, not of
+ * the order streams are created in, so chains and components draw the
+ * same numbers whichever thread runs them. Paths of one index give
+ * distinct seeds, since each step is a bijection of the index; longer
+ * paths are folded into 64 bits and only collide by chance, as two
+ * unrelated splitmix64 outputs would.
+ */
+inline uint64_t stream_seed(uint64_t seed, std::initializer_list<uint64_t> path) {
+    uint64_t state = seed;
+    for (uint64_t index : path) {
+        state = splitmix64(state) ^ index;
+    }
+    return splitmix64(state);
+}
+
+// Uniform double in [0, 1) from the top 53 bits of one draw.
+inline double unit_interval(Rng& gen) {
+    return static_cast<double>(gen() >> 11) * 0x1.0p-53;
+}
+
+// The seed a solve runs with: seed itself, or ELASTISCHED_RNG_SEED (see
+// constants::RNG_SEED) when it is 0.
+inline uint64_t resolve_seed(uint64_t seed) {
+    return seed != 0 ? seed : constants::RNG_SEED();
+}
+
+#endif // ELASTISCHED_RNG_HPP
@@ -0,0 +1,228 @@
+#include "slot_occupancy.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ELASTISCHED_SLOT_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Segments per slot are bounded so that counts stay positive as int16,
+// which the AVX2 sum relies on.
+constexpr size_t MAX_SEGMENTS = std::numeric_limits<int16_t>::max();
+
+uint64_t sum_scalar(const uint16_t* data, size_t size) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < size; ++i) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+size_t count_equal_scalar(const uint16_t* data, size_t size, uint16_t value) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; ++i) {
+        count += data[i] == value ? 1 : 0;
+    }
+    return count;
+}
+
+#ifdef ELASTISCHED_SLOT_AVX2
+
+__attribute__((target("avx2"))) uint64_t sum_avx2(const uint16_t* data, size_t size) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    uint64_t sum = 0;
+    size_t i = 0;
+    while (i + 16 <= size) {
+        // Each 32-bit lane gains at most 2 * INT16_MAX per step, so flush
+        // to the 64-bit total well before it can overflow.
+        const size_t block_end = std::min(size - size % 16, i + 16 * 16384);
+        __m256i lanes = _mm256_setzero_si256();
+        for (; i < block_end; i += 16) {
+            const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            lanes = _mm256_add_epi32(lanes, _mm256_madd_epi16(values, ones));
+        }
+        alignas(32) uint32_t parts[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(parts), lanes);
+        for (uint32_t part : parts) {
+            sum += part;
+        }
+    }
+    return sum + sum_scalar(data + i, size - i);
+}
+
+__attribute__((target("avx2"))) size_t count_equal_avx2(const uint16_t* data, size_t size, uint16_t value) {
+    const __m256i target = _mm256_set1_epi16(static_cast<int16_t>(value));
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(values, target)));
+        count += static_cast<size_t>(__builtin_popcount(mask)) / 2;
+    }
+    return count + count_equal_scalar(data + i, size - i, value);
+}
+
+bool has_avx2() {
+    static const bool available = __builtin_cpu_supports("avx2");
+    return available;
+}
+
+#endif
+
+} // namespace
+
+uint64_t slot_count_sum(const uint16_t* data, size_t size) {
+#ifdef ELASTISCHED_SLOT_AVX2
+    if (has_avx2()) {
+        return sum_avx2(data, size);
+    }
+#endif
+    return sum_scalar(data, size);
+}
+
+size_t slot_count_equal(const uint16_t* data, size_t size, uint16_t value) {
+#ifdef ELASTISCHED_SLOT_AVX2
+    if (has_avx2()) {
+        return count_equal_avx2(data, size, value);
+    }
+#endif
+    return count_equal_scalar(data, size, value);
+}
+
+bool SlotOccupancy::supports(const ProblemTable& problem, const Placement& placement) {
+    const sec_t granularity = problem.granularity;
+    if (granularity == 0 || problem.size() == 0) {
+        return false;
+    }
+    auto on_grid = [granularity](const TimeRange& range) {
+        return range.get_low() < range.get_high()
+            && range.get_low() % granularity == 0
+            && range.get_high() % granularity == 0;
+    };
+
+    sec_t low = std::numeric_limits<sec_t>::max();
+    sec_t high = 0;
+    size_t segments = 0;
+    for (job_index_t i = 0; i < problem.size(); ++i) {
+        // Moves start flexible jobs on the grid; their ends are on it too
+        // when the duration, and every split piece, is a multiple of it.
+        if (!problem.rigid[i]) {
+            const sec_t duration = problem.duration[i];
+            if (duration == 0 || duration % granularity != 0) {
+                return false;
+            }
+            if (problem.is_splittable(i) && problem.max_splits[i] > 0 && !problem.rounds_to_granularity(i)) {
+                return false;
+            }
+            low = std::min(low, problem.window_low[i]);
+            high = std::max(high, problem.window_high[i]);
+        }
+        for (const TimeRange* range = placement.begin(i); range != placement.end(i); ++range) {
+            if (!on_grid(*range)) {
+                return false;
+            }
+            low = std::min(low, range->get_low());
+            high = std::max(high, range->get_high());
+        }
+        segments += problem.segment_capacity(i);
+    }
+    low -= low % granularity;
+    return segments <= MAX_SEGMENTS && (high - low) / granularity + 1 <= MAX_SLOTS;
+}
+
+SlotOccupancy::SlotOccupancy(const ProblemTable& problem, const Placement& placement)
+    : granularity(problem.granularity) {
+    sec_t low = std::numeric_limits<sec_t>::max();
+    sec_t high = 0;
+    for (job_index_t i = 0; i < problem.size(); ++i) {
+        if (!problem.rigid[i]) {
+            low = std::min(low, problem.window_low[i]);
+            high = std::max(high, problem.window_high[i]);
+        }
+        for (const TimeRange* range = placement.begin(i); range != placement.end(i); ++range) {
+            low = std::min(low, range->get_low());
+            high = std::max(high, range->get_high());
+        }
+    }
+    origin = low - low % granularity;
+    const size_t slots = static_cast<size_t>((high - origin) / granularity + 1);
+    counts.assign(slots, 0);
+    hard_counts.assign(slots, 0);
+    for (job_index_t i = 0; i < problem.size(); ++i) {
+        insert(!problem.is_overlappable(i), placement.begin(i), placement.count(i));
+    }
+}
+
+bool SlotOccupancy::holds(const TimeRange* ranges, uint32_t count) const {
+    const sec_t horizon = origin + static_cast<sec_t>(counts.size()) * granularity;
+    for (uint32_t k = 0; k < count; ++k) {
+        const sec_t low = ranges[k].get_low();
+        const sec_t high = ranges[k].get_high();
+        if (low < origin || high > horizon || low >= high || low % granularity != 0 || high % granularity != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SlotOccupancy::crowded(const TimeRange* ranges, uint32_t count) const {
+    for (uint32_t k = 0; k < count; ++k) {
+        const size_t first = static_cast<size_t>((ranges[k].get_low() - origin) / granularity);
+        const size_t size = static_cast<size_t>(ranges[k].length() / granularity);
+        if (slot_count_sum(counts.data() + first, size) > size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SlotOccupancy::insert(bool hard, const TimeRange* ranges, uint32_t count) {
+    for (uint32_t k = 0; k < count; ++k) {
+        const size_t first = static_cast<size_t>((ranges[k].get_low() - origin) / granularity);
+        const size_t size = static_cast<size_t>(ranges[k].length() / granularity);
+        uint16_t* slot = counts.data() + first;
+        // Every segment already in a slot gains a partner there.
+        overlap += slot_count_sum(slot, size);
+        for (size_t s = 0; s < size; ++s) {
+            ++slot[s];
+        }
+        if (hard) {
+            uint16_t* hard_slot = hard_counts.data() + first;
+            conflicts += slot_count_equal(hard_slot, size, 1);
+            for (size_t s = 0; s < size; ++s) {
+                ++hard_slot[s];
+            }
+        }
+    }
+}
+
+void SlotOccupancy::remove(bool hard, const TimeRange* ranges, uint32_t count) {
+    for (uint32_t k = 0; k < count; ++k) {
+        const size_t first = static_cast<size_t>((ranges[k].get_low() - origin) / granularity);
+        const size_t size = static_cast<size_t>(ranges[k].length() / granularity);
+        uint16_t* slot = counts.data() + first;
+        for (size_t s = 0; s < size; ++s) {
+            --slot[s];
+        }
+        overlap -= slot_count_sum(slot, size);
+        if (hard) {
+            uint16_t* hard_slot = hard_counts.data() + first;
+            for (size_t s = 0; s < size; ++s) {
+                --hard_slot[s];
+            }
+            conflicts -= slot_count_equal(hard_slot, size, 1);
+        }
+    }
+}
+
+uint64_t SlotOccupancy::overlap_slots() const {
+    return overlap;
+}
+
+uint64_t SlotOccupancy::conflict_slots() const {
+    return conflicts;
+}
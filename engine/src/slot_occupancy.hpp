@@ -0,0 +1,64 @@
+#ifndef ELASTISCHED_SLOT_OCCUPANCY_HPP
+#define ELASTISCHED_SLOT_OCCUPANCY_HPP
+
+#include "problem_table.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * SlotOccupancy
+ *
+ * Occupancy of the horizon of a problem at granularity resolution: for
+ * every slot, how many segments cover it and how many of those belong to
+ * jobs that may not overlap. Kept alongside a Placement, it tracks
+ *  - the pairwise overlap of all segments, in slots, and
+ *  - the number of slots where two hard segments meet,
+ * so moving a job costs a few passes over the slots it leaves and enters
+ * instead of a search for the segments it meets. The passes use AVX2 when
+ * the CPU has it.
+ *
+ * Only exact when every segment the solver can produce starts and ends on
+ * the slot grid, which supports() checks.
+ */
+class SlotOccupancy {
+public:
+    static constexpr size_t MAX_SLOTS = size_t(1) << 22;
+
+    // Whether problem, starting from placement, only ever produces
+    // segments on the granularity grid, and its horizon and segment count
+    // fit the slot arrays.
+    static bool supports(const ProblemTable& problem, const Placement& placement);
+
+    SlotOccupancy() = default;
+    SlotOccupancy(const ProblemTable& problem, const Placement& placement);
+
+    // Whether ranges lie on the slot grid inside the horizon.
+    bool holds(const TimeRange* ranges, uint32_t count) const;
+
+    // Whether a slot under ranges holds more than one segment.
+    bool crowded(const TimeRange* ranges, uint32_t count) const;
+
+    void insert(bool hard, const TimeRange* ranges, uint32_t count);
+    void remove(bool hard, const TimeRange* ranges, uint32_t count);
+
+    uint64_t overlap_slots() const;
+    uint64_t conflict_slots() const;
+
+private:
+    sec_t origin = 0;
+    sec_t granularity = 1;
+    std::vector<uint16_t> counts;
+    std::vector<uint16_t> hard_counts;
+    uint64_t overlap = 0;
+    uint64_t conflicts = 0;
+};
+
+// Sum of data[0, size), and the number of entries equal to value; these
+// are the inner loops of SlotOccupancy.
+uint64_t slot_count_sum(const uint16_t* data, size_t size);
+size_t slot_count_equal(const uint16_t* data, size_t size, uint16_t value);
+
+#endif // ELASTISCHED_SLOT_OCCUPANCY_HPP
@@ -0,0 +1,600 @@
+#include "snapshot.hpp"
+
+#include "policy.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t SECTION_ALIGNMENT = 8;
+
+/**
+ * SnapshotBuffer
+ *
+ * Bytes of a snapshot being written. Every section is padded to
+ * SECTION_ALIGNMENT so the reader can view it in place.
+ */
+class SnapshotBuffer {
+public:
+    SnapshotBuffer() : bytes(sizeof(SnapshotHeader), 0) {}
+
+    template <typename T>
+    uint64_t append(const std::vector<T>& values) {
+        bytes.resize((bytes.size() + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT, 0);
+        const uint64_t offset = bytes.size();
+        if (!values.empty()) {
+            const auto* first = reinterpret_cast<const unsigned char*>(values.data());
+            bytes.insert(bytes.end(), first, first + values.size() * sizeof(T));
+        }
+        return offset;
+    }
+
+    // Writes to a file of its own beside path and renames it over path, so
+    // concurrent writers never interleave and a reader that has the old
+    // file mapped keeps it whole.
+    void write(const std::string& path, const SnapshotHeader& header) {
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        static std::atomic<uint64_t> next_temp{0};
+#ifndef _WIN32
+        const uint64_t process = static_cast<uint64_t>(::getpid());
+#else
+        const uint64_t process = 0;
+#endif
+        const std::string temp = path + ".tmp-" + std::to_string(process) + "-" + std::to_string(next_temp++);
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            out.close();
+            if (!out) {
+                std::error_code ignored;
+                std::filesystem::remove(temp, ignored);
+                throw std::invalid_argument("write_snapshot: cannot write " + path);
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temp, path, error);
+        if (error) {
+            std::error_code ignored;
+            std::filesystem::remove(temp, ignored);
+            throw std::invalid_argument("write_snapshot: cannot write " + path);
+        }
+    }
+
+private:
+    std::vector<unsigned char> bytes;
+};
+
+uint32_t checked_offset(size_t count, const char* what) {
+    if (count > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument(std::string("write_snapshot: too many ") + what);
+    }
+    return static_cast<uint32_t>(count);
+}
+
+void fill_config(SnapshotHeader& header, const EngineConfig& config) {
+    header.granularity = config.granularity;
+    header.seed = config.seed;
+    header.num_iters = config.num_iters;
+    header.num_workers = config.num_workers;
+    header.num_replicas = config.num_replicas;
+    header.swap_interval = config.swap_interval;
+    header.time_budget_ms = config.time_budget_ms;
+    header.plateau_iters = config.plateau_iters;
+    header.cost_history_interval = config.cost_history.interval;
+    header.cost_history_capacity = config.cost_history.capacity;
+    header.initial_temp = config.initial_temp;
+    header.final_temp = config.final_temp;
+    header.reheat_temp_fraction = config.reheat_temp_fraction;
+    header.illegal_schedule_weight = config.illegal_schedule_weight;
+    header.overlap_cost_weight = config.overlap_cost_weight;
+    header.split_cost_weight = config.split_cost_weight;
+    header.calibration_samples = config.calibration_samples;
+    header.max_reheats = config.max_reheats;
+    header.cost_history_mode = static_cast<uint8_t>(config.cost_history.mode);
+    header.greedy_start = config.greedy_start ? 1 : 0;
+    header.adaptive_moves = config.adaptive_moves ? 1 : 0;
+}
+
+// Offsets of a CSR list: start at 0, never decrease, end at total.
+void check_offsets(const uint32_t* offsets, size_t n, uint64_t total, const char* what) {
+    if (offsets[0] != 0 || offsets[n] != total) {
+        throw std::invalid_argument(std::string("snapshot: ") + what + " offsets do not span the section");
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (offsets[i + 1] < offsets[i]) {
+            throw std::invalid_argument(std::string("snapshot: ") + what + " offsets decrease");
+        }
+    }
+}
+
+}  // namespace
+
+void write_snapshot(
+    const std::string& path,
+    const std::vector<Job>& jobs,
+    const EngineConfig& config,
+    const Schedule* schedule) {
+    const size_t n = jobs.size();
+    if (n >= std::numeric_limits<job_index_t>::max()) {
+        throw std::invalid_argument("write_snapshot: too many jobs");
+    }
+
+    std::unordered_map<ID, job_index_t> index_of;
+    index_of.reserve(n);
+    for (job_index_t i = 0; i < n; ++i) {
+        if (!index_of.emplace(jobs[i].id, i).second) {
+            throw std::invalid_argument("write_snapshot: duplicate job id " + jobs[i].id);
+        }
+    }
+
+    std::vector<sec_t> duration, window_low, window_high, scheduled_low, scheduled_high, min_split_duration;
+    std::vector<uint8_t> policy_bits, max_splits;
+    duration.reserve(n);
+    window_low.reserve(n);
+    window_high.reserve(n);
+    scheduled_low.reserve(n);
+    scheduled_high.reserve(n);
+    min_split_duration.reserve(n);
+    policy_bits.reserve(n);
+    max_splits.reserve(n);
+
+    std::vector<uint32_t> dependency_offsets{0}, initial_offsets{0}, tag_offsets{0};
+    std::vector<job_index_t> dependency_indices;
+    std::vector<sec_t> initial_low, initial_high;
+    std::vector<uint32_t> tag_names, tag_descriptions;
+
+    std::vector<uint64_t> string_offsets{0};
+    std::string string_bytes;
+    std::unordered_map<std::string, uint32_t> tag_strings;
+    auto add_string = [&](const std::string& value) {
+        string_bytes += value;
+        string_offsets.push_back(string_bytes.size());
+        return checked_offset(string_offsets.size() - 2, "strings");
+    };
+    auto add_tag_string = [&](const std::string& value) {
+        const auto found = tag_strings.find(value);
+        if (found != tag_strings.end()) {
+            return found->second;
+        }
+        const uint32_t index = add_string(value);
+        tag_strings.emplace(value, index);
+        return index;
+    };
+
+    for (const Job& job : jobs) {
+        add_string(job.id);
+    }
+    for (const Job& job : jobs) {
+        duration.push_back(job.duration);
+        window_low.push_back(job.schedulable_time_range.get_low());
+        window_high.push_back(job.schedulable_time_range.get_high());
+        scheduled_low.push_back(job.scheduled_time_range.get_low());
+        scheduled_high.push_back(job.scheduled_time_range.get_high());
+        policy_bits.push_back(job.policy.get_scheduling_policies());
+        max_splits.push_back(job.policy.get_max_splits());
+        min_split_duration.push_back(job.policy.get_min_split_duration());
+
+        for (const ID& dependency : job.dependencies) {
+            const auto found = index_of.find(dependency);
+            if (found != index_of.end()) {
+                dependency_indices.push_back(found->second);
+            }
+        }
+        dependency_offsets.push_back(checked_offset(dependency_indices.size(), "dependencies"));
+
+        for (const TimeRange& range : job.get_scheduled_time_ranges()) {
+            initial_low.push_back(range.get_low());
+            initial_high.push_back(range.get_high());
+        }
+        initial_offsets.push_back(checked_offset(initial_low.size(), "segments"));
+
+        for (const Tag& tag : job.tags) {
+            tag_names.push_back(add_tag_string(tag.get_name()));
+            tag_descriptions.push_back(add_tag_string(tag.get_description()));
+        }
+        tag_offsets.push_back(checked_offset(tag_names.size(), "tags"));
+    }
+
+    std::vector<uint32_t> schedule_offsets;
+    std::vector<sec_t> schedule_low, schedule_high;
+    if (schedule != nullptr) {
+        if (schedule->scheduled_jobs.size() != n) {
+            throw std::invalid_argument("write_snapshot: schedule does not hold the same jobs");
+        }
+        std::vector<const Job*> placed(n, nullptr);
+        for (const Job& job : schedule->scheduled_jobs) {
+            const auto found = index_of.find(job.id);
+            if (found == index_of.end() || placed[found->second] != nullptr) {
+                throw std::invalid_argument("write_snapshot: schedule does not hold the same jobs");
+            }
+            placed[found->second] = &job;
+        }
+        schedule_offsets.push_back(0);
+        for (const Job* job : placed) {
+            if (job->get_scheduled_time_ranges().empty()) {
+                schedule_low.push_back(job->scheduled_time_range.get_low());
+                schedule_high.push_back(job->scheduled_time_range.get_high());
+            }
+            for (const TimeRange& range : job->get_scheduled_time_ranges()) {
+                schedule_low.push_back(range.get_low());
+                schedule_high.push_back(range.get_high());
+            }
+            schedule_offsets.push_back(checked_offset(schedule_low.size(), "segments"));
+        }
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.sec_t_bytes = sizeof(sec_t);
+    header.flags = schedule != nullptr ? SNAPSHOT_HAS_SCHEDULE : 0;
+    header.job_count = n;
+    header.dependency_count = dependency_indices.size();
+    header.initial_segment_count = initial_low.size();
+    header.tag_count = tag_names.size();
+    header.string_count = string_offsets.size() - 1;
+    header.string_bytes = string_bytes.size();
+    header.schedule_segment_count = schedule_low.size();
+    fill_config(header, config);
+
+    SnapshotBuffer buffer;
+    uint64_t* offsets = header.section_offsets;
+    offsets[SECTION_DURATION] = buffer.append(duration);
+    offsets[SECTION_WINDOW_LOW] = buffer.append(window_low);
+    offsets[SECTION_WINDOW_HIGH] = buffer.append(window_high);
+    offsets[SECTION_SCHEDULED_LOW] = buffer.append(scheduled_low);
+    offsets[SECTION_SCHEDULED_HIGH] = buffer.append(scheduled_high);
+    offsets[SECTION_POLICY_BITS] = buffer.append(policy_bits);
+    offsets[SECTION_MAX_SPLITS] = buffer.append(max_splits);
+    offsets[SECTION_MIN_SPLIT_DURATION] = buffer.append(min_split_duration);
+    offsets[SECTION_DEPENDENCY_OFFSETS] = buffer.append(dependency_offsets);
+    offsets[SECTION_DEPENDENCY_INDICES] = buffer.append(dependency_indices);
+    offsets[SECTION_INITIAL_OFFSETS] = buffer.append(initial_offsets);
+    offsets[SECTION_INITIAL_LOW] = buffer.append(initial_low);
+    offsets[SECTION_INITIAL_HIGH] = buffer.append(initial_high);
+    offsets[SECTION_TAG_OFFSETS] = buffer.append(tag_offsets);
+    offsets[SECTION_TAG_NAMES] = buffer.append(tag_names);
+    offsets[SECTION_TAG_DESCRIPTIONS] = buffer.append(tag_descriptions);
+    offsets[SECTION_STRING_OFFSETS] = buffer.append(string_offsets);
+    offsets[SECTION_STRING_BYTES] = buffer.append(std::vector<char>(string_bytes.begin(), string_bytes.end()));
+    offsets[SECTION_SCHEDULE_OFFSETS] = buffer.append(schedule_offsets);
+    offsets[SECTION_SCHEDULE_LOW] = buffer.append(schedule_low);
+    offsets[SECTION_SCHEDULE_HIGH] = buffer.append(schedule_high);
+    buffer.write(path, header);
+}
+
+MappedSnapshot::MappedSnapshot(const std::string& path) {
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::invalid_argument("snapshot: cannot open " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        throw std::invalid_argument("snapshot: " + path + " is too short to be a snapshot");
+    }
+    length = static_cast<size_t>(info.st_size);
+    void* address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw std::invalid_argument("snapshot: cannot map " + path);
+    }
+    data = static_cast<const unsigned char*>(address);
+#else
+    // No mmap: read the file into a buffer aligned like a mapping would be.
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        throw std::invalid_argument("snapshot: cannot open " + path);
+    }
+    length = static_cast<size_t>(in.tellg());
+    if (length < sizeof(SnapshotHeader)) {
+        throw std::invalid_argument("snapshot: " + path + " is too short to be a snapshot");
+    }
+    auto* buffer = new uint64_t[(length + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(length));
+    data = reinterpret_cast<const unsigned char*>(buffer);
+    if (!in) {
+        release();
+        throw std::invalid_argument("snapshot: cannot read " + path);
+    }
+#endif
+    try {
+        validate();
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+MappedSnapshot::~MappedSnapshot() {
+    release();
+}
+
+MappedSnapshot::MappedSnapshot(MappedSnapshot&& other) noexcept
+    : data(std::exchange(other.data, nullptr)), length(std::exchange(other.length, 0)) {}
+
+MappedSnapshot& MappedSnapshot::operator=(MappedSnapshot&& other) noexcept {
+    if (this != &other) {
+        release();
+        data = std::exchange(other.data, nullptr);
+        length = std::exchange(other.length, 0);
+    }
+    return *this;
+}
+
+void MappedSnapshot::release() {
+    if (data == nullptr) {
+        return;
+    }
+#ifndef _WIN32
+    ::munmap(const_cast<unsigned char*>(data), length);
+#else
+    delete[] reinterpret_cast<const uint64_t*>(data);
+#endif
+    data = nullptr;
+    length = 0;
+}
+
+template <typename T>
+const T* MappedSnapshot::section(SnapshotSection which) const {
+    return reinterpret_cast<const T*>(data + header().section_offsets[which]);
+}
+
+void MappedSnapshot::validate() const {
+    const SnapshotHeader& h = header();
+    if (std::memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0) {
+        throw std::invalid_argument("snapshot: not a snapshot file");
+    }
+    if (h.version != SNAPSHOT_VERSION) {
+        throw std::invalid_argument(
+            "snapshot: version " + std::to_string(h.version) + " is not supported, expected " +
+            std::to_string(SNAPSHOT_VERSION));
+    }
+    if (h.byte_order != SNAPSHOT_BYTE_ORDER) {
+        throw std::invalid_argument("snapshot: written with a different byte order");
+    }
+    if (h.sec_t_bytes != sizeof(sec_t)) {
+        throw std::invalid_argument(
+            "snapshot: written with " + std::to_string(h.sec_t_bytes * 8) + "-bit sec_t, engine uses " +
+            std::to_string(sizeof(sec_t) * 8));
+    }
+    constexpr uint64_t max_index = std::numeric_limits<uint32_t>::max();
+    if (h.job_count >= max_index || h.dependency_count > max_index || h.initial_segment_count > max_index ||
+        h.tag_count > max_index || h.string_count > max_index || h.schedule_segment_count > max_index ||
+        h.string_count < h.job_count) {
+        throw std::invalid_argument("snapshot: counts out of range");
+    }
+    if (h.cost_history_mode > static_cast<uint8_t>(CostHistoryMode::BUCKETS)) {
+        throw std::invalid_argument("snapshot: unknown cost history mode");
+    }
+
+    const uint64_t n = h.job_count;
+    const bool has_schedule = (h.flags & SNAPSHOT_HAS_SCHEDULE) != 0;
+    const uint64_t counts[SECTION_COUNT] = {
+        n, n, n, n, n, n, n, n,
+        n + 1, h.dependency_count,
+        n + 1, h.initial_segment_count, h.initial_segment_count,
+        n + 1, h.tag_count, h.tag_count,
+        h.string_count + 1, h.string_bytes,
+        has_schedule ? n + 1 : 0, h.schedule_segment_count, h.schedule_segment_count,
+    };
+    const size_t widths[SECTION_COUNT] = {
+        sizeof(sec_t), sizeof(sec_t), sizeof(sec_t), sizeof(sec_t), sizeof(sec_t),
+        sizeof(uint8_t), sizeof(uint8_t), sizeof(sec_t),
+        sizeof(uint32_t), sizeof(job_index_t),
+        sizeof(uint32_t), sizeof(sec_t), sizeof(sec_t),
+        sizeof(uint32_t), sizeof(uint32_t), sizeof(uint32_t),
+        sizeof(uint64_t), sizeof(char),
+        sizeof(uint32_t), sizeof(sec_t), sizeof(sec_t),
+    };
+    for (uint32_t s = 0; s < SECTION_COUNT; ++s) {
+        const uint64_t offset = h.section_offsets[s];
+        if (offset % SECTION_ALIGNMENT != 0 || offset < sizeof(SnapshotHeader) || offset > length ||
+            counts[s] > (length - offset) / widths[s]) {
+            throw std::invalid_argument("snapshot: section " + std::to_string(s) + " lies outside the file");
+        }
+    }
+    if (!has_schedule && h.schedule_segment_count != 0) {
+        throw std::invalid_argument("snapshot: schedule segments without a schedule");
+    }
+
+    check_offsets(section<uint32_t>(SECTION_DEPENDENCY_OFFSETS), n, h.dependency_count, "dependency");
+    check_offsets(section<uint32_t>(SECTION_INITIAL_OFFSETS), n, h.initial_segment_count, "segment");
+    check_offsets(section<uint32_t>(SECTION_TAG_OFFSETS), n, h.tag_count, "tag");
+    if (has_schedule) {
+        check_offsets(section<uint32_t>(SECTION_SCHEDULE_OFFSETS), n, h.schedule_segment_count, "schedule");
+    }
+
+    const job_index_t* dependencies = section<job_index_t>(SECTION_DEPENDENCY_INDICES);
+    for (uint64_t k = 0; k < h.dependency_count; ++k) {
+        if (dependencies[k] >= n) {
+            throw std::invalid_argument("snapshot: dependency index out of range");
+        }
+    }
+    const uint32_t* tag_names = section<uint32_t>(SECTION_TAG_NAMES);
+    const uint32_t* tag_descriptions = section<uint32_t>(SECTION_TAG_DESCRIPTIONS);
+    for (uint64_t k = 0; k < h.tag_count; ++k) {
+        if (tag_names[k] >= h.string_count || tag_descriptions[k] >= h.string_count) {
+            throw std::invalid_argument("snapshot: tag string out of range");
+        }
+    }
+    const uint64_t* strings = section<uint64_t>(SECTION_STRING_OFFSETS);
+    if (strings[0] != 0 || strings[h.string_count] != h.string_bytes) {
+        throw std::invalid_argument("snapshot: string offsets do not span the section");
+    }
+    for (uint64_t k = 0; k < h.string_count; ++k) {
+        if (strings[k + 1] < strings[k]) {
+            throw std::invalid_argument("snapshot: string offsets decrease");
+        }
+    }
+}
+
+size_t MappedSnapshot::size() const {
+    return static_cast<size_t>(header().job_count);
+}
+
+const SnapshotHeader& MappedSnapshot::header() const {
+    return *reinterpret_cast<const SnapshotHeader*>(data);
+}
+
+EngineConfig MappedSnapshot::config() const {
+    const SnapshotHeader& h = header();
+    EngineConfig config;
+    config.granularity = h.granularity;
+    config.seed = h.seed;
+    config.num_iters = h.num_iters;
+    config.num_workers = h.num_workers;
+    config.num_replicas = h.num_replicas;
+    config.swap_interval = h.swap_interval;
+    config.time_budget_ms = h.time_budget_ms;
+    config.plateau_iters = h.plateau_iters;
+    config.cost_history.mode = static_cast<CostHistoryMode>(h.cost_history_mode);
+    config.cost_history.interval = h.cost_history_interval;
+    config.cost_history.capacity = static_cast<size_t>(h.cost_history_capacity);
+    config.initial_temp = h.initial_temp;
+    config.final_temp = h.final_temp;
+    config.reheat_temp_fraction = h.reheat_temp_fraction;
+    config.illegal_schedule_weight = h.illegal_schedule_weight;
+    config.overlap_cost_weight = h.overlap_cost_weight;
+    config.split_cost_weight = h.split_cost_weight;
+    config.calibration_samples = h.calibration_samples;
+    config.max_reheats = h.max_reheats;
+    config.greedy_start = h.greedy_start != 0;
+    config.adaptive_moves = h.adaptive_moves != 0;
+    return config;
+}
+
+JobBatch MappedSnapshot::batch() const {
+    JobBatch batch;
+    batch.size = size();
+    batch.duration = section<sec_t>(SECTION_DURATION);
+    batch.window_low = section<sec_t>(SECTION_WINDOW_LOW);
+    batch.window_high = section<sec_t>(SECTION_WINDOW_HIGH);
+    batch.scheduled_low = section<sec_t>(SECTION_SCHEDULED_LOW);
+    batch.scheduled_high = section<sec_t>(SECTION_SCHEDULED_HIGH);
+    batch.policy_bits = section<uint8_t>(SECTION_POLICY_BITS);
+    batch.max_splits = section<uint8_t>(SECTION_MAX_SPLITS);
+    batch.min_split_duration = section<sec_t>(SECTION_MIN_SPLIT_DURATION);
+    batch.dependency_offsets = section<uint32_t>(SECTION_DEPENDENCY_OFFSETS);
+    batch.dependency_indices = section<job_index_t>(SECTION_DEPENDENCY_INDICES);
+    return batch;
+}
+
+std::string_view MappedSnapshot::string(uint32_t index) const {
+    const uint64_t* offsets = section<uint64_t>(SECTION_STRING_OFFSETS);
+    return std::string_view(
+        section<char>(SECTION_STRING_BYTES) + offsets[index],
+        static_cast<size_t>(offsets[index + 1] - offsets[index]));
+}
+
+std::string_view MappedSnapshot::id(job_index_t job) const {
+    if (job >= size()) {
+        throw std::invalid_argument("snapshot: job index out of range");
+    }
+    return string(job);
+}
+
+bool MappedSnapshot::has_schedule() const {
+    return (header().flags & SNAPSHOT_HAS_SCHEDULE) != 0;
+}
+
+const uint32_t* MappedSnapshot::schedule_offsets() const {
+    return has_schedule() ? section<uint32_t>(SECTION_SCHEDULE_OFFSETS) : nullptr;
+}
+
+const sec_t* MappedSnapshot::schedule_low() const {
+    return has_schedule() ? section<sec_t>(SECTION_SCHEDULE_LOW) : nullptr;
+}
+
+const sec_t* MappedSnapshot::schedule_high() const {
+    return has_schedule() ? section<sec_t>(SECTION_SCHEDULE_HIGH) : nullptr;
+}
+
+std::vector<Job> MappedSnapshot::jobs() const {
+    const JobBatch view = batch();
+    const uint32_t* initial_offsets = section<uint32_t>(SECTION_INITIAL_OFFSETS);
+    const sec_t* initial_low = section<sec_t>(SECTION_INITIAL_LOW);
+    const sec_t* initial_high = section<sec_t>(SECTION_INITIAL_HIGH);
+    const uint32_t* tag_offsets = section<uint32_t>(SECTION_TAG_OFFSETS);
+    const uint32_t* tag_names = section<uint32_t>(SECTION_TAG_NAMES);
+    const uint32_t* tag_descriptions = section<uint32_t>(SECTION_TAG_DESCRIPTIONS);
+
+    std::vector<Job> jobs;
+    jobs.reserve(view.size);
+    for (job_index_t i = 0; i < view.size; ++i) {
+        const uint8_t bits = view.policy_bits[i];
+        Policy policy(
+            view.max_splits[i],
+            view.min_split_duration[i],
+            (bits & policy_flags::SPLITTABLE) != 0,
+            (bits & policy_flags::OVERLAPPABLE) != 0,
+            (bits & policy_flags::INVISIBLE) != 0,
+            (bits & policy_flags::ROUND_TO_GRANULARITY) != 0);
+
+        std::set<ID> dependencies;
+        for (uint32_t k = view.dependency_offsets[i]; k < view.dependency_offsets[i + 1]; ++k) {
+            dependencies.emplace(string(view.dependency_indices[k]));
+        }
+        std::set<Tag> tags;
+        for (uint32_t k = tag_offsets[i]; k < tag_offsets[i + 1]; ++k) {
+            tags.emplace(std::string(string(tag_names[k])), std::string(string(tag_descriptions[k])));
+        }
+
+        jobs.emplace_back(
+            view.duration[i],
+            TimeRange(view.window_low[i], view.window_high[i]),
+            TimeRange(view.scheduled_low[i], view.scheduled_high[i]),
+            ID(string(i)),
+            policy,
+            std::move(dependencies),
+            std::move(tags));
+
+        std::vector<TimeRange> ranges;
+        ranges.reserve(initial_offsets[i + 1] - initial_offsets[i]);
+        for (uint32_t k = initial_offsets[i]; k < initial_offsets[i + 1]; ++k) {
+            ranges.emplace_back(initial_low[k], initial_high[k]);
+        }
+        jobs.back().set_scheduled_time_ranges(std::move(ranges));
+    }
+    return jobs;
+}
+
+Schedule MappedSnapshot::schedule() const {
+    if (!has_schedule()) {
+        throw std::invalid_argument("snapshot: no schedule stored");
+    }
+    const uint32_t* offsets = schedule_offsets();
+    const sec_t* low = schedule_low();
+    const sec_t* high = schedule_high();
+
+    std::vector<Job> placed = jobs();
+    for (job_index_t i = 0; i < placed.size(); ++i) {
+        std::vector<TimeRange> ranges;
+        ranges.reserve(offsets[i + 1] - offsets[i]);
+        for (uint32_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+            ranges.emplace_back(low[k], high[k]);
+        }
+        placed[i].set_scheduled_time_ranges(std::move(ranges));
+    }
+    return Schedule(std::move(placed));
+}
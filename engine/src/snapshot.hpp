@@ -0,0 +1,189 @@
+#ifndef ELASTISCHED_SNAPSHOT_HPP
+#define ELASTISCHED_SNAPSHOT_HPP
+
+#include "engine.hpp"
+#include "problem_table.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Snapshot file format
+ *
+ * A whole problem, the configuration to solve it with and optionally its
+ * solved schedule, laid out so a mapped file can be handed to solve_batch
+ * as is. The file is a SnapshotHeader followed by the sections it lists,
+ * each starting on an 8-byte boundary. Numbers are stored in the byte
+ * order and sec_t width of the machine that wrote them; a reader with a
+ * different one rejects the file rather than converting it.
+ *
+ * Per-job columns (size job_count) mirror JobBatch: duration, window_low,
+ * window_high, scheduled_low, scheduled_high, policy_bits, max_splits and
+ * min_split_duration. Everything else is in CSR form, with job_count + 1
+ * offsets per list:
+ *  - dependencies, as indices of the jobs that must finish first;
+ *  - initial segments, the scheduled_time_ranges of each job (empty when
+ *    the job only has scheduled_time_range);
+ *  - tags, as pairs of string indices (name, description);
+ *  - schedule segments, present when SNAPSHOT_HAS_SCHEDULE is set.
+ * Strings are concatenated into one blob with string_count + 1 offsets;
+ * string i is the id of job i for every i < job_count.
+ *
+ * SNAPSHOT_VERSION changes whenever the layout does.
+ */
+constexpr char SNAPSHOT_MAGIC[8] = {'E', 'L', 'S', 'N', 'A', 'P', '\r', '\n'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+constexpr uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+constexpr uint32_t SNAPSHOT_HAS_SCHEDULE = 1u << 0;
+
+enum SnapshotSection : uint32_t {
+    SECTION_DURATION,
+    SECTION_WINDOW_LOW,
+    SECTION_WINDOW_HIGH,
+    SECTION_SCHEDULED_LOW,
+    SECTION_SCHEDULED_HIGH,
+    SECTION_POLICY_BITS,
+    SECTION_MAX_SPLITS,
+    SECTION_MIN_SPLIT_DURATION,
+    SECTION_DEPENDENCY_OFFSETS,
+    SECTION_DEPENDENCY_INDICES,
+    SECTION_INITIAL_OFFSETS,
+    SECTION_INITIAL_LOW,
+    SECTION_INITIAL_HIGH,
+    SECTION_TAG_OFFSETS,
+    SECTION_TAG_NAMES,
+    SECTION_TAG_DESCRIPTIONS,
+    SECTION_STRING_OFFSETS,
+    SECTION_STRING_BYTES,
+    SECTION_SCHEDULE_OFFSETS,
+    SECTION_SCHEDULE_LOW,
+    SECTION_SCHEDULE_HIGH,
+    SECTION_COUNT
+};
+
+/**
+ * SnapshotHeader
+ *
+ * Fixed-size start of every snapshot. The solver parameters are the
+ * numeric fields of EngineConfig; its logging fields are not kept.
+ * section_offsets holds the byte offset of each SnapshotSection from the
+ * start of the file.
+ */
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t sec_t_bytes;
+    uint32_t flags;
+
+    uint64_t job_count;
+    uint64_t dependency_count;
+    uint64_t initial_segment_count;
+    uint64_t tag_count;
+    uint64_t string_count;
+    uint64_t string_bytes;
+    uint64_t schedule_segment_count;
+
+    uint64_t granularity;
+    uint64_t seed;
+    uint64_t num_iters;
+    uint64_t num_workers;
+    uint64_t num_replicas;
+    uint64_t swap_interval;
+    uint64_t time_budget_ms;
+    uint64_t plateau_iters;
+    uint64_t cost_history_interval;
+    uint64_t cost_history_capacity;
+    double initial_temp;
+    double final_temp;
+    double reheat_temp_fraction;
+    double illegal_schedule_weight;
+    double overlap_cost_weight;
+    double split_cost_weight;
+    uint32_t calibration_samples;
+    uint32_t max_reheats;
+    uint8_t cost_history_mode;
+    uint8_t greedy_start;
+    uint8_t adaptive_moves;
+    uint8_t reserved[5];
+
+    uint64_t section_offsets[SECTION_COUNT];
+};
+
+static_assert(sizeof(SnapshotHeader) % 8 == 0, "snapshot sections must stay 8-byte aligned");
+
+/**
+ * Writes jobs, config and, if given, the solved schedule to path. The
+ * schedule must hold every job of jobs, matched by id; its segments are
+ * stored in the order of jobs. Dependencies on ids that are not in jobs
+ * are dropped, as in compile_problem. The file is written under a
+ * temporary name and renamed to path, so a MappedSnapshot already open on
+ * path keeps reading the old contents. Throws std::invalid_argument if two
+ * jobs share an id, the schedule does not match the jobs, or the file
+ * cannot be written.
+ */
+void write_snapshot(
+    const std::string& path,
+    const std::vector<Job>& jobs,
+    const EngineConfig& config,
+    const Schedule* schedule = nullptr);
+
+/**
+ * MappedSnapshot
+ *
+ * Read-only view of a snapshot file, memory-mapped for as long as the
+ * object lives. Opening checks the header and every section against the
+ * file size, and every offset and index against the counts, so the views
+ * handed out never read past the mapping; a malformed file throws
+ * std::invalid_argument. Nothing is copied: batch() points straight into
+ * the mapping and can be passed to solve_batch without building any Job.
+ * jobs() and schedule() rebuild the original objects for callers that
+ * need them.
+ */
+class MappedSnapshot {
+public:
+    explicit MappedSnapshot(const std::string& path);
+    ~MappedSnapshot();
+
+    MappedSnapshot(MappedSnapshot&& other) noexcept;
+    MappedSnapshot& operator=(MappedSnapshot&& other) noexcept;
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    size_t size() const;
+    const SnapshotHeader& header() const;
+
+    // The stored configuration; its logging fields are left at their defaults.
+    EngineConfig config() const;
+
+    JobBatch batch() const;
+    std::string_view id(job_index_t job) const;
+
+    bool has_schedule() const;
+    // Schedule segments in CSR form as in BatchSolveResult, or nullptr
+    // when the snapshot has no schedule.
+    const uint32_t* schedule_offsets() const;
+    const sec_t* schedule_low() const;
+    const sec_t* schedule_high() const;
+
+    std::vector<Job> jobs() const;
+    // The jobs placed on the stored schedule. Throws std::invalid_argument
+    // if the snapshot has none.
+    Schedule schedule() const;
+
+private:
+    const unsigned char* data = nullptr;
+    size_t length = 0;
+
+    template <typename T>
+    const T* section(SnapshotSection which) const;
+    std::string_view string(uint32_t index) const;
+    void validate() const;
+    void release();
+};
+
+#endif // ELASTISCHED_SNAPSHOT_HPP
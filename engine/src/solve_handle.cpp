@@ -0,0 +1,197 @@
+#include "solve_handle.hpp"
+
+#include "constants.hpp"
+
+#include <utility>
+
+SolveMonitor::SolveMonitor(ProgressCallback on_progress, std::chrono::milliseconds progress_interval)
+    : on_progress(std::move(on_progress)), progress_interval(progress_interval) {}
+
+void SolveMonitor::cancel() {
+    cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool SolveMonitor::is_cancelled() const {
+    return cancelled.load(std::memory_order_relaxed);
+}
+
+const std::atomic<bool>& SolveMonitor::cancellation_flag() const {
+    return cancelled;
+}
+
+Schedule SolveMonitor::best_schedule() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return best;
+}
+
+SolveProgress SolveMonitor::progress() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current;
+}
+
+void SolveMonitor::begin(
+    const std::vector<Job>& jobs,
+    std::vector<std::vector<job_index_t>> components,
+    bool illegal
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+    best = Schedule(jobs);
+    this->components = std::move(components);
+    this->illegal = illegal;
+    const size_t count = this->components.size();
+    component_costs.assign(count, 0.0);
+    component_iterations.assign(count, 0);
+    component_reported.assign(count, 0);
+    current = SolveProgress{};
+    current.component_count = count;
+    next_callback = Clock::now() + progress_interval;
+    next_report.assign(count, Clock::now() + progress_interval);
+}
+
+bool SolveMonitor::report_due(size_t component) {
+    const Clock::time_point now = Clock::now();
+    if (now < next_report[component]) {
+        return false;
+    }
+    next_report[component] = now + progress_interval;
+    return true;
+}
+
+void SolveMonitor::report(
+    size_t component,
+    const Placement& placement,
+    const AnnealingProgress& progress,
+    bool finished
+) {
+    SolveProgress snapshot;
+    bool call = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const std::vector<job_index_t>& members = components[component];
+        for (job_index_t local = 0; local < members.size(); ++local) {
+            best.scheduled_jobs[members[local]].set_scheduled_time_ranges(
+                std::vector<TimeRange>(placement.begin(local), placement.end(local)));
+        }
+        component_costs[component] = progress.best_cost;
+        component_iterations[component] = progress.iteration;
+        if (!component_reported[component]) {
+            component_reported[component] = 1;
+            ++current.components_reported;
+        }
+
+        bool any_illegal = illegal;
+        double cost = 0.0;
+        uint64_t iterations = 0;
+        for (size_t c = 0; c < component_costs.size(); ++c) {
+            double component_cost = component_costs[c];
+            if (component_cost >= constants::ILLEGAL_SCHEDULE_COST) {
+                component_cost -= constants::ILLEGAL_SCHEDULE_COST;
+                any_illegal = true;
+            }
+            cost += component_cost;
+            iterations += component_iterations[c];
+        }
+        current.iterations = iterations;
+        current.best_cost = cost + (any_illegal ? constants::ILLEGAL_SCHEDULE_COST : 0.0);
+        current.temperature = progress.temperature;
+        if (finished) {
+            ++current.components_done;
+        }
+
+        const Clock::time_point now = Clock::now();
+        const bool last = current.components_done == current.component_count;
+        if (on_progress && (now >= next_callback || (finished && last))) {
+            next_callback = now + progress_interval;
+            snapshot = current;
+            call = true;
+        }
+    }
+
+    // The callback runs outside the lock so that it may read the monitor.
+    if (call) {
+        std::lock_guard<std::mutex> lock(callback_mutex);
+        on_progress(snapshot);
+    }
+}
+
+SolveHandle::SolveHandle(
+    std::vector<Job> jobs,
+    EngineConfig config,
+    SolveMonitor::ProgressCallback on_progress,
+    std::chrono::milliseconds progress_interval
+)
+    : monitor(std::move(on_progress), progress_interval) {
+    monitor.begin(jobs, {}, false);
+    start([this, jobs = std::move(jobs), config = std::move(config)]() mutable {
+        return solve(std::move(jobs), config, &monitor);
+    });
+}
+
+SolveHandle::SolveHandle(
+    Schedule previous,
+    ScheduleChange change,
+    EngineConfig config,
+    SolveMonitor::ProgressCallback on_progress,
+    std::chrono::milliseconds progress_interval
+)
+    : monitor(std::move(on_progress), progress_interval) {
+    monitor.begin(previous.scheduled_jobs, {}, false);
+    start([this, previous = std::move(previous), change = std::move(change), config = std::move(config)]() {
+        return reschedule(previous, change, config, &monitor);
+    });
+}
+
+void SolveHandle::start(std::function<SolveResult()> run) {
+    worker = std::thread([this, run = std::move(run)]() mutable {
+        SolveResult solved;
+        std::exception_ptr failure;
+        try {
+            solved = run();
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        solve_result = std::move(solved);
+        error = failure;
+        finished = true;
+        finished_condition.notify_all();
+    });
+}
+
+SolveHandle::~SolveHandle() {
+    monitor.cancel();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void SolveHandle::cancel() {
+    monitor.cancel();
+}
+
+bool SolveHandle::done() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return finished;
+}
+
+bool SolveHandle::wait_for(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mutex);
+    return finished_condition.wait_for(lock, timeout, [this] { return finished; });
+}
+
+Schedule SolveHandle::best_schedule() const {
+    return monitor.best_schedule();
+}
+
+SolveProgress SolveHandle::progress() const {
+    return monitor.progress();
+}
+
+SolveResult SolveHandle::result() {
+    std::unique_lock<std::mutex> lock(mutex);
+    finished_condition.wait(lock, [this] { return finished; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return solve_result;
+}
@@ -0,0 +1,144 @@
+#ifndef ELASTISCHED_SOLVE_HANDLE_HPP
+#define ELASTISCHED_SOLVE_HANDLE_HPP
+
+#include "engine.hpp"
+#include "optimizer.hpp"
+#include "problem_table.hpp"
+#include "types.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * SolveProgress
+ *
+ * Progress of a whole solve. iterations and best_cost are summed over the
+ * components, with the illegal penalty counted once; temperature is that
+ * of the component that reported last. Components that have not reported
+ * yet add nothing, so best_cost only bounds the whole schedule once
+ * components_reported reaches component_count.
+ */
+struct SolveProgress {
+    uint64_t iterations = 0;
+    double best_cost = 0.0;
+    double temperature = 0.0;
+    size_t components_done = 0;
+    size_t components_reported = 0;
+    size_t component_count = 0;
+};
+
+/**
+ * SolveMonitor
+ *
+ * Lets other threads follow and stop a running solve. cancel() makes every
+ * annealer stop at its next check, after which solve returns the best
+ * placement found so far. best_schedule() can be read at any time and
+ * holds each component's best placement as of its last report.
+ *
+ * Components report at most once per progress_interval, and on_progress
+ * is called at most once per progress_interval (and once more when the
+ * last component finishes), from whichever solver thread reported. Calls
+ * are never concurrent. A monitor follows one solve at a time.
+ */
+class SolveMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+    using ProgressCallback = std::function<void(const SolveProgress&)>;
+
+    SolveMonitor() = default;
+    explicit SolveMonitor(
+        ProgressCallback on_progress,
+        std::chrono::milliseconds progress_interval = std::chrono::milliseconds(100));
+
+    SolveMonitor(const SolveMonitor&) = delete;
+    SolveMonitor& operator=(const SolveMonitor&) = delete;
+
+    void cancel();
+    bool is_cancelled() const;
+    const std::atomic<bool>& cancellation_flag() const;
+
+    Schedule best_schedule() const;
+    SolveProgress progress() const;
+
+    // Called by solve: jobs are the compiled jobs, illegal whether the
+    // components already violate dependencies between each other.
+    void begin(const std::vector<Job>& jobs, std::vector<std::vector<job_index_t>> components, bool illegal);
+    bool report_due(size_t component);
+    void report(size_t component, const Placement& best, const AnnealingProgress& progress, bool finished);
+
+private:
+    std::atomic<bool> cancelled{false};
+    ProgressCallback on_progress;
+    Clock::duration progress_interval = std::chrono::milliseconds(100);
+
+    mutable std::mutex mutex;
+    Schedule best;
+    std::vector<std::vector<job_index_t>> components;
+    std::vector<double> component_costs;
+    std::vector<uint64_t> component_iterations;
+    std::vector<uint8_t> component_reported;
+    bool illegal = false;
+    SolveProgress current;
+    Clock::time_point next_callback;
+
+    // Each entry is only touched by the thread solving that component.
+    std::vector<Clock::time_point> next_report;
+
+    std::mutex callback_mutex;
+};
+
+/**
+ * SolveHandle
+ *
+ * Runs solve, or reschedule, on a thread of its own. The solve can be
+ * followed and cancelled through the handle while it runs; result() waits
+ * for it and rethrows anything the solve threw. Destroying the handle
+ * cancels the solve and waits for it.
+ */
+class SolveHandle {
+public:
+    SolveHandle(
+        std::vector<Job> jobs,
+        EngineConfig config,
+        SolveMonitor::ProgressCallback on_progress = {},
+        std::chrono::milliseconds progress_interval = std::chrono::milliseconds(100));
+    SolveHandle(
+        Schedule previous,
+        ScheduleChange change,
+        EngineConfig config,
+        SolveMonitor::ProgressCallback on_progress = {},
+        std::chrono::milliseconds progress_interval = std::chrono::milliseconds(100));
+    ~SolveHandle();
+
+    SolveHandle(const SolveHandle&) = delete;
+    SolveHandle& operator=(const SolveHandle&) = delete;
+
+    void cancel();
+    bool done() const;
+    // Waits up to timeout and returns whether the solve has finished.
+    bool wait_for(std::chrono::milliseconds timeout) const;
+    Schedule best_schedule() const;
+    SolveProgress progress() const;
+    SolveResult result();
+
+private:
+    void start(std::function<SolveResult()> run);
+
+    SolveMonitor monitor;
+    mutable std::mutex mutex;
+    mutable std::condition_variable finished_condition;
+    bool finished = false;
+    SolveResult solve_result;
+    std::exception_ptr error;
+    std::thread worker;
+};
+
+#endif // ELASTISCHED_SOLVE_HANDLE_HPP
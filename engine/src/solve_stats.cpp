@@ -0,0 +1,21 @@
+#include "solve_stats.hpp"
+
+void SolveStats::merge(const SolveStats& other) {
+    compile_seconds += other.compile_seconds;
+    feasibility_seconds += other.feasibility_seconds;
+    partition_seconds += other.partition_seconds;
+    greedy_seconds += other.greedy_seconds;
+    anneal_seconds += other.anneal_seconds;
+    move_generation_seconds += other.move_generation_seconds;
+    cost_evaluation_seconds += other.cost_evaluation_seconds;
+    write_back_seconds += other.write_back_seconds;
+
+    cost_evaluations += other.cost_evaluations;
+    accepted_moves += other.accepted_moves;
+    rejected_moves += other.rejected_moves;
+    improving_moves += other.improving_moves;
+    split_attempts += other.split_attempts;
+    merge_attempts += other.merge_attempts;
+    split_placement_failures += other.split_placement_failures;
+    window_sampling_failures += other.window_sampling_failures;
+}
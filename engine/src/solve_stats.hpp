@@ -0,0 +1,95 @@
+#ifndef ELASTISCHED_SOLVE_STATS_HPP
+#define ELASTISCHED_SOLVE_STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+
+// Set to 0 to compile every counter and timer out of the solver.
+#ifndef ELASTISCHED_SOLVE_STATS
+#define ELASTISCHED_SOLVE_STATS 1
+#endif
+
+#if ELASTISCHED_SOLVE_STATS
+#define ELASTISCHED_STAT(statement) statement
+#else
+#define ELASTISCHED_STAT(statement) ((void)0)
+#endif
+
+/**
+ * SolveStats
+ *
+ * Where a solve spent its time and what its annealers did. Phase times
+ * are wall-clock seconds summed over components, so with several workers
+ * they can add up to more than the solve took:
+ *  - compile: building the ProblemTable from the jobs;
+ *  - feasibility: looking for conflicts before annealing;
+ *  - partition: splitting the problem into components and extracting each;
+ *  - greedy: building greedy starting placements;
+ *  - anneal: the annealing loops, calibration included;
+ *  - write_back: copying the best placement back onto the jobs.
+ * Within anneal, move generation and cost evaluation are timed on one
+ * move in STATS_TIMING_PERIOD and scaled up, so they are estimates.
+ *
+ * Counters cover every annealing move: cost_evaluations counts incremental
+ * re-scorings, two for a SWAP. Split and merge attempts are the resamples
+ * that try to split a job or to join a split one back up;
+ * split_placement_failures are split attempts that found no layout and
+ * fell back to a single segment, and window_sampling_failures are moves
+ * that found no start on the grid inside the window and were dropped.
+ *
+ * Only collected when the engine is built with ELASTISCHED_SOLVE_STATS;
+ * otherwise every field stays zero.
+ */
+struct SolveStats {
+    double compile_seconds = 0.0;
+    double feasibility_seconds = 0.0;
+    double partition_seconds = 0.0;
+    double greedy_seconds = 0.0;
+    double anneal_seconds = 0.0;
+    double move_generation_seconds = 0.0;
+    double cost_evaluation_seconds = 0.0;
+    double write_back_seconds = 0.0;
+
+    uint64_t cost_evaluations = 0;
+    uint64_t accepted_moves = 0;
+    uint64_t rejected_moves = 0;
+    uint64_t improving_moves = 0;
+    uint64_t split_attempts = 0;
+    uint64_t merge_attempts = 0;
+    uint64_t split_placement_failures = 0;
+    uint64_t window_sampling_failures = 0;
+
+    void merge(const SolveStats& other);
+};
+
+constexpr uint64_t STATS_TIMING_PERIOD = 64;
+
+/**
+ * PhaseTimer
+ *
+ * Adds the lifetime of the timer to a SolveStats phase. Empty when stats
+ * are compiled out.
+ */
+class PhaseTimer {
+public:
+#if ELASTISCHED_SOLVE_STATS
+    explicit PhaseTimer(double& seconds) : seconds(seconds), start(std::chrono::steady_clock::now()) {}
+
+    ~PhaseTimer() {
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+#else
+    explicit PhaseTimer(double&) {}
+#endif
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+#if ELASTISCHED_SOLVE_STATS
+private:
+    double& seconds;
+    std::chrono::steady_clock::time_point start;
+#endif
+};
+
+#endif // ELASTISCHED_SOLVE_STATS_HPP
@@ -8,12 +8,35 @@
 #include "tag.hpp"
 #include "constants.hpp"
 #include "engine.hpp"
+#include "calendar_index.hpp"
+#include "cost_history.hpp"
+#include "incremental_cost.hpp"
+#include "optimizer.hpp"
+#include "solve_handle.hpp"
+#include "greedy_placement.hpp"
+#include "move_library.hpp"
+#include "problem_json.hpp"
+#include "rng.hpp"
+#include "snapshot.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <filesystem>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+namespace {
+bool costs_match(double lhs, double rhs) {
+    return std::abs(lhs - rhs) <= 1e-6 * std::max(1.0, std::abs(rhs));
+}
+} // namespace
+
 TEST_CASE("Interval basics") {
     Interval<int> a(1, 5);
     Interval<int> b(3, 7);
@@ -80,6 +103,36 @@ TEST_CASE("IntervalTree copy and is_in") {
     CHECK(missing == nullptr);
 }
 
+TEST_CASE("IntervalTree stays balanced on sorted input") {
+    IntervalTree<int, int> tree;
+    std::vector<Interval<int>> inserted;
+    for (int i = 0; i < 1024; ++i) {
+        inserted.emplace_back(i * 3, i * 3 + 5);
+        tree.insert(inserted.back(), i);
+    }
+    tree.insert(Interval<int>(40, 40), -1);
+    inserted.emplace_back(40, 40);
+    CHECK(tree.depth() <= 15);
+
+    for (int low : {0, 40, 41, 1500, 4000}) {
+        Interval<int> key(low, low + 7);
+        size_t expected = 0;
+        for (const auto& interval : inserted) {
+            if (interval.overlaps(key)) {
+                ++expected;
+            }
+        }
+        size_t visited = 0;
+        tree.visit_overlapping(key, [&](const Interval<int>& interval, int) {
+            CHECK(interval.overlaps(key));
+            ++visited;
+        });
+        CHECK_EQ(visited, expected);
+        CHECK_EQ(tree.find_overlapping(key).size(), expected);
+        CHECK_EQ(tree.search_overlap(key) != nullptr, expected > 0);
+    }
+}
+
 TEST_CASE("Policy flags and accessors") {
     Policy policy(3, 10, true, true, true, true);
     CHECK(policy.is_splittable());
@@ -222,6 +275,25 @@ TEST_CASE("Dependency cycle detection") {
     auto result = check_dependency_violations(schedule);
     CHECK(result.has_cyclic_dependencies);
     CHECK(result.has_violations);
+    CHECK(!result.has_duplicate_ids);
+
+    Job self(10, schedulable, TimeRange(50, 60), "S", policy, {"S"}, {});
+    CHECK(check_dependency_violations(Schedule({self})).has_cyclic_dependencies);
+}
+
+TEST_CASE("Dependency check reports duplicate ids apart from cycles") {
+    Policy policy;
+    TimeRange schedulable(0, 100);
+
+    Job a(10, schedulable, TimeRange(10, 20), "A", policy, {}, {});
+    Job b(10, schedulable, TimeRange(30, 40), "B", policy, {"A"}, {});
+    Job again(10, schedulable, TimeRange(50, 60), "A", policy, {}, {});
+
+    auto result = check_dependency_violations(Schedule({a, b, again}));
+    CHECK(result.has_duplicate_ids);
+    CHECK(result.duplicate_ids == std::set<ID>{"A"});
+    CHECK(result.has_violations);
+    CHECK(!result.has_cyclic_dependencies);
 }
 
 TEST_CASE("ScheduleCostFunction illegal schedule out of bounds") {
@@ -291,6 +363,689 @@ TEST_CASE("ScheduleCostFunction split cost zero for unsplit jobs") {
     CHECK_EQ(cost.split_cost(), 0.0);
 }
 
+TEST_CASE("compile_problem lowers jobs into flat arrays") {
+    Policy splittable(2, 5, true, true, false, true);
+    Policy policy;
+    TimeRange schedulable(0, 100);
+    Job a(10, schedulable, TimeRange(10, 20), "A", policy, {}, {});
+    Job b(20, schedulable, TimeRange(40, 60), "B", splittable, {"A", "MISSING"}, {});
+    b.set_scheduled_time_ranges({TimeRange(40, 50), TimeRange(70, 80)});
+    Job c(10, TimeRange(30, 40), TimeRange(30, 40), "C", policy, {"B"}, {});
+
+    ProblemTable problem = compile_problem({a, b, c}, 5);
+    REQUIRE_EQ(problem.size(), static_cast<size_t>(3));
+    CHECK_EQ(problem.granularity, static_cast<sec_t>(5));
+    CHECK_EQ(problem.duration[1], static_cast<sec_t>(20));
+    CHECK(problem.is_splittable(1));
+    CHECK(problem.is_overlappable(1));
+    CHECK(problem.rounds_to_granularity(1));
+    CHECK(!problem.is_overlappable(0));
+    CHECK(problem.rigid[2]);
+    CHECK(!problem.rigid[0]);
+    CHECK_EQ(problem.segment_capacity(1), static_cast<uint32_t>(3));
+    CHECK_EQ(problem.segment_capacity(0), static_cast<uint32_t>(1));
+
+    // B depends on A (MISSING is dropped), C depends on B.
+    CHECK_EQ(problem.predecessor_offsets[2] - problem.predecessor_offsets[1], static_cast<uint32_t>(1));
+    CHECK_EQ(problem.predecessor_indices[problem.predecessor_offsets[1]], static_cast<job_index_t>(0));
+    CHECK_EQ(problem.successor_offsets[2] - problem.successor_offsets[1], static_cast<uint32_t>(1));
+    CHECK_EQ(problem.successor_indices[problem.successor_offsets[1]], static_cast<job_index_t>(2));
+    CHECK(!problem.has_cyclic_dependencies);
+
+    Placement placement(problem);
+    CHECK_EQ(placement.count(1), static_cast<uint32_t>(2));
+    CHECK_EQ(placement.earliest_start[1], static_cast<sec_t>(40));
+    CHECK_EQ(placement.latest_end[1], static_cast<sec_t>(80));
+
+    std::vector<Job> jobs = {a, b, c};
+    TimeRange moved[] = {TimeRange(0, 20)};
+    placement.assign(1, moved, 1);
+    write_back(placement, jobs);
+    CHECK_EQ(jobs[1].scheduled_time_ranges.size(), static_cast<size_t>(1));
+    CHECK(jobs[1].scheduled_time_range == TimeRange(0, 20));
+}
+
+TEST_CASE("IncrementalScheduleCost matches full cost after moves") {
+    Policy hard;
+    Policy splittable(2, 5, true, true, false, false);
+    TimeRange schedulable(0, 100);
+
+    Job a(10, schedulable, TimeRange(10, 20), "A", hard, {}, {});
+    Job b(10, schedulable, TimeRange(40, 50), "B", hard, {"A"}, {});
+    Job c(20, schedulable, TimeRange(15, 35), "C", splittable, {}, {});
+    Job d(20, TimeRange(200, 300), TimeRange(200, 220), "D", splittable, {}, {});
+    std::vector<Job> jobs = {a, b, c, d};
+    ProblemTable problem = compile_problem(jobs, 5);
+    Placement placement(problem);
+    IncrementalScheduleCost incremental(problem, placement);
+
+    CHECK(costs_match(incremental.cost(), ScheduleCostFunction(Schedule(jobs), 5).schedule_cost()));
+
+    std::vector<ScheduleMove> moves = {
+        {1, {TimeRange(5, 15)}},                       // dependency and hard overlap
+        {1, {TimeRange(60, 70)}},                      // legal again
+        {2, {TimeRange(0, 10), TimeRange(12, 22)}},    // split, overlaps A
+        {3, {TimeRange(200, 210), TimeRange(205, 215)}}, // self overlap
+        {0, {TimeRange(95, 105)}},                     // outside schedulable range
+        {0, {TimeRange(20, 30)}},
+    };
+    for (const auto& move : moves) {
+        double predicted = incremental.apply(move);
+        incremental.accept();
+        CHECK(costs_match(predicted, incremental.cost()));
+        write_back(placement, jobs);
+        CHECK(costs_match(incremental.cost(), ScheduleCostFunction(Schedule(jobs), 5).schedule_cost()));
+    }
+}
+
+TEST_CASE("IncrementalScheduleCost prices an overlappable job against hard jobs") {
+    Policy hard;
+    Policy overlappable(0, 0, false, true, false, false);
+    TimeRange schedulable(0, 100);
+
+    Job a(10, schedulable, TimeRange(10, 20), "A", hard, {}, {});
+    Job b(10, schedulable, TimeRange(40, 50), "B", hard, {"A"}, {});
+    Job c(20, schedulable, TimeRange(15, 35), "C", overlappable, {}, {});
+    std::vector<Job> jobs = {a, b, c};
+    ProblemTable problem = compile_problem(jobs, 5);
+    Placement placement(problem);
+    IncrementalScheduleCost incremental(problem, placement);
+
+    CHECK(costs_match(incremental.cost(), ScheduleCostFunction(Schedule(jobs), 5).schedule_cost()));
+
+    std::vector<ScheduleMove> moves = {
+        {2, {TimeRange(0, 20)}},    // covers A
+        {2, {TimeRange(35, 55)}},   // covers B
+        {0, {TimeRange(40, 50)}},   // A on B under C
+        {2, {TimeRange(60, 80)}},   // clear of both
+        {0, {TimeRange(20, 30)}},
+    };
+    for (const auto& move : moves) {
+        double predicted = incremental.apply(move);
+        incremental.accept();
+        CHECK(costs_match(predicted, incremental.cost()));
+        write_back(placement, jobs);
+        CHECK(costs_match(incremental.cost(), ScheduleCostFunction(Schedule(jobs), 5).schedule_cost()));
+    }
+}
+
+TEST_CASE("Placement rejects more segments than a job can hold") {
+    Policy hard;
+    Policy splittable(2, 5, true, false, false, false);
+    Job a(10, TimeRange(0, 100), TimeRange(10, 20), "A", hard, {}, {});
+    Job b(20, TimeRange(0, 100), TimeRange(40, 60), "B", splittable, {}, {});
+    ProblemTable problem = compile_problem({a, b}, 5);
+    Placement placement(problem);
+
+    const std::vector<TimeRange> ranges = {
+        TimeRange(0, 5), TimeRange(10, 15), TimeRange(20, 25), TimeRange(30, 35), TimeRange(40, 45)};
+    for (job_index_t job = 0; job < 2; ++job) {
+        const uint32_t capacity = problem.segment_capacity(job);
+        REQUIRE(capacity + 1 <= ranges.size());
+        placement.assign(job, ranges.data(), capacity);
+        CHECK_EQ(placement.count(job), capacity);
+        CHECK_THROWS_AS(placement.assign(job, ranges.data(), capacity + 1), std::invalid_argument);
+    }
+    // The rejected writes left the neighbouring block alone.
+    CHECK(*placement.begin(1) == TimeRange(0, 5));
+    CHECK_EQ(placement.count(0), problem.segment_capacity(0));
+}
+
+TEST_CASE("IncrementalScheduleCost undo restores placement and cost") {
+    Policy hard;
+    TimeRange schedulable(0, 100);
+    Job a(10, schedulable, TimeRange(10, 20), "A", hard, {}, {});
+    Job b(10, schedulable, TimeRange(40, 50), "B", hard, {"A"}, {});
+    ProblemTable problem = compile_problem({a, b}, 1);
+    Placement placement(problem);
+    IncrementalScheduleCost incremental(problem, placement);
+    const double initial_cost = incremental.cost();
+
+    incremental.apply({1, {TimeRange(15, 25)}});
+    incremental.apply({0, {TimeRange(60, 70)}});
+    CHECK(incremental.cost() >= constants::ILLEGAL_SCHEDULE_COST);
+
+    incremental.undo();
+    incremental.undo();
+    CHECK(costs_match(incremental.cost(), initial_cost));
+    CHECK(*placement.begin(0) == TimeRange(10, 20));
+    CHECK(*placement.begin(1) == TimeRange(40, 50));
+    CHECK_EQ(placement.earliest_start[1], static_cast<sec_t>(40));
+}
+
+TEST_CASE("IncrementalScheduleCost keeps cyclic dependencies illegal") {
+    Policy policy;
+    TimeRange schedulable(0, 100);
+    Job a(10, schedulable, TimeRange(10, 20), "A", policy, {"B"}, {});
+    Job b(10, schedulable, TimeRange(30, 40), "B", policy, {"A"}, {});
+    ProblemTable problem = compile_problem({a, b}, 1);
+    Placement placement(problem);
+    IncrementalScheduleCost incremental(problem, placement);
+
+    CHECK(problem.has_cyclic_dependencies);
+    CHECK(incremental.cost() >= constants::ILLEGAL_SCHEDULE_COST);
+    CHECK(incremental.apply({0, {TimeRange(50, 60)}}) >= constants::ILLEGAL_SCHEDULE_COST);
+}
+
+TEST_CASE("IncrementalScheduleCost slot backend matches the calendar backend") {
+    Policy hard;
+    Policy soft(0, 0, false, true, false, false);
+    Policy splittable(2, 10, true, true, false, true);
+    TimeRange schedulable(0, 200);
+    std::vector<Job> jobs = {
+        Job(20, schedulable, TimeRange(0, 20), "A", hard, {}, {}),
+        Job(30, schedulable, TimeRange(10, 40), "B", hard, {"A"}, {}),
+        Job(40, schedulable, TimeRange(20, 60), "C", soft, {}, {}),
+        Job(40, schedulable, TimeRange(50, 90), "D", splittable, {}, {}),
+        Job(20, TimeRange(100, 120), TimeRange(100, 120), "R", hard, {}, {}),
+    };
+    ProblemTable problem = compile_problem(jobs, 10);
+    Placement slot_placement(problem);
+    Placement calendar_placement(problem);
+    CHECK(SlotOccupancy::supports(problem, slot_placement));
+    IncrementalScheduleCost slots(problem, slot_placement, OverlapBackend::SLOTS);
+    IncrementalScheduleCost calendar(problem, calendar_placement, OverlapBackend::CALENDAR);
+    CHECK(costs_match(slots.cost(), calendar.cost()));
+
+    std::vector<ScheduleMove> moves = {
+        {0, {TimeRange(100, 120)}},                  // onto the rigid job
+        {3, {TimeRange(0, 20), TimeRange(10, 30)}},  // self overlap
+        {2, {TimeRange(0, 40)}},
+        {1, {TimeRange(150, 180)}},
+        {3, {TimeRange(40, 60), TimeRange(120, 140)}},
+    };
+    for (const auto& move : moves) {
+        CHECK(costs_match(slots.apply(move), calendar.apply(move)));
+    }
+    for (size_t k = 0; k < moves.size(); ++k) {
+        slots.undo();
+        calendar.undo();
+        CHECK(costs_match(slots.cost(), calendar.cost()));
+    }
+    CHECK_THROWS_AS(slots.apply({0, {TimeRange(5, 25)}}), std::invalid_argument);
+
+    // Both AVX2 kernels handle lengths that are not a multiple of the vector width.
+    std::vector<uint16_t> counts(1000);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        counts[i] = static_cast<uint16_t>((i * 7) % 5);
+    }
+    for (size_t size : {0, 7, 16, 999, 1000}) {
+        uint64_t sum = 0;
+        size_t ones = 0;
+        for (size_t i = 0; i < size; ++i) {
+            sum += counts[i];
+            ones += counts[i] == 1 ? 1 : 0;
+        }
+        CHECK_EQ(slot_count_sum(counts.data(), size), sum);
+        CHECK_EQ(slot_count_equal(counts.data(), size, 1), ones);
+    }
+}
+
+TEST_CASE("compile_problem reports dependency cycles and duplicate ids") {
+    Policy policy;
+    TimeRange schedulable(0, 100);
+    Job a(10, schedulable, TimeRange(0, 10), "A", policy, {"C"}, {});
+    Job b(10, schedulable, TimeRange(10, 20), "B", policy, {"A"}, {});
+    Job c(10, schedulable, TimeRange(20, 30), "C", policy, {"B"}, {});
+    Job d(10, schedulable, TimeRange(30, 40), "D", policy, {"C"}, {});
+
+    ProblemTable problem = compile_problem({d, a, b, c}, 1);
+    CHECK(problem.has_cyclic_dependencies);
+    REQUIRE_EQ(problem.dependency_cycle.size(), static_cast<size_t>(3));
+    // Each job of the cycle depends on the one before it.
+    for (size_t k = 0; k < 3; ++k) {
+        const job_index_t job = problem.dependency_cycle[k];
+        const job_index_t previous = problem.dependency_cycle[(k + 2) % 3];
+        CHECK_EQ(problem.predecessor_indices[problem.predecessor_offsets[job]], previous);
+    }
+    CHECK_THROWS_AS(solve({d, a, b, c}, EngineConfig{}), std::invalid_argument);
+
+    Job self(10, schedulable, TimeRange(0, 10), "S", policy, {"S"}, {});
+    ProblemTable self_problem = compile_problem({self}, 1);
+    CHECK(self_problem.has_cyclic_dependencies);
+    CHECK_EQ(self_problem.dependency_cycle.size(), static_cast<size_t>(1));
+
+    CHECK(!compile_problem({b, d}, 1).has_cyclic_dependencies);
+    CHECK_THROWS_AS(compile_problem({a, a}, 1), std::invalid_argument);
+}
+
+TEST_CASE("solve_batch matches solve on the same jobs") {
+    Policy hard;
+    std::vector<Job> jobs;
+    std::vector<sec_t> duration, window_low, window_high, scheduled_low, scheduled_high;
+    std::vector<uint32_t> dependency_offsets = {0};
+    std::vector<job_index_t> dependency_indices;
+    for (sec_t day = 0; day < 3; ++day) {
+        sec_t low = day * constants::DAY;
+        TimeRange window(low, low + 100);
+        std::string prefix = "d" + std::to_string(day);
+        jobs.emplace_back(10, window, TimeRange(low, low + 10), prefix + "a", hard, std::set<ID>{}, std::set<Tag>{});
+        jobs.emplace_back(10, window, TimeRange(low + 5, low + 15), prefix + "b", hard, std::set<ID>{prefix + "a"}, std::set<Tag>{});
+        dependency_offsets.push_back(static_cast<uint32_t>(dependency_indices.size()));
+        dependency_indices.push_back(static_cast<job_index_t>(2 * day));
+        dependency_offsets.push_back(static_cast<uint32_t>(dependency_indices.size()));
+    }
+    // A rigid job starts away from its window and is pinned onto it.
+    jobs.emplace_back(10, TimeRange(50, 60), TimeRange(0, 10), "rigid", hard, std::set<ID>{}, std::set<Tag>{});
+    dependency_offsets.push_back(static_cast<uint32_t>(dependency_indices.size()));
+    for (const Job& job : jobs) {
+        duration.push_back(job.duration);
+        window_low.push_back(job.schedulable_time_range.get_low());
+        window_high.push_back(job.schedulable_time_range.get_high());
+        scheduled_low.push_back(job.scheduled_time_range.get_low());
+        scheduled_high.push_back(job.scheduled_time_range.get_high());
+    }
+
+    JobBatch batch;
+    batch.size = jobs.size();
+    batch.duration = duration.data();
+    batch.window_low = window_low.data();
+    batch.window_high = window_high.data();
+    batch.scheduled_low = scheduled_low.data();
+    batch.scheduled_high = scheduled_high.data();
+    batch.dependency_offsets = dependency_offsets.data();
+    batch.dependency_indices = dependency_indices.data();
+
+    ProblemTable from_batch = compile_batch(batch, 5);
+    ProblemTable from_jobs = compile_problem(jobs, 5);
+    CHECK(from_batch.predecessor_indices == from_jobs.predecessor_indices);
+    CHECK(from_batch.successor_offsets == from_jobs.successor_offsets);
+    CHECK(from_batch.rigid == from_jobs.rigid);
+    CHECK(from_batch.segments[6] == TimeRange(50, 60));
+
+    EngineConfig config;
+    config.granularity = 5;
+    config.num_iters = 1000;
+    config.cost_history = CostHistoryPolicy{CostHistoryMode::FULL};
+    SolveResult solved = solve(jobs, config);
+    BatchSolveResult batch_solved = solve_batch(batch, config);
+
+    REQUIRE_EQ(batch_solved.segment_offsets.size(), jobs.size() + 1);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const std::vector<TimeRange>& ranges = solved.schedule.scheduled_jobs[i].scheduled_time_ranges;
+        REQUIRE_EQ(batch_solved.segment_offsets[i + 1] - batch_solved.segment_offsets[i], ranges.size());
+        for (size_t k = 0; k < ranges.size(); ++k) {
+            const uint32_t slot = batch_solved.segment_offsets[i] + static_cast<uint32_t>(k);
+            CHECK(TimeRange(batch_solved.segment_low[slot], batch_solved.segment_high[slot]) == ranges[k]);
+        }
+    }
+    CHECK(batch_solved.cost_history.values == solved.cost_history.values);
+
+    // Malformed batches are rejected instead of read out of bounds.
+    dependency_indices[0] = static_cast<job_index_t>(jobs.size());
+    CHECK_THROWS_AS(compile_batch(batch, 5), std::invalid_argument);
+    dependency_indices[0] = 0;
+    window_low[0] = window_high[0] + 5;
+    CHECK_THROWS_AS(compile_batch(batch, 5), std::invalid_argument);
+    window_low[0] = 0;
+
+    // A window shorter than the duration is a conflict, as it is in solve.
+    window_high[0] = window_low[0] + 5;
+    const BatchSolveResult too_short = solve_batch(batch, config);
+    REQUIRE_EQ(too_short.feasibility.conflicts.size(), static_cast<size_t>(1));
+    CHECK(too_short.feasibility.conflicts[0].kind == ConflictKind::WINDOW_TOO_SHORT);
+    CHECK(too_short.feasibility.conflicts[0].job_ids == std::vector<ID>{"0"});
+    window_high[0] = window_low[0] + 100;
+    dependency_indices[0] = 1;
+    CHECK_THROWS_AS(solve_batch(batch, config), std::invalid_argument);
+}
+
+TEST_CASE("check_feasibility reports conflicts instead of annealing") {
+    Policy hard;
+    Policy soft(0, 0, false, true, false, false);
+    // R1 and R2 collide, O is overlappable, W cannot fit its window on a
+    // 5s grid and A -> B -> C cannot fit between A's start and C's end.
+    Job r1(20, TimeRange(0, 20), TimeRange(0, 20), "R1", hard, {}, {});
+    Job r2(20, TimeRange(10, 30), TimeRange(10, 30), "R2", hard, {}, {});
+    Job o(20, TimeRange(5, 25), TimeRange(5, 25), "O", soft, {}, {});
+    Job w(10, TimeRange(101, 112), TimeRange(101, 111), "W", hard, {}, {});
+    Job a(30, TimeRange(200, 260), TimeRange(200, 230), "A", hard, {}, {});
+    Job b(30, TimeRange(200, 300), TimeRange(230, 260), "B", hard, {"A"}, {});
+    Job c(30, TimeRange(200, 300), TimeRange(260, 290), "C", hard, {"B"}, {});
+    Job d(20, TimeRange(200, 300), TimeRange(280, 300), "D", hard, {"C"}, {});
+
+    FeasibilityReport report = check_feasibility({r1, r2, o, w, a, b, c, d}, 5);
+    REQUIRE_EQ(report.conflicts.size(), static_cast<size_t>(3));
+    CHECK(report.conflicts[0].kind == ConflictKind::WINDOW_TOO_SHORT);
+    CHECK(report.conflicts[0].job_ids == std::vector<ID>{"W"});
+    CHECK(report.conflicts[1].kind == ConflictKind::RIGID_OVERLAP);
+    CHECK(report.conflicts[1].job_ids == std::vector<ID>({"R1", "R2"}));
+    CHECK(report.conflicts[2].kind == ConflictKind::DEPENDENCY_WINDOW);
+    CHECK(report.conflicts[2].job_ids == std::vector<ID>({"A", "B", "C", "D"}));
+    CHECK_EQ(report.conflicts[2].message, std::string("dependency chain A -> B -> C -> D does not fit in its windows"));
+    CHECK(check_feasibility({r1, o, a, b, c}, 5).feasible());
+
+    // solve returns the jobs unannealed along with the report.
+    EngineConfig config;
+    config.granularity = 5;
+    config.cost_history = CostHistoryPolicy{CostHistoryMode::FULL};
+    SolveResult result = solve({r1, r2, a}, config);
+    CHECK(!result.feasibility.feasible());
+    CHECK_EQ(result.cost_history.size(), static_cast<size_t>(1));
+    CHECK(result.schedule.scheduled_jobs[2].scheduled_time_range == TimeRange(200, 230));
+}
+
+TEST_CASE("check_feasibility and solve agree on a granularity of 0") {
+    Policy hard;
+    Policy splittable(2, 3, true, false, false, false);
+    // Off-grid durations and windows, all starting on top of each other.
+    Job a(7, TimeRange(1, 40), TimeRange(1, 8), "A", hard, {}, {});
+    Job b(13, TimeRange(1, 40), TimeRange(1, 14), "B", hard, {}, {});
+    Job s(11, TimeRange(3, 40), TimeRange(3, 14), "S", splittable, {}, {});
+    std::vector<Job> jobs = {a, b, s};
+    REQUIRE(check_feasibility(jobs, 0).feasible());
+
+    EngineConfig config = default_engine_config(0);
+    config.greedy_start = false;
+    config.num_iters = 2000;
+    SolveResult result = solve(jobs, config);
+    CHECK(result.feasibility.feasible());
+    for (const Job& job : result.schedule.scheduled_jobs) {
+        for (const TimeRange& range : job.scheduled_time_ranges) {
+            CHECK(job.schedulable_time_range.contains(range));
+        }
+    }
+    CHECK(ScheduleCostFunction(result.schedule, 0).schedule_cost() < constants::ILLEGAL_SCHEDULE_COST);
+}
+
+TEST_CASE("greedy_placement packs jobs around rigid ones in dependency order") {
+    Policy hard;
+    Policy splittable(2, 10, true, false, false, false);
+    TimeRange window(0, 100);
+    // Everything starts on top of the rigid block. A has the tightest
+    // window, B must follow A and S only fits around R if it is split.
+    Job rigid(20, TimeRange(40, 60), TimeRange(40, 60), "R", hard, {}, {});
+    Job b(10, window, TimeRange(40, 50), "B", hard, {"A"}, {});
+    Job a(10, TimeRange(0, 40), TimeRange(40, 50), "A", hard, {}, {});
+    Job s(50, window, TimeRange(40, 90), "S", splittable, {}, {});
+
+    ProblemTable problem = compile_problem({rigid, b, a, s}, 5);
+    Placement placement = greedy_placement(problem);
+    CHECK(*placement.begin(0) == TimeRange(40, 60));
+    CHECK(*placement.begin(2) == TimeRange(0, 10));
+    REQUIRE_EQ(placement.count(3), static_cast<uint32_t>(2));
+    CHECK(placement.begin(3)[0] == TimeRange(10, 40));
+    CHECK(placement.begin(3)[1] == TimeRange(60, 80));
+    CHECK(*placement.begin(1) == TimeRange(80, 90));
+    CHECK(IncrementalScheduleCost(problem, placement).cost() < constants::ILLEGAL_SCHEDULE_COST);
+
+    // Solving with greedy_start never starts illegal on a feasible problem.
+    std::vector<Job> jobs;
+    for (int k = 0; k < 9; ++k) {
+        jobs.emplace_back(10, window, TimeRange(0, 10), "J" + std::to_string(k), hard, std::set<ID>{}, std::set<Tag>{});
+    }
+    // Too few iterations for a cold start to line all nine jobs up.
+    EngineConfig config;
+    config.granularity = 5;
+    config.num_iters = 20;
+    config.cost_history = CostHistoryPolicy{CostHistoryMode::FULL};
+    config.greedy_start = true;
+    SolveResult result = solve(jobs, config);
+    CHECK(ScheduleCostFunction(result.schedule, 5).schedule_cost() < constants::ILLEGAL_SCHEDULE_COST);
+    config.greedy_start = false;
+    SolveResult cold = solve(jobs, config);
+    CHECK(ScheduleCostFunction(cold.schedule, 5).schedule_cost() >= constants::ILLEGAL_SCHEDULE_COST);
+}
+
+TEST_CASE("MoveLibrary keeps the cost model in sync and reports every operator") {
+    Policy hard;
+    Policy splittable(2, 10, true, false, false, true);
+    TimeRange schedulable(0, 400);
+    std::vector<Job> jobs = {
+        Job(20, schedulable, TimeRange(0, 20), "A", hard, {}, {}),
+        Job(30, schedulable, TimeRange(10, 40), "B", hard, {"A"}, {}),
+        Job(40, schedulable, TimeRange(20, 60), "C", splittable, {}, {}),
+        Job(20, schedulable, TimeRange(30, 50), "D", hard, {}, {}),
+        Job(20, TimeRange(100, 120), TimeRange(100, 120), "R", hard, {}, {}),
+    };
+    ProblemTable problem = compile_problem(jobs, 10);
+    const std::vector<job_index_t> flexible = {0, 1, 2, 3};
+
+    Placement placement(problem);
+    IncrementalScheduleCost cost_model(problem, placement);
+    MoveLibrary moves(problem, flexible, placement, cost_model, true);
+    Rng gen(7);
+    for (int step = 0; step < 4000; ++step) {
+        const double before = cost_model.cost();
+        const double after = moves.apply(gen);
+        if (step % 3 == 0) {
+            moves.undo();
+            CHECK(costs_match(cost_model.cost(), before));
+        } else {
+            moves.accept();
+            CHECK(costs_match(cost_model.cost(), after));
+        }
+    }
+    Placement fresh = placement;
+    CHECK(costs_match(cost_model.cost(), IncrementalScheduleCost(problem, fresh).cost()));
+
+    const std::vector<MoveStats> stats = moves.stats();
+    CHECK_EQ(stats.size(), MOVE_KIND_COUNT);
+    uint64_t proposed = 0;
+    double share = 0.0;
+    for (const MoveStats& kind : stats) {
+        CHECK(kind.proposed > 0);
+        CHECK(kind.accepted <= kind.proposed);
+        CHECK(kind.improved <= kind.accepted);
+        proposed += kind.proposed;
+        share += kind.share;
+    }
+    CHECK_EQ(proposed, static_cast<uint64_t>(4000));
+    CHECK(std::abs(share - 1.0) < 1e-9);
+
+    // Without adaptive weights every move re-places a random job.
+    Placement uniform_placement(problem);
+    IncrementalScheduleCost uniform_cost(problem, uniform_placement);
+    MoveLibrary uniform(problem, flexible, uniform_placement, uniform_cost, false);
+    for (int step = 0; step < 100; ++step) {
+        uniform.apply(gen);
+        uniform.accept();
+    }
+    CHECK_EQ(uniform.stats()[0].proposed, static_cast<uint64_t>(100));
+    CHECK(costs_match(uniform.stats()[0].share, 1.0));
+
+    EngineConfig config;
+    config.granularity = 10;
+    config.num_iters = 200;
+    config.adaptive_moves = true;
+    const SolveResult result = solve(jobs, config);
+    CHECK_EQ(result.move_stats.size(), MOVE_KIND_COUNT);
+    CHECK(result.move_stats[0].proposed > 0);
+}
+
+TEST_CASE("SolveStats account for every annealing move") {
+    Policy hard;
+    Policy splittable(2, 10, true, false, false, true);
+    // More work than the window holds, so no run stops at the lower bound.
+    TimeRange schedulable(0, 100);
+    std::vector<Job> jobs = {
+        Job(20, schedulable, TimeRange(0, 20), "A", hard, {}, {}),
+        Job(30, schedulable, TimeRange(10, 40), "B", hard, {"A"}, {}),
+        Job(40, schedulable, TimeRange(20, 60), "C", splittable, {}, {}),
+        Job(20, schedulable, TimeRange(30, 50), "D", hard, {}, {}),
+    };
+
+    SolveStats stats;
+    schedule_jobs(jobs, 10, 10.0, 1e-4, 2000, &stats);
+
+    EngineConfig config;
+    config.granularity = 10;
+    config.num_iters = 2000;
+    config.adaptive_moves = true;
+    const SolveResult result = solve(jobs, config);
+
+    uint64_t proposed = 0;
+    uint64_t accepted = 0;
+    uint64_t improved = 0;
+    for (const MoveStats& kind : result.move_stats) {
+        proposed += kind.proposed;
+        accepted += kind.accepted;
+        improved += kind.improved;
+    }
+#if ELASTISCHED_SOLVE_STATS
+    CHECK(stats.accepted_moves + stats.rejected_moves > 0);
+    CHECK_EQ(result.stats.accepted_moves + result.stats.rejected_moves, proposed);
+    CHECK_EQ(result.stats.accepted_moves, accepted);
+    CHECK_EQ(result.stats.improving_moves, improved);
+    CHECK(result.stats.cost_evaluations >= proposed);
+    CHECK(result.stats.split_attempts > 0);
+    CHECK(result.stats.split_placement_failures <= result.stats.split_attempts);
+    CHECK_EQ(result.stats.window_sampling_failures, static_cast<uint64_t>(0));
+    CHECK(result.stats.anneal_seconds > 0.0);
+    CHECK(result.stats.move_generation_seconds + result.stats.cost_evaluation_seconds > 0.0);
+
+    // Calibration probes are not moves of the run: with one chain on one
+    // component, every recorded iteration is exactly one accept or reject.
+    config.calibration_samples = 64;
+    config.cost_history = CostHistoryPolicy{CostHistoryMode::FULL};
+    const SolveResult calibrated = solve(jobs, config);
+    const uint64_t iterations = calibrated.cost_history.size() - 1;
+    uint64_t calibrated_proposed = 0;
+    for (const MoveStats& kind : calibrated.move_stats) {
+        calibrated_proposed += kind.proposed;
+    }
+    CHECK_EQ(calibrated.stats.accepted_moves + calibrated.stats.rejected_moves, iterations);
+    CHECK_EQ(calibrated_proposed, iterations);
+#else
+    CHECK_EQ(result.stats.cost_evaluations, static_cast<uint64_t>(0));
+    CHECK_EQ(result.stats.anneal_seconds, 0.0);
+#endif
+}
+
+TEST_CASE("split moves lay segments out in the free gaps of tight windows") {
+    // 80s in four 20s pieces: the window leaves one spare grid step.
+    Policy splittable(3, 20, true, false, false, true);
+    Job job(80, TimeRange(5, 95), TimeRange(10, 90), "S", splittable, {}, {});
+    ProblemTable problem = compile_problem({job}, 10);
+    const std::vector<job_index_t> flexible = {0};
+    Placement placement(problem);
+    IncrementalScheduleCost cost_model(problem, placement);
+    MoveLibrary moves(problem, flexible, placement, cost_model, false);
+
+    Rng gen(11);
+    int split = 0;
+    const int steps = 2000;
+    for (int step = 0; step < steps; ++step) {
+        moves.apply(gen);
+        moves.accept();
+        const uint32_t count = placement.count(0);
+        sec_t total = 0;
+        for (uint32_t k = 0; k < count; ++k) {
+            const TimeRange& range = placement.begin(0)[k];
+            CHECK(range.get_low() >= 10);
+            CHECK(range.get_high() <= 95);
+            CHECK_EQ(range.get_low() % 10, static_cast<sec_t>(0));
+            if (k > 0) {
+                CHECK(placement.begin(0)[k - 1].get_high() <= range.get_low());
+            }
+            total += range.length();
+        }
+        CHECK_EQ(total, static_cast<sec_t>(80));
+        split += count > 1 ? 1 : 0;
+    }
+    // Splits are attempted on half the moves from an unsplit job and 35%
+    // from a split one; none of them may fail.
+    CHECK(split > steps * 40 / 100);
+    CHECK(cost_model.cost() < constants::ILLEGAL_SCHEDULE_COST);
+}
+
+TEST_CASE("templated annealer matches the std::function adapter") {
+    auto cost = [](const int& x) { return static_cast<double>((x - 7) * (x - 7)); };
+    auto neighbor = [](const int& x) { return x % 2 == 0 ? x + 1 : x - 3; };
+
+    BasicSimulatedAnnealingOptimizer<int, decltype(cost), decltype(neighbor)> fast(
+        cost, neighbor, 10.0, 1e-3, 500);
+    SimulatedAnnealingOptimizer<int> erased(cost, neighbor, 10.0, 1e-3, 500);
+
+    CHECK_EQ(fast.optimize(40), erased.optimize(40));
+    const std::vector<double> fast_history = fast.get_cost_history();
+    const std::vector<double> erased_history = erased.get_cost_history();
+    REQUIRE_EQ(fast_history.size(), erased_history.size());
+    CHECK_EQ(fast_history.size(), static_cast<size_t>(181));
+    CHECK(fast_history == erased_history);
+}
+
+TEST_CASE("annealing limits stop, reheat and calibrate") {
+    auto cost = [](const int& x) { return static_cast<double>((x - 7) * (x - 7)); };
+    auto neighbor = [](const int& x) { return x > 7 ? x - 1 : x + 1; };
+    using Optimizer = BasicSimulatedAnnealingOptimizer<int, decltype(cost), decltype(neighbor)>;
+
+    Optimizer bounded(cost, neighbor, 10.0, 1e-3, 500);
+    AnnealingLimits limits;
+    limits.lower_bound = 0.0;
+    bounded.set_limits(limits);
+    CHECK_EQ(bounded.optimize(40), 7);
+    CHECK(bounded.get_report().stop == AnnealingStop::LOWER_BOUND);
+    CHECK_EQ(bounded.get_report().iterations, static_cast<uint64_t>(33));
+
+    Optimizer expired(cost, neighbor, 10.0, 1e-3, 500);
+    limits = AnnealingLimits{};
+    limits.deadline = AnnealingLimits::Clock::now();
+    expired.set_limits(limits);
+    CHECK_EQ(expired.optimize(40), 40);
+    CHECK(expired.get_report().stop == AnnealingStop::DEADLINE);
+    CHECK_EQ(expired.get_report().iterations, static_cast<uint64_t>(0));
+
+    auto flat = [](const int&) { return 1.0; };
+    BasicSimulatedAnnealingOptimizer<int, decltype(flat), decltype(neighbor)> plateau(flat, neighbor, 10.0, 1e-3, 500);
+    limits = AnnealingLimits{};
+    limits.plateau_iters = 10;
+    limits.max_reheats = 2;
+    plateau.set_limits(limits);
+    plateau.optimize(0);
+    CHECK(plateau.get_report().stop == AnnealingStop::PLATEAU);
+    CHECK_EQ(plateau.get_report().reheats, static_cast<uint32_t>(2));
+    CHECK_EQ(plateau.get_report().iterations, static_cast<uint64_t>(30));
+
+    Optimizer reheated(cost, neighbor, 10.0, 1e-3, 500);
+    limits = AnnealingLimits{};
+    limits.max_reheats = 1;
+    reheated.set_limits(limits);
+    reheated.optimize(40);
+    CHECK_EQ(reheated.get_report().reheats, static_cast<uint32_t>(1));
+    CHECK(reheated.get_report().iterations > static_cast<uint64_t>(181));
+
+    const auto [t0, tf] = calibrate_temperatures(10.0, 1e-3, 8, []() { return 2.0; });
+    CHECK(costs_match(t0, -2.0 / std::log(0.8)));
+    CHECK(costs_match(tf, -2.0 / std::log(0.01)));
+    const auto [same_t0, same_tf] = calibrate_temperatures(10.0, 1e-3, 8, []() { return -1.0; });
+    CHECK_EQ(same_t0, 10.0);
+    CHECK_EQ(same_tf, 1e-3);
+}
+
+TEST_CASE("CostHistoryRecorder bounds the recorded trace") {
+    auto run = [](CostHistoryPolicy policy) {
+        CostHistoryRecorder recorder(policy, 3);
+        for (uint64_t iter = 0; iter < 1000; ++iter) {
+            recorder.record(iter, static_cast<double>(iter % 10));
+        }
+        return recorder.take();
+    };
+
+    CHECK(run(CostHistoryPolicy{CostHistoryMode::OFF}).empty());
+    CHECK_EQ(run(CostHistoryPolicy{CostHistoryMode::FULL}).size(), static_cast<size_t>(1000));
+
+    CostHistory nth = run(CostHistoryPolicy{CostHistoryMode::EVERY_NTH, 100});
+    REQUIRE_EQ(nth.size(), static_cast<size_t>(11));
+    CHECK_EQ(nth.iterations[1], static_cast<uint64_t>(100));
+    CHECK_EQ(nth.iterations.back(), static_cast<uint64_t>(999));
+    CHECK_EQ(nth.values.back(), 9.0);
+
+    CostHistory reservoir = run(CostHistoryPolicy{CostHistoryMode::RESERVOIR, 1, 50});
+    CHECK(reservoir.size() <= static_cast<size_t>(51));
+    CHECK(std::is_sorted(reservoir.iterations.begin(), reservoir.iterations.end()));
+    CHECK_EQ(reservoir.iterations.back(), static_cast<uint64_t>(999));
+
+    CostHistory buckets = run(CostHistoryPolicy{CostHistoryMode::BUCKETS, 1, 64});
+    CHECK(buckets.size() <= static_cast<size_t>(64));
+    REQUIRE_EQ(buckets.min.size(), buckets.size());
+    CHECK_EQ(buckets.iterations.front(), static_cast<uint64_t>(0));
+    CHECK_EQ(buckets.min.front(), 0.0);
+    CHECK_EQ(buckets.max.front(), 9.0);
+    // 1000 samples into 64 buckets doubles the width to 16: iterations 0..15.
+    CHECK(costs_match(buckets.values.front(), (45.0 + 15.0) / 16.0));
+}
+
 TEST_CASE("RNG seed parsing fallback") {
     unsetenv("ELASTISCHED_RNG_SEED");
     CHECK_EQ(constants::RNG_SEED(), constants::DEFAULT_RNG_SEED);
@@ -302,6 +1057,637 @@ TEST_CASE("RNG seed parsing fallback") {
     CHECK_EQ(constants::RNG_SEED(), static_cast<uint32_t>(12345));
 }
 
+TEST_CASE("RNG streams depend only on the seed and their path") {
+    Rng a(42);
+    Rng b(42);
+    Rng c(43);
+    bool differs = false;
+    for (int i = 0; i < 100; ++i) {
+        const uint64_t value = a();
+        CHECK_EQ(value, b());
+        differs = differs || value != c();
+    }
+    CHECK(differs);
+    for (int i = 0; i < 1000; ++i) {
+        const double unit = unit_interval(a);
+        CHECK(unit >= 0.0);
+        CHECK(unit < 1.0);
+    }
+
+    CHECK_EQ(stream_seed(7, {1, 2}), stream_seed(7, {1, 2}));
+    CHECK(stream_seed(7, {1, 2}) != stream_seed(7, {2, 1}));
+    CHECK(stream_seed(7, {1, 2}) != stream_seed(8, {1, 2}));
+    CHECK(stream_seed(7, {0}) != stream_seed(7, {1}));
+
+    setenv("ELASTISCHED_RNG_SEED", "99", 1);
+    CHECK_EQ(resolve_seed(0), static_cast<uint64_t>(99));
+    CHECK_EQ(resolve_seed(5), static_cast<uint64_t>(5));
+    unsetenv("ELASTISCHED_RNG_SEED");
+
+    // Two days of jobs that start out stacked, solved with replicas so
+    // every kind of stream is drawn from.
+    Policy hard;
+    std::vector<Job> jobs;
+    for (sec_t day = 0; day < 2; ++day) {
+        const sec_t low = day * constants::DAY;
+        for (int i = 0; i < 4; ++i) {
+            jobs.emplace_back(20, TimeRange(low, low + 200), TimeRange(low, low + 20),
+                              "d" + std::to_string(day) + "j" + std::to_string(i), hard, std::set<ID>{}, std::set<Tag>{});
+        }
+    }
+    EngineConfig config;
+    config.granularity = 5;
+    config.num_iters = 500;
+    config.num_replicas = 3;
+    config.seed = 2024;
+    config.num_workers = 1;
+    const SolveResult serial = solve(jobs, config);
+    config.num_workers = 4;
+    const SolveResult parallel = solve(jobs, config);
+    CHECK_EQ(serial.seed, static_cast<uint64_t>(2024));
+
+    config.seed = 0;
+    const SolveResult defaulted = solve(jobs, config);
+    CHECK_EQ(defaulted.seed, static_cast<uint64_t>(constants::DEFAULT_RNG_SEED));
+    config.seed = defaulted.seed;
+    const SolveResult replayed = solve(jobs, config);
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        CHECK(serial.schedule.scheduled_jobs[i].scheduled_time_range
+              == parallel.schedule.scheduled_jobs[i].scheduled_time_range);
+        CHECK(defaulted.schedule.scheduled_jobs[i].scheduled_time_range
+              == replayed.schedule.scheduled_jobs[i].scheduled_time_range);
+    }
+    CHECK(serial.cost_history.values == parallel.cost_history.values);
+    CHECK(defaulted.cost_history.values == replayed.cost_history.values);
+}
+
+TEST_CASE("Snapshots round-trip a problem and solve in place") {
+    Policy hard;
+    Policy splittable(2, 10, true, false, false, true);
+    std::vector<Job> jobs;
+    for (sec_t day = 0; day < 2; ++day) {
+        const sec_t low = day * constants::DAY;
+        const std::string prefix = "d" + std::to_string(day);
+        jobs.emplace_back(20, TimeRange(low, low + 200), TimeRange(low, low + 20), prefix + "a", hard,
+                          std::set<ID>{}, std::set<Tag>{Tag("focus", "deep work"), Tag("home")});
+        jobs.emplace_back(40, TimeRange(low, low + 200), TimeRange(low, low + 40), prefix + "b", splittable,
+                          std::set<ID>{prefix + "a", "missing"}, std::set<Tag>{Tag("focus", "deep work")});
+        jobs.emplace_back(30, TimeRange(low + 100, low + 130), TimeRange(low, low + 30), prefix + "rigid", hard,
+                          std::set<ID>{}, std::set<Tag>{});
+    }
+    jobs[0].set_scheduled_time_ranges({TimeRange(0, 10), TimeRange(50, 60)});
+
+    EngineConfig config;
+    config.granularity = 5;
+    config.num_iters = 2000;
+    config.seed = 77;
+    config.greedy_start = true;
+    config.cost_history = CostHistoryPolicy{CostHistoryMode::EVERY_NTH, 10, 64};
+    const SolveResult solved = solve(jobs, config);
+
+    const std::string path = "snapshot_round_trip.elsnap";
+    write_snapshot(path, jobs, config, &solved.schedule);
+    {
+        const MappedSnapshot snapshot(path);
+        REQUIRE_EQ(snapshot.size(), jobs.size());
+        CHECK_EQ(snapshot.id(4), "d1b");
+
+        const EngineConfig stored = snapshot.config();
+        CHECK_EQ(stored.seed, config.seed);
+        CHECK_EQ(stored.num_iters, config.num_iters);
+        CHECK(stored.greedy_start);
+        CHECK(stored.cost_history.mode == CostHistoryMode::EVERY_NTH);
+        CHECK_EQ(stored.cost_history.interval, static_cast<uint64_t>(10));
+
+        const std::vector<Job> loaded = snapshot.jobs();
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            CHECK_EQ(loaded[i].id, jobs[i].id);
+            CHECK_EQ(loaded[i].duration, jobs[i].duration);
+            CHECK(loaded[i].schedulable_time_range == jobs[i].schedulable_time_range);
+            CHECK(loaded[i].get_scheduled_time_ranges() == jobs[i].get_scheduled_time_ranges());
+            CHECK_EQ(loaded[i].policy.get_scheduling_policies(), jobs[i].policy.get_scheduling_policies());
+            CHECK_EQ(loaded[i].policy.get_max_splits(), jobs[i].policy.get_max_splits());
+            CHECK(loaded[i].tags == jobs[i].tags);
+        }
+        // Dependencies on jobs outside the problem are dropped.
+        CHECK(loaded[1].dependencies == std::set<ID>{"d0a"});
+
+        const Schedule stored_schedule = snapshot.schedule();
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            CHECK(stored_schedule.scheduled_jobs[i].get_scheduled_time_ranges()
+                  == solved.schedule.scheduled_jobs[i].get_scheduled_time_ranges());
+        }
+
+        // The mapped columns go to the solver as they are and replay the
+        // stored solve, except for the split starting placement the batch
+        // path cannot express.
+        jobs[0].set_scheduled_time_ranges({TimeRange(0, 20)});
+        const SolveResult replay = solve(jobs, config);
+        const BatchSolveResult from_snapshot = solve_batch(snapshot.batch(), snapshot.config());
+        CHECK_EQ(from_snapshot.seed, replay.seed);
+        CHECK(from_snapshot.cost_history.values == replay.cost_history.values);
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            const std::vector<TimeRange>& ranges = replay.schedule.scheduled_jobs[i].get_scheduled_time_ranges();
+            REQUIRE_EQ(from_snapshot.segment_offsets[i + 1] - from_snapshot.segment_offsets[i], ranges.size());
+            for (size_t k = 0; k < ranges.size(); ++k) {
+                const uint32_t slot = from_snapshot.segment_offsets[i] + static_cast<uint32_t>(k);
+                CHECK(TimeRange(from_snapshot.segment_low[slot], from_snapshot.segment_high[slot]) == ranges[k]);
+            }
+        }
+    }
+
+    // Rewriting a snapshot replaces the file rather than truncating it, so
+    // a mapping of the old one stays whole.
+    {
+        const MappedSnapshot before(path);
+        write_snapshot(path, {jobs[2]}, config);
+        CHECK_EQ(before.size(), jobs.size());
+        CHECK_EQ(before.id(4), "d1b");
+        CHECK_EQ(MappedSnapshot{path}.size(), static_cast<size_t>(1));
+    }
+
+    // Files that are not snapshots, or are cut short, are rejected.
+    {
+        std::FILE* file = std::fopen(path.c_str(), "r+b");
+        REQUIRE(file != nullptr);
+        std::fputc('X', file);
+        std::fclose(file);
+    }
+    CHECK_THROWS_AS(MappedSnapshot{path}, std::invalid_argument);
+    write_snapshot(path, jobs, config);
+    CHECK(!MappedSnapshot{path}.has_schedule());
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    CHECK_THROWS_AS(MappedSnapshot{path}, std::invalid_argument);
+    std::remove(path.c_str());
+    CHECK_THROWS_AS(MappedSnapshot{path}, std::invalid_argument);
+}
+
+TEST_CASE("parse_problem_json reads jobs and config and names bad fields") {
+    const SolveRequest request = parse_problem_json(R"({
+        "granularity": 300,
+        "config": {"num_iters": 5000, "seed": 9, "greedy_start": false, "cost_history_mode": "full"},
+        "jobs": [
+            {"id": "a", "duration": 1800, "schedulable_time_range": [0, 7200],
+             "policy": {"is_splittable": true, "max_splits": 2, "min_split_duration": 600},
+             "tags": ["focus", {"name": "home", "description": "desk"}]},
+            {"id": "bé", "duration": 3600, "schedulable_time_range": [0, 7200.0],
+             "scheduled_time_range": [3600, 7200], "dependencies": ["a"],
+             "policy": {"scheduling_policies": 10}, "notes": "ignored"},
+            {"id": "c", "duration": 600, "schedulable_time_range": [0, 7200],
+             "scheduled_time_ranges": [[0, 300], [900, 1200]]}
+        ]
+    })");
+
+    CHECK_EQ(request.config.granularity, static_cast<uint64_t>(300));
+    CHECK_EQ(request.config.num_iters, static_cast<uint64_t>(5000));
+    CHECK_EQ(request.config.seed, static_cast<uint64_t>(9));
+    CHECK(!request.config.greedy_start);
+    CHECK(request.config.cost_history.mode == CostHistoryMode::FULL);
+    // Fields left out keep the defaults of default_engine_config.
+    CHECK_EQ(request.config.time_budget_ms, default_engine_config(300).time_budget_ms);
+
+    REQUIRE_EQ(request.jobs.size(), static_cast<size_t>(3));
+    const Job& a = request.jobs[0];
+    CHECK(a.scheduled_time_range == TimeRange(0, 1800));
+    CHECK(a.policy.is_splittable());
+    CHECK_EQ(a.policy.get_max_splits(), 2);
+    CHECK_EQ(a.policy.get_min_split_duration(), static_cast<sec_t>(600));
+    CHECK(a.tags == (std::set<Tag>{Tag("focus"), Tag("home", "desk")}));
+    const Job& b = request.jobs[1];
+    CHECK_EQ(b.id, "b\xc3\xa9");
+    CHECK(b.schedulable_time_range == TimeRange(0, 7200));
+    CHECK(b.scheduled_time_range == TimeRange(3600, 7200));
+    CHECK(b.dependencies == std::set<ID>{"a"});
+    CHECK(b.policy.is_overlappable());
+    CHECK(b.policy.get_round_to_granularity());
+    CHECK(!b.policy.is_splittable());
+    CHECK_EQ(request.jobs[2].get_scheduled_time_ranges().size(), static_cast<size_t>(2));
+
+    const std::string job = R"("jobs": [{"id": "x", "duration": 10, "schedulable_time_range": [0, 100]}])";
+    CHECK_EQ(parse_problem_json("{\"granularity\": 5, " + job + "}").jobs.size(), static_cast<size_t>(1));
+    CHECK_THROWS_AS(parse_problem_json("{\"granularity\": 5, " + job), std::invalid_argument);
+    CHECK_THROWS_AS(parse_problem_json("{\"granularity\": -5, " + job + "}"), std::invalid_argument);
+    CHECK_THROWS_AS(parse_problem_json("{\"granularity\": 5, \"config\": {\"num_iter\": 1}, " + job + "}"),
+                    std::invalid_argument);
+    // A window shorter than the duration parses, and is reported by the
+    // feasibility check as it is for a snapshot.
+    const SolveRequest too_short = parse_problem_json(R"({"granularity": 5, "jobs": [{"id": "x", "duration": 10,
+                                                           "schedulable_time_range": [0, 5]}]})");
+    const FeasibilityReport report = check_feasibility(too_short.jobs, too_short.config.granularity);
+    REQUIRE_EQ(report.conflicts.size(), static_cast<size_t>(1));
+    CHECK(report.conflicts[0].kind == ConflictKind::WINDOW_TOO_SHORT);
+    CHECK_THROWS_AS(parse_problem_json(R"({"granularity": 5, "jobs": [{"id": "x", "duration": 10}]})"),
+                    std::invalid_argument);
+}
+
+TEST_CASE("JSON and snapshot inputs solve alike, with a granularity of 0") {
+    // Off-grid jobs that start on top of each other, so annealing has to
+    // resample them.
+    SolveRequest request = parse_problem_json(R"({
+        "granularity": 0,
+        "config": {"num_iters": 2000, "greedy_start": false},
+        "jobs": [
+            {"id": "a", "duration": 7, "schedulable_time_range": [1, 40]},
+            {"id": "b", "duration": 13, "schedulable_time_range": [1, 40]},
+            {"id": "s", "duration": 11, "schedulable_time_range": [3, 40],
+             "policy": {"is_splittable": true, "max_splits": 2, "min_split_duration": 3}}
+        ]
+    })");
+    CHECK_EQ(request.config.granularity, static_cast<uint64_t>(0));
+    const SolveResult solved = solve(request.jobs, request.config);
+    CHECK(solved.feasibility.feasible());
+    CHECK(ScheduleCostFunction(solved.schedule, 0).schedule_cost() < constants::ILLEGAL_SCHEDULE_COST);
+
+    const std::string path = "granularity_zero.elsnap";
+    write_snapshot(path, request.jobs, request.config);
+    {
+        const MappedSnapshot snapshot(path);
+        CHECK_EQ(snapshot.config().granularity, static_cast<uint64_t>(0));
+        const BatchSolveResult from_snapshot = solve_batch(snapshot.batch(), snapshot.config());
+        CHECK(from_snapshot.feasibility.feasible());
+        CHECK(from_snapshot.cost_history.values == solved.cost_history.values);
+    }
+
+    // Both inputs report the same conflicts; batch ones name jobs by index.
+    const SolveRequest conflicting = parse_problem_json(R"({
+        "granularity": 0,
+        "jobs": [
+            {"id": "short", "duration": 10, "schedulable_time_range": [0, 5]},
+            {"id": "r1", "duration": 10, "schedulable_time_range": [20, 30]},
+            {"id": "r2", "duration": 10, "schedulable_time_range": [25, 35]}
+        ]
+    })");
+    const SolveResult from_json = solve(conflicting.jobs, conflicting.config);
+    write_snapshot(path, conflicting.jobs, conflicting.config);
+    {
+        const MappedSnapshot snapshot(path);
+        const BatchSolveResult from_snapshot = solve_batch(snapshot.batch(), snapshot.config());
+        REQUIRE_EQ(from_json.feasibility.conflicts.size(), static_cast<size_t>(2));
+        REQUIRE_EQ(from_snapshot.feasibility.conflicts.size(), from_json.feasibility.conflicts.size());
+        for (size_t c = 0; c < from_json.feasibility.conflicts.size(); ++c) {
+            const FeasibilityConflict& expected = from_json.feasibility.conflicts[c];
+            const FeasibilityConflict& actual = from_snapshot.feasibility.conflicts[c];
+            CHECK(actual.kind == expected.kind);
+            REQUIRE_EQ(actual.job_ids.size(), expected.job_ids.size());
+            for (size_t j = 0; j < actual.job_ids.size(); ++j) {
+                CHECK_EQ(snapshot.id(static_cast<job_index_t>(std::stoul(actual.job_ids[j]))), expected.job_ids[j]);
+            }
+        }
+        CHECK(from_json.feasibility.conflicts[0].kind == ConflictKind::WINDOW_TOO_SHORT);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("CalendarIndex lists segments in every day they touch") {
+    Policy policy;
+    const sec_t day = constants::DAY;
+    std::vector<Job> jobs;
+    jobs.emplace_back(10, TimeRange(day, 3 * day), TimeRange(day + 5, day + 15), "a", policy, std::set<ID>{}, std::set<Tag>{});
+    jobs.emplace_back(day, TimeRange(day, 3 * day), TimeRange(2 * day - 100, 3 * day - 100), "b", policy, std::set<ID>{}, std::set<Tag>{});
+    ProblemTable problem = compile_problem(jobs, 1);
+    Placement placement(problem);
+    CalendarIndex calendar(problem, placement);
+
+    REQUIRE_EQ(calendar.bucket_count(), static_cast<size_t>(3));
+    CHECK_EQ(calendar.bucket_of(0), static_cast<uint32_t>(0));
+    CHECK_EQ(calendar.bucket_of(day + 1), static_cast<uint32_t>(0));
+    CHECK_EQ(calendar.bucket_of(10 * day), static_cast<uint32_t>(2));
+    CHECK_EQ(calendar.bucket(0).size(), static_cast<size_t>(2));
+    CHECK_EQ(calendar.bucket(1).size(), static_cast<size_t>(1));
+
+    const TimeRange moved(2 * day + 10, 2 * day + 20);
+    calendar.remove(0, placement.begin(0), placement.count(0));
+    placement.assign(0, &moved, 1);
+    calendar.insert(0, &moved, 1);
+    CHECK_EQ(calendar.bucket(0).size(), static_cast<size_t>(1));
+    CHECK_EQ(calendar.bucket(1).size(), static_cast<size_t>(2));
+    CHECK_EQ(calendar.bucket(1).back().job, static_cast<job_index_t>(0));
+}
+
+TEST_CASE("solve anneals disjoint components independently of worker count") {
+    Policy hard;
+    std::vector<Job> jobs;
+    // Three days, each with two flexible jobs that start out colliding.
+    for (sec_t day = 0; day < 3; ++day) {
+        sec_t low = day * constants::DAY;
+        TimeRange window(low, low + 100);
+        std::string prefix = "d" + std::to_string(day);
+        jobs.emplace_back(10, window, TimeRange(low, low + 10), prefix + "a", hard, std::set<ID>{}, std::set<Tag>{});
+        jobs.emplace_back(10, window, TimeRange(low + 5, low + 15), prefix + "b", hard, std::set<ID>{prefix + "a"}, std::set<Tag>{});
+    }
+
+    EngineConfig config;
+    config.granularity = 5;
+    config.initial_temp = 10.0;
+    config.final_temp = 1e-4;
+    config.num_iters = 1000;
+
+    config.num_workers = 1;
+    SolveResult serial = solve(jobs, config);
+    config.num_workers = 4;
+    SolveResult parallel = solve(jobs, config);
+
+    REQUIRE_EQ(serial.schedule.scheduled_jobs.size(), jobs.size());
+    CHECK(ScheduleCostFunction(serial.schedule, 5).schedule_cost() < constants::ILLEGAL_SCHEDULE_COST);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        CHECK_EQ(serial.schedule.scheduled_jobs[i].id, jobs[i].id);
+        CHECK(serial.schedule.scheduled_jobs[i].scheduled_time_range
+              == parallel.schedule.scheduled_jobs[i].scheduled_time_range);
+    }
+    CHECK(serial.cost_history.values == parallel.cost_history.values);
+    CHECK(serial.cost_history.values.front() >= constants::ILLEGAL_SCHEDULE_COST);
+    // The history holds proposed costs, so only some of them must be legal.
+    CHECK(*std::min_element(serial.cost_history.values.begin(), serial.cost_history.values.end())
+          < constants::ILLEGAL_SCHEDULE_COST);
+}
+
+TEST_CASE("parallel tempering stops every thread once a replica throws") {
+    struct Replica {
+        bool throws = false;
+        double cost() const { return 1.0; }
+        double apply_move() {
+            if (throws) {
+                throw std::runtime_error("replica failed");
+            }
+            return 1.0;
+        }
+        void undo_move() {}
+        void accept_move() {}
+        double probe_move() { return apply_move(); }
+        void discard_move() {}
+        void record_best() {}
+    };
+    Replica healthy;
+    Replica failing;
+    failing.throws = true;
+    // Far more exchanges than the threads could step through: the run
+    // only returns if the failure stops it.
+    ParallelTemperingOptimizer<Replica> optimizer({&healthy, &failing}, 10.0, 1.0, uint64_t{1} << 40, 1, 2, 7);
+    CHECK_THROWS_AS(optimizer.optimize(), std::runtime_error);
+    CHECK_EQ(optimizer.get_swap_attempts(), static_cast<uint64_t>(0));
+}
+
+TEST_CASE("parallel tempering finds a legal schedule independently of worker count") {
+    Policy hard;
+    TimeRange window(0, 200);
+    std::vector<Job> jobs;
+    // Four jobs stacked on the same slot; a legal schedule lines them up.
+    for (int i = 0; i < 4; ++i) {
+        jobs.emplace_back(20, window, TimeRange(0, 20), "job" + std::to_string(i), hard, std::set<ID>{}, std::set<Tag>{});
+    }
+
+    EngineConfig config;
+    config.granularity = 5;
+    config.initial_temp = 10.0;
+    config.final_temp = 1e-2;
+    config.num_iters = 2000;
+    config.num_replicas = 4;
+    config.swap_interval = 50;
+
+    config.num_workers = 1;
+    SolveResult serial = solve(jobs, config);
+    config.num_workers = 4;
+    SolveResult parallel = solve(jobs, config);
+
+    CHECK(ScheduleCostFunction(serial.schedule, 5).schedule_cost() < constants::ILLEGAL_SCHEDULE_COST);
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        CHECK(serial.schedule.scheduled_jobs[i].scheduled_time_range
+              == parallel.schedule.scheduled_jobs[i].scheduled_time_range);
+    }
+    CHECK(serial.cost_history.values == parallel.cost_history.values);
+    // The jobs fit side by side, so the run stops at the zero lower bound
+    // well before num_iters.
+    CHECK_EQ(ScheduleCostFunction(serial.schedule, 5).schedule_cost(), 0.0);
+    CHECK(serial.cost_history.iterations.back() < static_cast<uint64_t>(2000));
+}
+
+TEST_CASE("solve stops within its time budget") {
+    Policy hard;
+    TimeRange window(0, 2000);
+    std::vector<Job> jobs;
+    for (int i = 0; i < 12; ++i) {
+        jobs.emplace_back(50, window, TimeRange(0, 50), "job" + std::to_string(i), hard, std::set<ID>{}, std::set<Tag>{});
+    }
+
+    EngineConfig config;
+    config.granularity = 5;
+    config.num_iters = UINT64_MAX;
+    config.time_budget_ms = 50;
+    config.calibration_samples = 32;
+    config.plateau_iters = 2000;
+    config.max_reheats = 2;
+
+    const auto start = std::chrono::steady_clock::now();
+    SolveResult result = solve(jobs, config);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    CHECK(elapsed < std::chrono::seconds(2));
+    CHECK(ScheduleCostFunction(result.schedule, 5).schedule_cost() < constants::ILLEGAL_SCHEDULE_COST);
+}
+
+TEST_CASE("schedule_batch solves independent requests on one pool in request order") {
+    Policy hard;
+    EngineConfig config;
+    config.granularity = 5;
+    config.num_iters = UINT64_MAX;
+    config.time_budget_ms = 50;
+    config.calibration_samples = 32;
+    config.plateau_iters = 2000;
+    config.greedy_start = true;
+
+    std::vector<SolveRequest> requests;
+    for (int r = 0; r < 4; ++r) {
+        std::vector<Job> jobs;
+        for (int i = 0; i < 8; ++i) {
+            const std::string id = "r" + std::to_string(r) + "-" + std::to_string(i);
+            jobs.emplace_back(50, TimeRange(0, 1000), TimeRange(0, 50), id, hard, std::set<ID>{}, std::set<Tag>{});
+        }
+        requests.push_back(SolveRequest{jobs, config});
+    }
+    requests.push_back(SolveRequest{{}, config});
+    requests.push_back(SolveRequest{
+        {Job(10, TimeRange(0, 100), TimeRange(0, 10), "A", hard, {"B"}, {}),
+         Job(10, TimeRange(0, 100), TimeRange(20, 30), "B", hard, {"A"}, {})},
+        config});
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<SolveResult> results = schedule_batch(requests, 2);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(elapsed < std::chrono::seconds(2));
+
+    REQUIRE_EQ(results.size(), requests.size());
+    for (int r = 0; r < 4; ++r) {
+        const SolveResult& result = results[r];
+        REQUIRE_EQ(result.schedule.scheduled_jobs.size(), static_cast<size_t>(8));
+        CHECK_EQ(result.schedule.scheduled_jobs[0].id, "r" + std::to_string(r) + "-0");
+        CHECK(result.feasibility.feasible());
+        CHECK(ScheduleCostFunction(result.schedule, 5).schedule_cost() < constants::ILLEGAL_SCHEDULE_COST);
+    }
+    CHECK(results[4].schedule.scheduled_jobs.empty());
+    // A cycle is reported for its own request instead of failing the batch.
+    REQUIRE_EQ(results[5].feasibility.conflicts.size(), static_cast<size_t>(1));
+    CHECK(results[5].feasibility.conflicts[0].kind == ConflictKind::DEPENDENCY_CYCLE);
+}
+
+TEST_CASE("reschedule re-solves only the jobs a change affects") {
+    Policy hard;
+    std::vector<Job> jobs;
+    for (sec_t day = 0; day < 3; ++day) {
+        sec_t low = day * constants::DAY;
+        TimeRange window(low, low + 100);
+        std::string prefix = "d" + std::to_string(day);
+        jobs.emplace_back(10, window, TimeRange(low, low + 10), prefix + "a", hard, std::set<ID>{}, std::set<Tag>{});
+        jobs.emplace_back(10, window, TimeRange(low + 5, low + 15), prefix + "b", hard, std::set<ID>{prefix + "a"}, std::set<Tag>{});
+    }
+    EngineConfig config;
+    config.granularity = 5;
+    config.num_iters = 1000;
+    SolveResult first = solve(jobs, config);
+    REQUIRE(ScheduleCostFunction(first.schedule, 5).schedule_cost() < constants::ILLEGAL_SCHEDULE_COST);
+
+    // A new job collides with day 0 and day 2 loses a job; day 1 is untouched.
+    ScheduleChange change;
+    change.added.emplace_back(10, TimeRange(0, 100), TimeRange(0, 10), "d0c", hard, std::set<ID>{}, std::set<Tag>{});
+    change.removed.insert("d2b");
+    SolveResult second = reschedule(first.schedule, change, config);
+
+    const std::vector<Job>& before = first.schedule.scheduled_jobs;
+    const std::vector<Job>& after = second.schedule.scheduled_jobs;
+    REQUIRE_EQ(after.size(), static_cast<size_t>(6));
+    CHECK_EQ(after[4].id, std::string("d2a"));
+    CHECK_EQ(after[5].id, std::string("d0c"));
+    CHECK(ScheduleCostFunction(second.schedule, 5).schedule_cost() < constants::ILLEGAL_SCHEDULE_COST);
+    for (size_t i = 2; i < 4; ++i) {
+        CHECK_EQ(after[i].id, before[i].id);
+        CHECK(after[i].scheduled_time_ranges == before[i].scheduled_time_ranges);
+    }
+
+    ScheduleChange unknown;
+    unknown.removed.insert("missing");
+    CHECK_THROWS_AS(reschedule(first.schedule, unknown, config), std::invalid_argument);
+    ScheduleChange duplicate;
+    duplicate.added.push_back(before[0]);
+    CHECK_THROWS_AS(reschedule(first.schedule, duplicate, config), std::invalid_argument);
+
+    // A job both replaced and dropped is named as such, not as unknown.
+    ScheduleChange contradictory;
+    contradictory.modified.push_back(before[0]);
+    contradictory.removed.insert(before[0].id);
+    std::string message;
+    try {
+        reschedule(first.schedule, contradictory, config);
+    } catch (const std::invalid_argument& error) {
+        message = error.what();
+    }
+    CHECK_EQ(message, "reschedule: job " + before[0].id + " is both modified and removed");
+    ScheduleChange twice;
+    twice.modified = {before[0], before[0]};
+    CHECK_THROWS_AS(reschedule(first.schedule, twice, config), std::invalid_argument);
+}
+
+TEST_CASE("SolveHandle reports progress and returns the best schedule when cancelled") {
+    Policy hard;
+    TimeRange window(0, 2000);
+    std::vector<Job> jobs;
+    // More work than fits in the window, so the solve never reaches its lower bound.
+    for (int i = 0; i < 30; ++i) {
+        jobs.emplace_back(100, window, TimeRange(0, 100), "job" + std::to_string(i), hard, std::set<ID>{}, std::set<Tag>{});
+    }
+
+    EngineConfig config;
+    config.granularity = 5;
+    config.num_iters = UINT64_MAX;
+    config.max_reheats = UINT32_MAX;
+
+    std::atomic<int> calls{0};
+    SolveHandle handle(jobs, config, [&calls](const SolveProgress&) { ++calls; }, std::chrono::milliseconds(1));
+    const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (calls.load() == 0 && std::chrono::steady_clock::now() < give_up) {
+        handle.wait_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(calls.load() > 0);
+    CHECK(!handle.done());
+    CHECK_EQ(handle.best_schedule().scheduled_jobs.size(), jobs.size());
+    CHECK(handle.progress().iterations > static_cast<uint64_t>(0));
+
+    handle.cancel();
+    REQUIRE(handle.wait_for(std::chrono::seconds(5)));
+    SolveResult result = handle.result();
+    REQUIRE_EQ(result.schedule.scheduled_jobs.size(), jobs.size());
+    CHECK_EQ(handle.progress().components_done, static_cast<size_t>(1));
+    CHECK(costs_match(handle.progress().best_cost, ScheduleCostFunction(result.schedule, 5).schedule_cost()));
+}
+
+TEST_CASE("SolveMonitor counts the components that have reported a cost") {
+    Policy hard;
+    std::vector<Job> jobs;
+    for (sec_t day = 0; day < 3; ++day) {
+        const sec_t low = day * constants::DAY;
+        for (int i = 0; i < 3; ++i) {
+            jobs.emplace_back(20, TimeRange(low, low + 100), TimeRange(low, low + 20),
+                              "d" + std::to_string(day) + "j" + std::to_string(i), hard, std::set<ID>{}, std::set<Tag>{});
+        }
+    }
+
+    EngineConfig config;
+    config.granularity = 5;
+    config.num_iters = 5000;
+    config.num_workers = 1;
+
+    std::vector<size_t> reported;
+    SolveMonitor monitor(
+        [&reported](const SolveProgress& progress) {
+            CHECK_EQ(progress.component_count, static_cast<size_t>(3));
+            reported.push_back(progress.components_reported);
+        },
+        std::chrono::milliseconds(0));
+    SolveResult result = solve(jobs, config, &monitor);
+
+    REQUIRE(!reported.empty());
+    CHECK(std::is_sorted(reported.begin(), reported.end()));
+    CHECK_EQ(monitor.progress().components_reported, static_cast<size_t>(3));
+    CHECK(costs_match(monitor.progress().best_cost, ScheduleCostFunction(result.schedule, 5).schedule_cost()));
+}
+
+TEST_CASE("SolveHandle rethrows solve errors from result") {
+    Policy policy;
+    Job a(10, TimeRange(0, 100), TimeRange(0, 10), "a", policy, {"b"}, {});
+    Job b(10, TimeRange(0, 100), TimeRange(20, 30), "b", policy, {"a"}, {});
+
+    SolveHandle handle({a, b}, EngineConfig{});
+    CHECK_THROWS_AS(handle.result(), std::invalid_argument);
+    CHECK(handle.done());
+}
+
+TEST_CASE("solve keeps cross-component dependency violations illegal") {
+    Policy policy;
+    // "early" must wait for "late", whose window is entirely after it.
+    Job early(10, TimeRange(0, 100), TimeRange(0, 10), "early", policy, {"late"}, {});
+    Job late(10, TimeRange(1000, 1100), TimeRange(1000, 1010), "late", policy, {}, {});
+
+    EngineConfig config;
+    config.granularity = 1;
+    config.num_iters = 100;
+    SolveResult result = solve({early, late}, config);
+    CHECK(result.cost_history.values.back() >= constants::ILLEGAL_SCHEDULE_COST);
+}
+
+TEST_CASE("schedule_jobs returns one cost per iteration") {
+    // Two overlappable jobs that always overlap, so the run neither
+    // reaches its lower bound nor freezes before num_iters, and is longer
+    // than the default history capacity.
+    Policy overlappable(0, 0, false, true, false, false);
+    TimeRange schedulable(0, 100);
+    std::vector<Job> jobs = {
+        Job(80, schedulable, TimeRange(0, 80), "A", overlappable, {}, {}),
+        Job(80, schedulable, TimeRange(20, 100), "B", overlappable, {}, {}),
+    };
+    const uint64_t num_iters = 3 * CostHistoryPolicy{}.capacity;
+    auto result = schedule_jobs(jobs, 10, 10.0, 1e-300, num_iters);
+    CHECK_EQ(result.second.size(), static_cast<size_t>(num_iters + 1));
+}
+
 TEST_CASE("schedule_jobs empty input") {
     auto result = schedule_jobs({}, 1, 1.0, 0.1, 10);
     CHECK_EQ(result.first.scheduled_jobs.size(), static_cast<size_t>(0));